@@ -57,7 +57,8 @@ public enum class GeneralOffsetMode
     Smooth,     ///< create mesh using dual marching cubes from OpenVDB library
 #endif
     Standard,   ///< create mesh using standard marching cubes implemented in MeshLib
-    Sharpening  ///< create mesh using standard marching cubes with additional sharpening implemented in MeshLib
+    Sharpening, ///< create mesh using standard marching cubes with additional sharpening implemented in MeshLib
+    DualContouring ///< create mesh using adaptive dual contouring implemented in MeshLib
 };
 
 /// allows the user to select in the parameters which offset algorithm to call
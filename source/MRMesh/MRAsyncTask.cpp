@@ -0,0 +1,158 @@
+#include "MRAsyncTask.h"
+#include "MRParallelFor.h"
+#include "MRTorus.h"
+#include "MRMesh.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <chrono>
+#include <thread>
+
+namespace MR
+{
+
+AsyncTaskControl::AsyncTaskControl( AsyncTaskSettings settings )
+    : settings_( std::move( settings ) )
+    , submitTime_( Clock::now() )
+{
+}
+
+AsyncTaskTelemetry AsyncTaskControl::telemetry() const
+{
+    AsyncTaskTelemetry res;
+    res.progress = progress_;
+    res.progressReports = progressReports_;
+    res.canceled = canceled_;
+    res.timedOut = timedOut_;
+    res.resultHeapBytes = resultHeapBytes_;
+
+    std::unique_lock lock( timesMutex_ );
+    res.started = started_;
+    res.finished = finished_;
+    const auto now = Clock::now();
+    if ( !started_ )
+    {
+        res.waitSec = std::chrono::duration<double>( now - submitTime_ ).count();
+        return res;
+    }
+    res.waitSec = std::chrono::duration<double>( startTime_ - submitTime_ ).count();
+    res.runSec = std::chrono::duration<double>( ( finished_ ? finishTime_ : now ) - startTime_ ).count();
+    return res;
+}
+
+ProgressCallback AsyncTaskControl::progressCallback()
+{
+    return [this]( float p )
+    {
+        progress_ = p;
+        ++progressReports_;
+        if ( canceled_ )
+            return false;
+        if ( settings_.timeoutSec > 0 )
+        {
+            std::unique_lock lock( timesMutex_ );
+            if ( std::chrono::duration<double>( Clock::now() - startTime_ ).count() > settings_.timeoutSec )
+            {
+                timedOut_ = true;
+                canceled_ = true;
+                return false;
+            }
+        }
+        if ( !reportProgress( settings_.progress, p ) )
+        {
+            canceled_ = true;
+            return false;
+        }
+        return true;
+    };
+}
+
+void AsyncTaskControl::execute( const std::function<void()> & f )
+{
+    {
+        std::unique_lock lock( timesMutex_ );
+        startTime_ = Clock::now();
+        started_ = true;
+    }
+
+    // record the end of the task even if it throws an exception
+    struct FinishGuard
+    {
+        AsyncTaskControl & c;
+        ~FinishGuard()
+        {
+            std::unique_lock lock( c.timesMutex_ );
+            c.finishTime_ = Clock::now();
+            c.finished_ = true;
+        }
+    } guard{ *this };
+
+    tbb::task_arena::priority priority = tbb::task_arena::priority::normal;
+    if ( settings_.priority == AsyncTaskPriority::Low )
+        priority = tbb::task_arena::priority::low;
+    else if ( settings_.priority == AsyncTaskPriority::High )
+        priority = tbb::task_arena::priority::high;
+
+    // the arena isolates the tasks of this operation from the tasks of other operations,
+    // and limits the number of threads working on it
+    tbb::task_arena arena( settings_.maxThreads > 0 ? settings_.maxThreads : tbb::task_arena::automatic, 1, priority );
+    arena.execute( f );
+}
+
+TEST( MRMesh, AsyncTask )
+{
+    // successful task with a result
+    AsyncTaskSettings settings;
+    settings.maxThreads = 2;
+    auto meshTask = runAsync( []( ProgressCallback cb ) -> Expected<Mesh>
+    {
+        if ( !reportProgress( cb, 0.5f ) )
+            return unexpectedOperationCanceled();
+        return makeTorus();
+    }, settings );
+    auto mesh = meshTask.get();
+    ASSERT_TRUE( mesh.has_value() );
+    EXPECT_GT( mesh->topology.numValidFaces(), 0 );
+    auto t = meshTask.telemetry();
+    EXPECT_TRUE( t.started && t.finished );
+    EXPECT_FALSE( t.canceled );
+    EXPECT_EQ( t.progressReports, 1 );
+    EXPECT_EQ( t.resultHeapBytes, mesh->heapBytes() );
+
+#ifndef __EMSCRIPTEN__
+    // the task runs parallel loops until canceled by the caller
+    // (only with real threads: a deferred task starts only in get())
+    std::atomic<bool> running{ false };
+    auto endless = runAsync( [&]( ProgressCallback cb ) -> Expected<int>
+    {
+        std::vector<int> v( 1024 );
+        for ( ;; )
+        {
+            running = true;
+            if ( !ParallelFor( v, [&]( size_t i ) { ++v[i]; }, cb ) )
+                return unexpectedOperationCanceled();
+        }
+    } );
+    const auto waitStart = std::chrono::steady_clock::now();
+    while ( !running && std::chrono::steady_clock::now() - waitStart < std::chrono::seconds( 10 ) )
+        std::this_thread::yield();
+    endless.cancel();
+    ASSERT_TRUE( running );
+    EXPECT_FALSE( endless.get().has_value() );
+    EXPECT_TRUE( endless.telemetry().canceled );
+#endif
+
+    // the task is stopped by the timeout
+    settings = {};
+    settings.timeoutSec = 0.01;
+    auto timed = runAsync( []( ProgressCallback cb )
+    {
+        while ( reportProgress( cb, 0.0f ) )
+            std::this_thread::yield();
+    }, settings );
+    const auto res = timed.get();
+    ASSERT_FALSE( res.has_value() );
+    EXPECT_EQ( res.error(), "Operation timed out" );
+    EXPECT_TRUE( timed.telemetry().timedOut );
+}
+
+} //namespace MR
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRPch/MRAsyncLaunchType.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+namespace MR
+{
+
+/// \defgroup AsyncTaskGroup Asynchronous Tasks
+/// \ingroup BasicGroup
+/// \{
+
+/// priority of the threads executing a task relative to other tasks
+enum class AsyncTaskPriority
+{
+    Low,
+    Normal,
+    High
+};
+
+struct AsyncTaskSettings
+{
+    /// maximal number of threads working on the task simultaneously (including its own thread), 0 means all hardware threads
+    int maxThreads = 0;
+    AsyncTaskPriority priority = AsyncTaskPriority::Normal;
+    /// if positive, the task is canceled when it runs longer than this number of seconds
+    double timeoutSec = 0;
+    /// optional callback receiving the progress of the task; returning false from it cancels the task
+    ProgressCallback progress;
+};
+
+/// statistics of one task, which can be requested during its execution or after its end
+struct AsyncTaskTelemetry
+{
+    /// time from the submission of the task till its start
+    double waitSec = 0;
+    /// time from the start of the task till its end (or till now if not finished yet)
+    double runSec = 0;
+    /// last progress reported by the task
+    float progress = 0;
+    /// the number of progress reports, shows how often the task checks for cancellation
+    size_t progressReports = 0;
+    bool started = false;
+    bool finished = false;
+    bool canceled = false;
+    bool timedOut = false;
+    /// the memory on heap occupied by the result of successful task, if its type provides heapBytes()
+    size_t resultHeapBytes = 0;
+};
+
+/// the state of a task shared between the caller and the thread executing the task:
+/// it provides cooperative cancellation via the progress callback given to the operation, and collects telemetry
+class AsyncTaskControl
+{
+public:
+    MRMESH_API explicit AsyncTaskControl( AsyncTaskSettings settings );
+
+    /// requests the task to stop, it will take effect on the next progress report of the task
+    void cancel() { canceled_ = true; }
+
+    /// returns true if the task was canceled by the caller, by its progress callback or by the timeout
+    [[nodiscard]] bool isCanceled() const { return canceled_; }
+
+    /// returns true if the task was canceled because of the timeout
+    [[nodiscard]] bool isTimedOut() const { return timedOut_; }
+
+    /// returns current statistics of the task
+    [[nodiscard]] MRMESH_API AsyncTaskTelemetry telemetry() const;
+
+    /// returns the callback to pass into the operation, which records its progress
+    /// and returns false as soon as the task is canceled or its time is out
+    [[nodiscard]] MRMESH_API ProgressCallback progressCallback();
+
+    /// executes given function in the thread arena of this task with the settings' thread limit and priority
+    MRMESH_API void execute( const std::function<void()> & f );
+
+    /// records the memory occupied by the result of the task
+    void setResultHeapBytes( size_t bytes ) { resultHeapBytes_ = bytes; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    AsyncTaskSettings settings_;
+    std::atomic<bool> canceled_{ false };
+    std::atomic<bool> timedOut_{ false };
+    std::atomic<float> progress_{ 0 };
+    std::atomic<size_t> progressReports_{ 0 };
+    std::atomic<size_t> resultHeapBytes_{ 0 };
+
+    mutable std::mutex timesMutex_;
+    Clock::time_point submitTime_, startTime_, finishTime_;
+    bool started_ = false;
+    bool finished_ = false;
+};
+
+/// the handle of an operation running asynchronously, returning either T or an error
+template<typename T>
+class AsyncTask
+{
+public:
+    AsyncTask() = default;
+    AsyncTask( std::shared_ptr<AsyncTaskControl> control, std::future<Expected<T>> future )
+        : control_( std::move( control ) ), future_( std::move( future ) ) {}
+
+    /// returns true if this handle refers to a task, which result was not taken yet
+    [[nodiscard]] bool valid() const { return future_.valid(); }
+
+    /// returns true if the task has finished, waiting for it at most given number of seconds
+    [[nodiscard]] bool waitFor( double sec ) const
+        { return future_.wait_for( std::chrono::duration<double>( sec ) ) == std::future_status::ready; }
+
+    /// waits for the end of the task and returns its result; it can be called only once
+    [[nodiscard]] Expected<T> get() { return future_.get(); }
+
+    /// requests the task to stop, then get() will return an error unless the operation has already finished
+    void cancel() { control_->cancel(); }
+
+    /// returns current statistics of the task
+    [[nodiscard]] AsyncTaskTelemetry telemetry() const { return control_->telemetry(); }
+
+    [[nodiscard]] const std::shared_ptr<AsyncTaskControl> & control() const { return control_; }
+
+private:
+    std::shared_ptr<AsyncTaskControl> control_;
+    std::future<Expected<T>> future_;
+};
+
+namespace detail
+{
+template<typename R>
+struct AsyncResult { using type = R; };
+template<typename T>
+struct AsyncResult<Expected<T>> { using type = T; };
+} // namespace detail
+
+/// starts given operation in a separate thread, the operation receives ProgressCallback that it has to poll
+/// and returns either a value, Expected value or nothing (then the cancellation of the task is reported as an error);
+/// all parallel algorithms inside the operation are executed in a separate thread arena with the limit of threads from the settings,
+/// so several long tasks can run simultaneously without starving each other
+template<typename F>
+auto runAsync( F && f, AsyncTaskSettings settings = {} )
+{
+    using R = std::invoke_result_t<F, ProgressCallback>;
+    using T = typename detail::AsyncResult<R>::type;
+
+    auto control = std::make_shared<AsyncTaskControl>( std::move( settings ) );
+    auto future = std::async( getAsyncLaunchType(), [control, f = std::forward<F>( f )]() mutable -> Expected<T>
+    {
+        std::optional<Expected<T>> res;
+        control->execute( [&]
+        {
+            if constexpr ( std::is_void_v<R> )
+            {
+                f( control->progressCallback() );
+                res.emplace();
+            }
+            else
+                res.emplace( f( control->progressCallback() ) );
+        } );
+        // a function without result cannot report the cancellation otherwise
+        if constexpr ( std::is_void_v<R> )
+        {
+            if ( control->isCanceled() )
+                res.emplace( unexpectedOperationCanceled() );
+        }
+        if ( !*res && control->isTimedOut() )
+            return unexpected( "Operation timed out" );
+        if constexpr ( !std::is_void_v<T> )
+        {
+            if constexpr ( requires { ( *res )->heapBytes(); } )
+            {
+                if ( *res )
+                    control->setResultHeapBytes( ( *res )->heapBytes() );
+            }
+        }
+        return std::move( *res );
+    } );
+    return AsyncTask<T>( std::move( control ), std::move( future ) );
+}
+
+/// \}
+
+} // namespace MR
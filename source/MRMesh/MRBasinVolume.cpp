@@ -2,7 +2,9 @@
 #include "MRVector3.h"
 #include "MRVector2.h"
 #include "MRMesh.h"
+#include "MRBitSet.h"
 #include "MRTimer.h"
+#include "MRPch/MRTBB.h"
 #include <algorithm>
 #include <cassert>
 
@@ -62,10 +64,16 @@ bool BasinVolumeCalculator::addTerrainTri( Triangle3f t, float level )
 double computeBasinVolume( const Mesh& mesh, const FaceBitSet& faces, float level )
 {
     MR_TIMER
-    BasinVolumeCalculator calc;
-    for ( auto f : faces )
-        calc.addTerrainTri( mesh.getTriPoints( f ), level );
-    return calc.getVolume();
+    return tbb::parallel_reduce( tbb::blocked_range<FaceId>( 0_f, faces.endId() ), 0.0,
+        [&]( const tbb::blocked_range<FaceId> & range, double curr )
+        {
+            BasinVolumeCalculator calc;
+            for ( auto f = range.begin(); f < range.end(); ++f )
+                if ( faces.test( f ) )
+                    calc.addTerrainTri( mesh.getTriPoints( f ), level );
+            return curr + calc.getVolume();
+        },
+        std::plus<double>() );
 }
 
 } //namespace MR
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "MRUnionFind.h"
+#include "MRParallelFor.h"
+#include <atomic>
+#include <vector>
+
+namespace MR
+{
+
+/**
+ * \brief Union find data structure permitting simultaneous unite() and find() calls from several threads
+ * \details The parent of each element is updated by compare-and-swap operations, find() performs path halving;
+ * the root of every set is always its smallest element, so the final partition and roots do not depend on the order of unions
+ * \tparam I is an id type, e.g. FaceId
+ * \ingroup BasicGroup
+ */
+template <typename I>
+class ConcurrentUnionFind
+{
+public:
+    ConcurrentUnionFind() = default;
+    explicit ConcurrentUnionFind( size_t size ) { reset( size ); }
+    auto size() const { return parents_.size(); }
+
+    /// reset parents to represent each element as disjoint set
+    void reset( size_t size )
+    {
+        parents_ = std::vector<std::atomic<I>>( size );
+        ParallelFor( I( size_t( 0 ) ), I( size ), [&]( I i )
+        {
+            parents_[i].store( i, std::memory_order_relaxed );
+        } );
+    }
+
+    /// unite two elements, thread-safe
+    /// \return true if the union was done, false if the elements were already united
+    bool unite( I first, I second )
+    {
+        for (;;)
+        {
+            first = find( first );
+            second = find( second );
+            if ( first == second )
+                return false;
+            // always link larger root to smaller root to avoid cycles
+            if ( second < first )
+                std::swap( first, second );
+            I expected = second;
+            if ( parents_[second].compare_exchange_strong( expected, first, std::memory_order_relaxed ) )
+                return true;
+            // somebody else has just linked second to another root, repeat the search
+        }
+    }
+
+    /// finds the root of the set containing given element, thread-safe
+    I find( I a )
+    {
+        for (;;)
+        {
+            I p = parents_[a].load( std::memory_order_relaxed );
+            if ( p == a )
+                return a;
+            I gp = parents_[p].load( std::memory_order_relaxed );
+            if ( gp == p )
+                return p;
+            // path halving: make a point to its grandparent, failure only means that other thread has updated the parent
+            parents_[a].compare_exchange_weak( p, gp, std::memory_order_relaxed );
+            a = gp;
+        }
+    }
+
+    /// returns true if given two elements are from one component, thread-safe only if no unite() is running in parallel
+    bool united( I first, I second ) { return find( first ) == find( second ); }
+
+    /// computes the root for each element in parallel; must be called when no unite() is running
+    Vector<I, I> roots()
+    {
+        Vector<I, I> res( parents_.size() );
+        ParallelFor( res, [&]( I i )
+        {
+            res[i] = find( i );
+        } );
+        return res;
+    }
+
+    /// converts this structure into ordinary UnionFind with the same sets; must be called when no unite() is running
+    UnionFind<I> toUnionFind() { return UnionFind<I>( roots() ); }
+
+private:
+    std::vector<std::atomic<I>> parents_;
+};
+
+}
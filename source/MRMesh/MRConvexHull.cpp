@@ -9,62 +9,74 @@
 #include "MRphmap.h"
 #include "MRMeshFixer.h"
 #include "MRHeap.h"
+#include "MRParallelFor.h"
+#include "MRBitSetParallelFor.h"
 #include "MRTimer.h"
+#include "MRPch/MRTBB.h"
 #include "MRTorus.h"
 #include "MRGTest.h"
 
 namespace MR
 {
 
-static VertId getMinXyzVertex( const VertCoords & points, const VertBitSet & validPoints )
+// the number of elementary operations, below which the computations are done in the calling thread,
+// since the creation of parallel tasks costs more than they can save
+constexpr size_t ParallelGrainSize = 1024;
+
+// among indices [0, size) for which valid(i) is true, finds the first one with the maximal value of key(i);
+// the computations are parallel for large sizes, but the result is the same as of sequential search
+template<typename Valid, typename Key>
+static size_t findFirstMaxIndex( size_t size, Valid && valid, Key && key )
 {
-    VertId res;
-    Vector3f p;
-    for ( VertId v : validPoints )
+    using K = decltype( key( size_t{} ) );
+    struct Best
     {
-        Vector3f t = points[v];
-        if ( !res || std::tie( t.x, t.y, t.z ) < std::tie( p.x, p.y, p.z ) )
-        {
-            res = v;
-            p = t;
-        }
-    }
+        size_t i = SIZE_MAX;
+        K k{};
+    };
+    // a must precede b in the sequence
+    auto better = []( const Best & a, const Best & b ) -> Best
+    {
+        if ( b.i == SIZE_MAX )
+            return a;
+        if ( a.i == SIZE_MAX )
+            return b;
+        return a.k < b.k ? b : a;
+    };
+    auto reduceRange = [&] ( const tbb::blocked_range<size_t> & range, Best curr )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            if ( valid( i ) )
+                curr = better( curr, Best{ i, key( i ) } );
+        return curr;
+    };
+    if ( size <= ParallelGrainSize )
+        return reduceRange( tbb::blocked_range<size_t>( 0, size ), Best{} ).i;
+    return tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, size, ParallelGrainSize ), Best{}, reduceRange, better ).i;
+}
 
-    return res;
+static VertId getMinXyzVertex( const VertCoords & points, const VertBitSet & validPoints )
+{
+    const auto i = findFirstMaxIndex( validPoints.size(),
+        [&]( size_t i ) { return validPoints.test( VertId( i ) ); },
+        [&]( size_t i ) { const auto & p = points[VertId( i )]; return std::make_tuple( -p.x, -p.y, -p.z ); } );
+    return i < validPoints.size() ? VertId( i ) : VertId();
 }
 
 static VertId getFurthestVertexFromPoint( const VertCoords & points, const VertBitSet & validPoints, const Vector3f & p )
 {
-    VertId res;
-    float maxDistSq = 0;
-    for ( VertId v : validPoints )
-    {
-        const auto distSq = ( points[v] - p ).lengthSq();
-        if ( !res || maxDistSq < distSq )
-        {
-            res = v;
-            maxDistSq = distSq;
-        }
-    }
-
-    return res;
+    const auto i = findFirstMaxIndex( validPoints.size(),
+        [&]( size_t i ) { return validPoints.test( VertId( i ) ); },
+        [&]( size_t i ) { return ( points[VertId( i )] - p ).lengthSq(); } );
+    return i < validPoints.size() ? VertId( i ) : VertId();
 }
 
 static VertId getFurthestVertexFromLine(  const VertCoords & points, const VertBitSet & validPoints, const Line3f & line )
 {
-    VertId res;
-    float maxDistSq = 0;
-    for ( VertId v : validPoints )
-    {
-        const auto distSq = line.distanceSq( points[v] );
-        if ( !res || maxDistSq < distSq )
-        {
-            res = v;
-            maxDistSq = distSq;
-        }
-    }
-
-    return res;
+    const auto i = findFirstMaxIndex( validPoints.size(),
+        [&]( size_t i ) { return validPoints.test( VertId( i ) ); },
+        [&]( size_t i ) { return line.distanceSq( points[VertId( i )] ); } );
+    return i < validPoints.size() ? VertId( i ) : VertId();
 }
 
 // return false if this must be flipped to restore model convexity
@@ -94,80 +106,77 @@ static void makeConvexOriginRing( Mesh & mesh, EdgeId e )
 
 const double NoDist = -1.0;
 
-Mesh makeConvexHull( const VertCoords & points, const VertBitSet & validPoints )
+// gets plane containing the face with normal looking outwards
+static Plane3d getPlane3d( const Mesh & hull, FaceId f )
 {
-    MR_TIMER
-    Mesh res;
-    if ( validPoints.count() < 3 )
-        return res;
-
-    const VertId v0 = getMinXyzVertex( points, validPoints );
-    const VertId v1 = getFurthestVertexFromPoint( points, validPoints, points[v0] );
-    const VertId v2 = getFurthestVertexFromLine( points, validPoints, Line3f{ points[v0], ( points[v1] - points[v0] ).normalized() } );
-
-    Triangulation t =
-    {
-        { 0_v, 1_v, 2_v },
-        { 0_v, 2_v, 1_v }
-    };
-    res.topology = MeshBuilder::fromTriangles( t );
-
-    res.points.push_back( points[v0] );
-    res.points.push_back( points[v1] );
-    res.points.push_back( points[v2] );
-
-    // face of res-mesh to original points above it
-    HashMap<FaceId, std::vector<VertId>> face2verts;
-    Heap<double, FaceId> queue{ 2, NoDist };
+    VertId a, b, c;
+    hull.topology.getTriVerts( f, a, b, c );
+    assert( a.valid() && b.valid() && c.valid() );
+    const Vector3d ap{ hull.points[a] };
+    const Vector3d bp{ hull.points[b] };
+    const Vector3d cp{ hull.points[c] };
+    return Plane3d::fromDirAndPt( cross( bp - ap, cp - ap ).normalized(), ap );
+}
 
-    // gets plane containing the face with normal looking outwards
-    auto getPlane3d = [&]( FaceId f )
-    {
-        VertId a, b, c;
-        res.topology.getTriVerts( f, a, b, c );
-        assert( a.valid() && b.valid() && c.valid() );
-        const Vector3d ap{ res.points[a] };
-        const Vector3d bp{ res.points[b] };
-        const Vector3d cp{ res.points[c] };
-        return Plane3d::fromDirAndPt( cross( bp - ap, cp - ap ).normalized(), ap );
-    };
+namespace
+{
 
-    // separate all remaining points as above face #0 or face #1
+struct FacePoints
+{
+    FaceId face; // of hull-mesh
+    Plane3d plane; // with normal outside
+    std::vector<VertId> verts; // above that face
+    double maxDist = NoDist;
+};
+
+// for each given vertex, finds the face where the vertex is above the most, and appends the vertex in its list;
+// the lists are filled in the order of given vertices
+void assignPointsToFaces( const VertCoords & points, const std::vector<VertId> & verts, VertId skipVert, std::vector<FacePoints> & fps )
+{
+    std::vector<int> bestFaces( verts.size() );
+    std::vector<double> bestDists( verts.size() );
+    auto findBestFace = [&]( size_t j )
     {
-        const auto pl0 = getPlane3d( 0_f );
-        std::vector<VertId> vs0, vs1;
-        double maxDist0 = NoDist, maxDist1 = NoDist;
-        for ( VertId v : validPoints )
+        int bestFace = -1;
+        double bestDist = 0;
+        if ( verts[j] != skipVert )
         {
-            if ( v == v0 || v == v1 || v == v2 )
-                continue;
-            const auto dist = pl0.distance( Vector3d{ points[v] } );
-            if ( dist >= 0 )
-            {
-                vs0.push_back( v );
-                maxDist0 = std::max( maxDist0, dist );
-            }
-            else
+            const Vector3d p{ points[verts[j]] };
+            for ( int i = 0; i < fps.size(); ++i )
             {
-                vs1.push_back( v );
-                maxDist1 = std::max( maxDist1, -dist );
+                const auto dist = fps[i].plane.distance( p );
+                if ( dist > bestDist )
+                {
+                    bestFace = i;
+                    bestDist = dist;
+                }
             }
         }
-        queue.setValue( 0_f, maxDist0 );
-        queue.setValue( 1_f, maxDist1 );
-        if ( !vs0.empty() )
-            face2verts[0_f] = std::move( vs0 );
-        if ( !vs1.empty() )
-            face2verts[1_f] = std::move( vs1 );
+        bestFaces[j] = bestFace;
+        bestDists[j] = bestDist;
+    };
+    // most face splits deal with few points, which are processed faster without parallel tasks
+    if ( verts.size() * fps.size() <= ParallelGrainSize )
+    {
+        for ( size_t j = 0; j < verts.size(); ++j )
+            findBestFace( j );
     }
+    else
+        ParallelFor( size_t( 0 ), verts.size(), findBestFace );
 
-    struct FacePoints
+    for ( size_t j = 0; j < verts.size(); ++j )
     {
-        FaceId face; // of res-mesh
-        Plane3d plane; // with normal outside
-        std::vector<VertId> verts; // above that face
-        double maxDist = NoDist;
-    };
+        const auto bestFace = bestFaces[j];
+        if ( bestFace < 0 )
+            continue;
+        fps[bestFace].verts.push_back( verts[j] );
+        fps[bestFace].maxDist = std::max( fps[bestFace].maxDist, bestDists[j] );
+    }
+}
+
+// grows given convex hull until all points from face2verts are inside it
+void growConvexHull( Mesh & res, const VertCoords & points, HashMap<FaceId, std::vector<VertId>> & face2verts, Heap<double, FaceId> & queue )
+{
     std::vector<FacePoints> newFp;
 
     while ( queue.top().val > NoDist )
@@ -188,23 +197,16 @@ Mesh makeConvexHull( const VertCoords & points, const VertBitSet & validPoints )
             continue;
         }
 
-        VertId topmostVert;
-        double maxDist = 0;
-        const auto pl = getPlane3d( myFace );
-        for ( auto v : myverts )
-        {
-            auto dist = pl.distance( Vector3d{ points[v] } );
-            if ( !topmostVert || dist > maxDist )
-            {
-                topmostVert = v;
-                maxDist = dist;
-            }
-        }
-        if ( !topmostVert )
+        const auto pl = getPlane3d( res, myFace );
+        const auto topmostIndex = findFirstMaxIndex( myverts.size(),
+            []( size_t ) { return true; },
+            [&]( size_t i ) { return pl.distance( Vector3d{ points[myverts[i]] } ); } );
+        if ( topmostIndex >= myverts.size() )
         {
             queue.setSmallerValue( myFace, NoDist );
             continue;
         }
+        const VertId topmostVert = myverts[topmostIndex];
         auto newv = res.splitFace( myFace, points[topmostVert] );
 
         makeConvexOriginRing( res, res.topology.edgeWithOrg( newv ) );
@@ -228,30 +230,10 @@ Mesh makeConvexHull( const VertCoords & points, const VertBitSet & validPoints )
             newFp.emplace_back();
             auto & x = newFp.back();
             x.face = res.topology.left( e );
-            x.plane = getPlane3d( x.face );
+            x.plane = getPlane3d( res, x.face );
         }
 
-        for ( auto v : myverts )
-        {
-            if ( v == topmostVert )
-                continue;
-            int bestFace = -1;
-            double bestDist = 0;
-            for ( int i = 0; i < newFp.size(); ++i )
-            {
-                const auto dist = newFp[i].plane.distance( Vector3d{ points[v] } );
-                if ( dist > bestDist )
-                {
-                    bestFace = i;
-                    bestDist = dist;
-                }
-            }
-            if ( bestFace >= 0 )
-            {
-                newFp[bestFace].verts.push_back( v );
-                newFp[bestFace].maxDist = std::max( newFp[bestFace].maxDist, bestDist );
-            }
-        }
+        assignPointsToFaces( points, myverts, topmostVert, newFp );
         for ( auto & x : newFp )
         {
             queue.setValue( x.face, x.maxDist );
@@ -280,10 +262,121 @@ Mesh makeConvexHull( const VertCoords & points, const VertBitSet & validPoints )
         if ( !allConvex )
             break;*/
     }
+}
+
+} // anonymous namespace
+
+Mesh makeConvexHull( const VertCoords & points, const VertBitSet & validPoints )
+{
+    MR_TIMER
+    Mesh res;
+    if ( validPoints.count() < 3 )
+        return res;
+
+    const VertId v0 = getMinXyzVertex( points, validPoints );
+    const VertId v1 = getFurthestVertexFromPoint( points, validPoints, points[v0] );
+    const VertId v2 = getFurthestVertexFromLine( points, validPoints, Line3f{ points[v0], ( points[v1] - points[v0] ).normalized() } );
+
+    Triangulation t =
+    {
+        { 0_v, 1_v, 2_v },
+        { 0_v, 2_v, 1_v }
+    };
+    res.topology = MeshBuilder::fromTriangles( t );
+
+    res.points.push_back( points[v0] );
+    res.points.push_back( points[v1] );
+    res.points.push_back( points[v2] );
+
+    // face of res-mesh to original points above it
+    HashMap<FaceId, std::vector<VertId>> face2verts;
+    Heap<double, FaceId> queue{ 2, NoDist };
+
+    // separate all remaining points as above face #0 or face #1
+    {
+        const auto pl0 = getPlane3d( res, 0_f );
+        Vector<double, VertId> dists( validPoints.size() );
+        BitSetParallelFor( validPoints, [&]( VertId v )
+        {
+            dists[v] = pl0.distance( Vector3d{ points[v] } );
+        } );
+        std::vector<VertId> vs0, vs1;
+        double maxDist0 = NoDist, maxDist1 = NoDist;
+        for ( VertId v : validPoints )
+        {
+            if ( v == v0 || v == v1 || v == v2 )
+                continue;
+            const auto dist = dists[v];
+            if ( dist >= 0 )
+            {
+                vs0.push_back( v );
+                maxDist0 = std::max( maxDist0, dist );
+            }
+            else
+            {
+                vs1.push_back( v );
+                maxDist1 = std::max( maxDist1, -dist );
+            }
+        }
+        queue.setValue( 0_f, maxDist0 );
+        queue.setValue( 1_f, maxDist1 );
+        if ( !vs0.empty() )
+            face2verts[0_f] = std::move( vs0 );
+        if ( !vs1.empty() )
+            face2verts[1_f] = std::move( vs1 );
+    }
 
+    growConvexHull( res, points, face2verts, queue );
     return res;
 }
 
+void addToConvexHull( Mesh & hull, const VertCoords & points, const VertBitSet & validPoints )
+{
+    MR_TIMER
+    if ( !hull.topology.numValidFaces() )
+    {
+        // no hull yet, build it from both its vertices and given points
+        VertCoords allPoints = hull.points;
+        VertBitSet allValid = hull.topology.getValidVerts();
+        allValid.resize( allPoints.size() + validPoints.size() );
+        allPoints.resize( allPoints.size() + validPoints.size() );
+        for ( auto v : validPoints )
+        {
+            const auto nv = VertId( hull.points.size() + v );
+            allPoints[nv] = points[v];
+            allValid.set( nv );
+        }
+        hull = makeConvexHull( allPoints, allValid );
+        return;
+    }
+
+    std::vector<FacePoints> fps;
+    for ( auto f : hull.topology.getValidFaces() )
+    {
+        fps.emplace_back();
+        fps.back().face = f;
+        fps.back().plane = getPlane3d( hull, f );
+    }
+
+    std::vector<VertId> verts;
+    verts.reserve( validPoints.count() );
+    for ( auto v : validPoints )
+        verts.push_back( v );
+    assignPointsToFaces( points, verts, {}, fps );
+
+    HashMap<FaceId, std::vector<VertId>> face2verts;
+    Heap<double, FaceId> queue{ hull.topology.faceSize(), NoDist };
+    for ( auto & x : fps )
+    {
+        if ( x.verts.empty() )
+            continue;
+        queue.setValue( x.face, x.maxDist );
+        face2verts[x.face] = std::move( x.verts );
+    }
+
+    growConvexHull( hull, points, face2verts, queue );
+}
+
 Mesh makeConvexHull( const Mesh & in )
 {
     return makeConvexHull( in.points, in.topology.getValidVerts() );
@@ -301,6 +394,17 @@ TEST( MRMesh, ConvexHull )
     EXPECT_EQ( discus.topology.numValidVerts(), 144 );
     EXPECT_EQ( discus.topology.numValidFaces(), 284 );
     EXPECT_EQ( discus.topology.lastNotLoneEdge(), EdgeId( 426 * 2 - 1 ) );
+
+    // build the same hull incrementally from two halves of torus vertices
+    VertBitSet firstHalf( torus.points.size() ), secondHalf( torus.points.size() );
+    for ( auto v : torus.topology.getValidVerts() )
+        ( v < torus.points.size() / 2 ? firstHalf : secondHalf ).set( v );
+    Mesh hull = makeConvexHull( torus.points, firstHalf );
+    EXPECT_LT( hull.topology.numValidVerts(), 144 );
+    addToConvexHull( hull, torus.points, secondHalf );
+    EXPECT_EQ( hull.topology.numValidVerts(), 144 );
+    EXPECT_EQ( hull.topology.numValidFaces(), 284 );
+    EXPECT_NEAR( hull.volume(), discus.volume(), 1e-5f );
 }
 
 } //namespace MR
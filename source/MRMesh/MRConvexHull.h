@@ -10,4 +10,7 @@ MRMESH_API Mesh makeConvexHull( const VertCoords & points, const VertBitSet & va
 MRMESH_API Mesh makeConvexHull( const Mesh & in );
 MRMESH_API Mesh makeConvexHull( const PointCloud & in );
 
+// extends given convex hull mesh to also contain given input points, which are ignored if they are already inside the hull
+MRMESH_API void addToConvexHull( Mesh & hull, const VertCoords & points, const VertBitSet & validPoints );
+
 } //namespace MR
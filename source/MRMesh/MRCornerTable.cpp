@@ -0,0 +1,215 @@
+#include "MRCornerTable.h"
+#include "MRMeshTopology.h"
+#include "MRMeshBuilder.h"
+#include "MRRingIterator.h"
+#include "MRBitSetParallelFor.h"
+#include "MRConcurrentUnionFind.h"
+#include "MRHeapBytes.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRTorus.h"
+#include "MRMesh.h"
+#include "MRMeshNormals.h"
+
+namespace MR
+{
+
+namespace
+{
+
+// returns the index of given edge in the left ring of its face, starting from topology.edgeWithLeft( left( e ) );
+// the edge with index j starts in j-th vertex of the triangle
+int indexInLeftTri( const MeshTopology & topology, EdgeId e )
+{
+    int j = 0;
+    for ( auto ej = topology.edgeWithLeft( topology.left( e ) ); ej != e; ej = topology.prev( ej.sym() ) )
+    {
+        ++j;
+        assert( j < 3 );
+    }
+    return j;
+}
+
+} // anonymous namespace
+
+CornerTable CornerTable::fromTopology( const MeshTopology & topology )
+{
+    MR_TIMER
+    CornerTable res;
+    res.validFaces_ = topology.getValidFaces();
+    res.validVerts_ = topology.getValidVerts();
+    res.tris_.resize( topology.faceSize() );
+    res.opposite_.resize( 3 * topology.faceSize(), -1 );
+    res.vertCorner_.resize( topology.vertSize(), -1 );
+
+    BitSetParallelFor( res.validFaces_, [&]( FaceId f )
+    {
+        assert( topology.isLeftTri( topology.edgeWithLeft( f ) ) );
+        auto e = topology.edgeWithLeft( f );
+        for ( int j = 0; j < 3; ++j )
+        {
+            res.tris_[f][j] = topology.org( e );
+            // the edge starting in j-th vertex is opposite to the corner (j+2)%3
+            if ( auto g = topology.right( e ) )
+                res.opposite_[3 * f + ( j + 2 ) % 3] = 3 * g + ( indexInLeftTri( topology, e.sym() ) + 2 ) % 3;
+            e = topology.prev( e.sym() );
+        }
+    } );
+
+    BitSetParallelFor( res.validVerts_, [&]( VertId v )
+    {
+        EdgeId first;
+        for ( auto e : orgRing( topology, v ) )
+        {
+            if ( !topology.left( e ) )
+                continue;
+            if ( !first )
+                first = e;
+            if ( !topology.right( e ) )
+            {
+                // boundary vertex: start from the most clock wise triangle
+                first = e;
+                break;
+            }
+        }
+        if ( first )
+            res.vertCorner_[v] = 3 * topology.left( first ) + indexInLeftTri( topology, first );
+    } );
+
+    // exclude the vertices without triangles
+    for ( auto v : topology.getValidVerts() )
+        if ( res.vertCorner_[v] < 0 )
+            res.validVerts_.reset( v );
+
+    return res;
+}
+
+MeshTopology CornerTable::toTopology() const
+{
+    MR_TIMER
+    auto region = validFaces_;
+    MeshBuilder::BuildSettings settings;
+    settings.region = &region;
+    return MeshBuilder::fromTriangles( tris_, settings );
+}
+
+size_t CornerTable::heapBytes() const
+{
+    return tris_.heapBytes()
+        + MR::heapBytes( opposite_ )
+        + vertCorner_.heapBytes()
+        + validFaces_.heapBytes()
+        + validVerts_.heapBytes();
+}
+
+FaceNormals computePerFaceNormals( const CornerTable & table, const VertCoords & points )
+{
+    MR_TIMER
+    FaceNormals res( table.faceSize() );
+    BitSetParallelFor( table.getValidFaces(), [&]( FaceId f )
+    {
+        const auto & t = table.getTriVerts( f );
+        const auto & ap = points[t[0]];
+        res[f] = cross( points[t[1]] - ap, points[t[2]] - ap ).normalized();
+    } );
+    return res;
+}
+
+VertNormals computePerVertNormals( const CornerTable & table, const VertCoords & points )
+{
+    MR_TIMER
+    VertNormals res( table.vertSize() );
+    BitSetParallelFor( table.getValidVerts(), [&]( VertId v )
+    {
+        Vector3f sum;
+        table.forEachCorner( v, [&]( int c )
+        {
+            const auto & t = table.getTriVerts( CornerTable::face( c ) );
+            const auto & ap = points[t[0]];
+            sum += cross( points[t[1]] - ap, points[t[2]] - ap );
+        } );
+        res[v] = sum.normalized();
+    } );
+    return res;
+}
+
+std::pair<Face2RegionMap, int> getAllComponentsMap( const CornerTable & table )
+{
+    MR_TIMER
+    ConcurrentUnionFind<FaceId> unionFind( table.faceSize() );
+    BitSetParallelFor( table.getValidFaces(), [&]( FaceId f )
+    {
+        for ( int j = 0; j < 3; ++j )
+        {
+            const auto o = table.opposite( 3 * f + j );
+            if ( o > 3 * f + j ) // process each internal edge once
+                unionFind.unite( f, CornerTable::face( o ) );
+        }
+    } );
+
+    Face2RegionMap res( table.faceSize() );
+    const auto roots = unionFind.roots();
+    constexpr RegionId unsetRegion( -1 );
+    Vector<RegionId, FaceId> root2region( table.faceSize(), unsetRegion );
+    int n = 0;
+    for ( auto f : table.getValidFaces() )
+    {
+        auto & r = root2region[roots[f]];
+        if ( r == unsetRegion )
+            r = RegionId( n++ );
+        res[f] = r;
+    }
+    return { std::move( res ), n };
+}
+
+TEST( MRMesh, CornerTable )
+{
+    auto mesh = makeTorus();
+    // make some boundary
+    FaceBitSet del;
+    for ( auto e : orgRing( mesh.topology, 0_v ) )
+        del.autoResizeSet( mesh.topology.left( e ) );
+    mesh.topology.deleteFaces( del );
+
+    const auto table = CornerTable::fromTopology( mesh.topology );
+    EXPECT_LT( 2 * table.heapBytes(), mesh.topology.heapBytes() );
+    EXPECT_EQ( table.getValidFaces(), mesh.topology.getValidFaces() );
+    EXPECT_EQ( table.getValidVerts(), mesh.topology.getValidVerts() );
+    for ( auto f : mesh.topology.getValidFaces() )
+        EXPECT_EQ( table.getTriVerts( f ), mesh.topology.getTriVerts( f ) );
+
+    for ( auto v : mesh.topology.getValidVerts() )
+    {
+        int numCorners = 0;
+        table.forEachCorner( v, [&]( int c )
+        {
+            EXPECT_EQ( table.vert( c ), v );
+            ++numCorners;
+        } );
+        EXPECT_EQ( numCorners, mesh.topology.getVertDegree( v ) - ( mesh.topology.isBdVertex( v ) ? 1 : 0 ) );
+    }
+
+    for ( int c = 0; c < table.cornerSize(); ++c )
+    {
+        if ( !table.hasFace( CornerTable::face( c ) ) )
+            continue;
+        const auto o = table.opposite( c );
+        if ( o < 0 )
+            continue;
+        EXPECT_EQ( table.opposite( o ), c );
+        EXPECT_EQ( table.vert( CornerTable::next( c ) ), table.vert( CornerTable::prev( o ) ) );
+    }
+
+    const auto vertNormals = computePerVertNormals( table, mesh.points );
+    for ( auto v : mesh.topology.getValidVerts() )
+        EXPECT_NEAR( ( vertNormals[v] - mesh.normal( v ) ).length(), 0.0f, 1e-5f );
+
+    const auto [map, numComps] = getAllComponentsMap( table );
+    EXPECT_EQ( numComps, 1 );
+
+    const auto topology = table.toTopology();
+    EXPECT_EQ( topology.getValidFaces(), mesh.topology.getValidFaces() );
+    EXPECT_EQ( topology.findHoleRepresentiveEdges().size(), 1 );
+}
+
+} // namespace MR
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRVector.h"
+#include "MRBitSet.h"
+#include "MRId.h"
+
+namespace MR
+{
+
+/// \defgroup CornerTableGroup Corner Table
+/// \ingroup MeshGroup
+/// \{
+
+/// compact read-only representation of triangular mesh topology:
+/// three vertices and three opposite corners are stored per triangle, and one corner per vertex,
+/// previous/next corners and twins of the edges are implicit;
+/// it takes about 2x less memory than MeshTopology, so it is convenient for storing frozen meshes;
+/// corner c = 3 * f + i refers to i-th vertex of the triangle f;
+/// only the algorithms declared below (normals and connected components) work directly on the table,
+/// the algorithms requiring half-edges or edge ids in their results (AABBTree, findProjection, MeshSave, etc.)
+/// need MeshTopology restored by toTopology()
+class CornerTable
+{
+public:
+    CornerTable() = default;
+
+    /// builds the table from given topology, all valid faces of which must be triangles
+    [[nodiscard]] MRMESH_API static CornerTable fromTopology( const MeshTopology & topology );
+
+    /// restores half-edge topology with the same vertex and face ids
+    [[nodiscard]] MRMESH_API MeshTopology toTopology() const;
+
+    /// returns the number of face records including invalid ones
+    [[nodiscard]] size_t faceSize() const { return tris_.size(); }
+
+    /// returns the number of vertex records including invalid ones
+    [[nodiscard]] size_t vertSize() const { return vertCorner_.size(); }
+
+    /// returns the number of corner records, which is three times the number of face records
+    [[nodiscard]] int cornerSize() const { return int( opposite_.size() ); }
+
+    /// returns true if given face has triangle in the table
+    [[nodiscard]] bool hasFace( FaceId f ) const { return f.valid() && f < (int)faceSize() && validFaces_.test( f ); }
+
+    /// returns true if given vertex belongs to at least one triangle
+    [[nodiscard]] bool hasVert( VertId v ) const { return v.valid() && v < (int)vertSize() && vertCorner_[v] >= 0; }
+
+    /// returns all valid faces
+    [[nodiscard]] const FaceBitSet & getValidFaces() const { return validFaces_; }
+
+    /// returns all valid vertices
+    [[nodiscard]] const VertBitSet & getValidVerts() const { return validVerts_; }
+
+    /// returns three vertices of given triangle in the same order as MeshTopology::getTriVerts
+    [[nodiscard]] const ThreeVertIds & getTriVerts( FaceId f ) const { return tris_[f]; }
+
+    /// returns all triangles, invalid faces have invalid vertices
+    [[nodiscard]] const Triangulation & getTriangulation() const { return tris_; }
+
+    /// the face of given corner
+    [[nodiscard]] static FaceId face( int c ) { return FaceId( c / 3 ); }
+
+    /// next corner in the same triangle (counter clock wise)
+    [[nodiscard]] static int next( int c ) { return c % 3 == 2 ? c - 2 : c + 1; }
+
+    /// previous corner in the same triangle (clock wise)
+    [[nodiscard]] static int prev( int c ) { return c % 3 == 0 ? c + 2 : c - 1; }
+
+    /// the vertex of given corner
+    [[nodiscard]] VertId vert( int c ) const { return tris_[face( c )][c % 3]; }
+
+    /// the corner in the neighbor triangle sharing the edge opposite to given corner, or -1 if that edge is on the boundary
+    [[nodiscard]] int opposite( int c ) const { return opposite_[c]; }
+
+    /// the first corner of given vertex, such that swinging from it counter clock wise visits all triangles around the vertex;
+    /// for a boundary vertex it is the most clock wise corner; -1 for invalid vertex;
+    /// if the vertex has several boundary gaps then only one fan of its triangles is reachable from this corner
+    [[nodiscard]] int vertCorner( VertId v ) const { return vertCorner_[v]; }
+
+    /// next corner of the same vertex in counter clock wise direction, or -1 if the boundary is reached
+    [[nodiscard]] int swingCCW( int c ) const { const auto o = opposite_[next( c )]; return o >= 0 ? next( o ) : -1; }
+
+    /// next corner of the same vertex in clock wise direction, or -1 if the boundary is reached
+    [[nodiscard]] int swingCW( int c ) const { const auto o = opposite_[prev( c )]; return o >= 0 ? prev( o ) : -1; }
+
+    /// returns true if the edge opposite to given corner is on the boundary
+    [[nodiscard]] bool isBdCorner( int c ) const { return opposite_[c] < 0; }
+
+    /// calls given function for every corner of vertex v in counter clock wise order
+    template<typename F>
+    void forEachCorner( VertId v, F && f ) const;
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] MRMESH_API size_t heapBytes() const;
+
+private:
+    Triangulation tris_;
+    std::vector<int> opposite_;
+    Vector<int, VertId> vertCorner_;
+    FaceBitSet validFaces_;
+    VertBitSet validVerts_;
+};
+
+template<typename F>
+void CornerTable::forEachCorner( VertId v, F && f ) const
+{
+    const auto c0 = vertCorner_[v];
+    if ( c0 < 0 )
+        return;
+    auto c = c0;
+    do
+    {
+        f( c );
+        c = swingCCW( c );
+    } while ( c >= 0 && c != c0 );
+}
+
+/// returns a vector with face-normal in every element for valid faces
+[[nodiscard]] MRMESH_API FaceNormals computePerFaceNormals( const CornerTable & table, const VertCoords & points );
+
+/// returns a vector with vertex normals in every element for valid vertices
+[[nodiscard]] MRMESH_API VertNormals computePerVertNormals( const CornerTable & table, const VertCoords & points );
+
+/// returns the map from every valid face to its connected component (components are connected via shared edges), and the number of components
+[[nodiscard]] MRMESH_API std::pair<Face2RegionMap, int> getAllComponentsMap( const CornerTable & table );
+
+/// \}
+
+} // namespace MR
@@ -293,21 +293,31 @@ DistanceMap computeDistanceMap_( const MeshPart& mp, const MeshToDistanceMapPara
         outSamples->clear();
         outSamples->resize( size_t( params.resolution.x ) * params.resolution.y );
     }
+    const Vector3<T> dir( params.direction );
     if ( !ParallelFor( 0, params.resolution.y, [&]( int y )
     {
-        for ( int x = 0; x < params.resolution.x; ++x )
+        // all rays are parallel, so neighbor pixels of a row are processed in packets sharing AABB tree traversal
+        Vector3<T> rayOris[RayPacketSize];
+        MeshIntersectionResult packetRes[RayPacketSize];
+        for ( int x0 = 0; x0 < params.resolution.x; x0 += RayPacketSize )
         {
-            Vector3<T> rayOri = Vector3<T>( ori ) +
-                Vector3<T>( params.xRange ) * ( ( T( x ) + T( 0.5 ) ) * xStep_1 ) +
-                Vector3<T>( params.yRange ) * ( ( T( y ) + T( 0.5 ) ) * yStep_1 );
-            if ( auto meshIntersectionRes = rayMeshIntersect( mp, Line3<T>( Vector3<T>( rayOri ), Vector3<T>( params.direction ) ),
-                -std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), &prec ) )
+            const int n = std::min( RayPacketSize, params.resolution.x - x0 );
+            for ( int j = 0; j < n; ++j )
+                rayOris[j] = Vector3<T>( ori ) +
+                    Vector3<T>( params.xRange ) * ( ( T( x0 + j ) + T( 0.5 ) ) * xStep_1 ) +
+                    Vector3<T>( params.yRange ) * ( ( T( y ) + T( 0.5 ) ) * yStep_1 );
+            rayPacketMeshIntersect( mp, rayOris, n, dir, packetRes,
+                -std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), &prec );
+            for ( int j = 0; j < n; ++j )
             {
+                const auto & meshIntersectionRes = packetRes[j];
+                if ( !meshIntersectionRes )
+                    continue;
                 if ( !params.useDistanceLimits
                     || ( meshIntersectionRes.distanceAlongLine < params.minValue )
                     || ( meshIntersectionRes.distanceAlongLine > params.maxValue ) )
                 {
-                    const auto i = distMap.toIndex( { x, y } );
+                    const auto i = distMap.toIndex( { x0 + j, y } );
                     distMap.set( i, meshIntersectionRes.distanceAlongLine );
                     if ( outSamples )
                         (*outSamples)[i] = meshIntersectionRes.mtp;
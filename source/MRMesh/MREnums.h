@@ -38,7 +38,8 @@ enum class OffsetMode : int
 {
     Smooth,     ///< create mesh using dual marching cubes from OpenVDB library
     Standard,   ///< create mesh using standard marching cubes implemented in MeshLib
-    Sharpening  ///< create mesh using standard marching cubes with additional sharpening implemented in MeshLib
+    Sharpening, ///< create mesh using standard marching cubes with additional sharpening implemented in MeshLib
+    DualContouring ///< create mesh using adaptive dual contouring implemented in MeshLib, which preserves sharp features and produces fewer triangles on flat regions
 };
 
 } //namespace MR
@@ -3,7 +3,12 @@
 #include "MREdgeIterator.h"
 #include "MRRingIterator.h"
 #include "MRBitSet.h"
+#include "MRParallelFor.h"
 #include "MRTimer.h"
+#include "MRTorus.h"
+#include "MRMesh.h"
+#include "MRGTest.h"
+#include <algorithm>
 #include <cfloat>
 #include <deque>
 
@@ -15,6 +20,13 @@ static constexpr int Right = 1;
 
 static constexpr float ContourEdge = FLT_MAX;
 
+// the graph is split on at most this number of face spans, which are processed in parallel first,
+// and then merged pairwise until the whole graph is processed at once
+static constexpr int MaxSpans = 64;
+
+// the spans are not made smaller than this number of faces
+static constexpr int MinFacesInSpan = 8192;
+
 class GraphCut
 {
 public:
@@ -24,19 +36,33 @@ public:
     FaceBitSet fill();
 
 private:
+    // the state of max-flow computation in the range of faces [begin, end);
+    // the faces outside of the span are neither read nor modified, so the contexts with not-overlapping spans can be processed in parallel
+    struct Context
+    {
+        FaceId begin, end;
+        std::deque<FaceId> active[2];
+        std::vector<FaceId> orphans;
+        // the faces from the trees, which neighbors outside of the span were skipped during processing
+        std::vector<FaceId> boundary;
+
+        bool contains( FaceId f ) const { return f >= begin && f < end; }
+    };
+
     const MeshTopology & topology_;
     Vector<float, EdgeId> capacity_; // residual capacity of dual edge from left to right
     FaceBitSet filled_[2];
     Vector<EdgeId, FaceId> parent_;  // edge having parent to the right and this face to the left, invalid edge for root faces
-    std::deque<FaceId> active_[2];
-    std::vector<FaceId> orphans_;
+    std::vector<FaceId> seeds_[2];   // initially active faces
 
+    // grows the trees and augments the paths inside the span of given context, until one of the trees cannot grow anymore
+    void segment_( Context & context );
     // process given active face which should belong to given side (left or right)
-    void processActive_( FaceId f, int side );
+    void processActive_( Context & context, FaceId f, int side );
     // augment the path joined at edge e
-    void augment_( EdgeId e );
-    // adapt orphans_ from given side
-    void adapt_( int side );
+    void augment_( Context & context, EdgeId e );
+    // adapt context.orphans from given side
+    void adapt_( Context & context, int side );
     // tests whether grand is a grandparent of child
     bool isGrandparent_( FaceId child, FaceId grand ) const;
     // checks that there is not saturated path from f to a root
@@ -73,14 +99,14 @@ void GraphCut::addContour( const EdgePath & contour )
         if ( l )
         {
             if ( !filled_[Left].test_set( l ) )
-                active_[Left].push_back( l );
+                seeds_[Left].push_back( l );
         }
 
         auto r = topology_.right( e );
         if ( r )
         {
             if ( !filled_[Right].test_set( r ) )
-                active_[Right].push_back( r );
+                seeds_[Right].push_back( r );
         }
     }
 
@@ -95,10 +121,10 @@ void GraphCut::addFaces( const FaceBitSet& source, const FaceBitSet& sink )
 
     auto unionFilled = filled_[Left] | filled_[Right];
     for ( auto f : source - unionFilled )
-        active_[Left].push_back( f );
+        seeds_[Left].push_back( f );
 
     for ( auto f : sink - unionFilled )
-        active_[Right].push_back( f );
+        seeds_[Right].push_back( f );
 
     filled_[Left] |= source;
     filled_[Right] |= sink;
@@ -111,24 +137,81 @@ void GraphCut::addFaces( const FaceBitSet& source, const FaceBitSet& sink )
 FaceBitSet GraphCut::fill()
 {
     MR_TIMER
-    while ( !active_[Left].empty() && !active_[Right].empty() )
+
+    const int szF = (int)parent_.size();
+    int numSpans = 1;
+    while ( numSpans < MaxSpans && 2 * numSpans * MinFacesInSpan <= szF )
+        numSpans *= 2;
+    // parallel threads shall be able to safely modify elements in bit-sets
+    const int facesPerSpan = ( szF / ( numSpans * (int)FaceBitSet::bits_per_block ) ) * (int)FaceBitSet::bits_per_block;
+
+    std::vector<Context> spans( numSpans );
+    for ( int i = 0; i < numSpans; ++i )
+    {
+        spans[i].begin = FaceId( i * facesPerSpan );
+        spans[i].end = i + 1 < numSpans ? FaceId( ( i + 1 ) * facesPerSpan ) : FaceId( szF );
+    }
+    for ( int side : { Left, Right } )
     {
-        auto lf = active_[Left].front();
-        active_[Left].pop_front();
-        processActive_( lf, Left );
+        for ( auto f : seeds_[side] )
+            spans[facesPerSpan > 0 ? std::min( (int)f / facesPerSpan, numSpans - 1 ) : 0].active[side].push_back( f );
+        seeds_[side] = {};
+    }
 
-        auto rf = active_[Right].front();
-        active_[Right].pop_front();
-        processActive_( rf, Right );
+    for ( ;; )
+    {
+        ParallelFor( spans, [&]( size_t i )
+        {
+            segment_( spans[i] );
+        } );
+        if ( spans.size() <= 1 )
+            break;
+
+        // join each pair of neighbor spans, and activate the faces which skipped the neighbors from the other span of the pair
+        ParallelFor( size_t( 0 ), spans.size() / 2, [&]( size_t i )
+        {
+            auto & c0 = spans[2 * i];
+            auto & c1 = spans[2 * i + 1];
+            assert( c0.end == c1.begin );
+            c0.end = c1.end;
+            for ( int side : { Left, Right } )
+                c0.active[side].insert( c0.active[side].end(), c1.active[side].begin(), c1.active[side].end() );
+            c0.boundary.insert( c0.boundary.end(), c1.boundary.begin(), c1.boundary.end() );
+            for ( auto f : c0.boundary )
+            {
+                if ( filled_[Left].test( f ) )
+                    c0.active[Left].push_back( f );
+                else if ( filled_[Right].test( f ) )
+                    c0.active[Right].push_back( f );
+            }
+            c0.boundary.clear();
+        } );
+        for ( size_t i = 1; i < spans.size() / 2; ++i )
+            spans[i] = std::move( spans[2 * i] );
+        spans.resize( spans.size() / 2 );
     }
 
-    if ( active_[Right].empty() )
+    if ( spans[0].active[Right].empty() )
         return topology_.getValidFaces() - filled_[Right];
 
     return filled_[Left];
 }
 
-void GraphCut::processActive_( FaceId f, int side )
+void GraphCut::segment_( Context & context )
+{
+    while ( !context.active[Left].empty() && !context.active[Right].empty() )
+    {
+        auto lf = context.active[Left].front();
+        context.active[Left].pop_front();
+        processActive_( context, lf, Left );
+
+        auto rf = context.active[Right].front();
+        context.active[Right].pop_front();
+        processActive_( context, rf, Right );
+    }
+}
+
+void GraphCut::processActive_( Context & context, FaceId f, int side )
 {
     if ( !filled_[side].test( f ) )
         return; // face has changed the side since the moment it was put in the queue
@@ -137,6 +220,7 @@ void GraphCut::processActive_( FaceId f, int side )
     auto parent = parent_[f];
     assert( !parent || topology_.left( parent ) == f );
 
+    bool skipped = false;
     for ( EdgeId e : leftRing( topology_, f ) )
     {
         if ( e == parent || capacity_[e] == ContourEdge )
@@ -144,9 +228,17 @@ void GraphCut::processActive_( FaceId f, int side )
         auto r = topology_.right( e );
         if ( !r )
             continue;
+        if ( !context.contains( r ) )
+        {
+            // the face will be activated again after joining with the span of r
+            if ( !skipped )
+                context.boundary.push_back( f );
+            skipped = true;
+            continue;
+        }
         if ( filled_[1 - side].test( r ) )
         {
-            augment_( side ? e.sym() : e );
+            augment_( context, side ? e.sym() : e );
             if ( !filled_[side].test( f ) )
                 return; // face has changed the side during augmentation
         }
@@ -155,12 +247,12 @@ void GraphCut::processActive_( FaceId f, int side )
             filled_[side].set( r );
             parent_[r] = e.sym();
             assert( checkNotSaturatedPath_( r, side ) );
-            active_[side].push_back( r );
+            context.active[side].push_back( r );
         }
     }
 }
 
-void GraphCut::augment_( EdgeId e )
+void GraphCut::augment_( Context & context, EdgeId e )
 {
     auto l = topology_.left( e );
     auto r = topology_.right( e );
@@ -203,7 +295,7 @@ void GraphCut::augment_( EdgeId e )
         capacity_[e] -= minResidualCapacity;
         capacity_[e.sym()] += minResidualCapacity;
 
-        assert( orphans_.empty() );
+        assert( context.orphans.empty() );
         for ( auto f = l;; )
         {
             auto parent = parent_[f];
@@ -213,14 +305,14 @@ void GraphCut::augment_( EdgeId e )
             capacity_[parent] += minResidualCapacity;
             if ( ( capacity_[parent.sym()] -= minResidualCapacity ) == 0 )
             {
-                orphans_.push_back( f );
+                context.orphans.push_back( f );
                 parent_[f] = EdgeId{};
             }
             f = topology_.right( parent );
         }
-        adapt_( Left );
+        adapt_( context, Left );
 
-        assert( orphans_.empty() );
+        assert( context.orphans.empty() );
         for ( auto f = r;; )
         {
             auto parent = parent_[f];
@@ -230,37 +322,37 @@ void GraphCut::augment_( EdgeId e )
             capacity_[parent.sym()] += minResidualCapacity;
             if ( ( capacity_[parent] -= minResidualCapacity ) == 0 )
             {
-                orphans_.push_back( f );
+                context.orphans.push_back( f );
                 parent_[f] = EdgeId{};
             }
             f = topology_.right( parent );
         }
-        adapt_( Right );
+        adapt_( context, Right );
 
         if ( !filled_[Left].test( l ) || !filled_[Right].test( r ) )
             break;
     }
 }
 
-void GraphCut::adapt_( int side )
+void GraphCut::adapt_( Context & context, int side )
 {
-    while ( !orphans_.empty() )
+    while ( !context.orphans.empty() )
     {
-        auto f = orphans_.back();
-        orphans_.pop_back();
+        auto f = context.orphans.back();
+        context.orphans.pop_back();
         if ( !filled_[side].test( f ) )
             continue;
         parent_[f] = EdgeId();
         for ( EdgeId e : leftRing( topology_, f ) )
         {
             auto r = topology_.right( e );
-            if ( !r || !filled_[side].test( r ) )
+            if ( !r || !context.contains( r ) || !filled_[side].test( r ) )
                 continue;
             auto cap = capacity_[side == Right ? e : e.sym()];
             if ( cap > 0 )
             {
                 if ( isGrandparent_( r, f ) )
-                    active_[side].push_front( r );
+                    context.active[side].push_front( r );
                 else
                 {
                     parent_[f] = e;
@@ -276,19 +368,19 @@ void GraphCut::adapt_( int side )
             for ( EdgeId e : leftRing( topology_, f ) )
             {
                 auto r = topology_.right( e );
-                if ( !r )
+                if ( !r || !context.contains( r ) )
                     continue;
                 if ( e.sym() == parent_[r] )
                 {
                     assert( filled_[side].test( r ) );
                     parent_[r] = EdgeId();
-                    orphans_.push_back( r );
+                    context.orphans.push_back( r );
                 }
                 if ( filled_[1 - side].test( r ) )
                 {
                     auto cap = capacity_[side == Left ? e : e.sym()];
                     if ( cap > 0 )
-                        active_[1 - side].push_front( r );
+                        context.active[1 - side].push_front( r );
                 }
             }
         }
@@ -351,4 +443,56 @@ FaceBitSet segmentByGraphCut( const MeshTopology& topology, const FaceBitSet& so
     return filler.fill();
 }
 
+TEST( MRMesh, FillContourByGraphCut )
+{
+    // the faces of the torus are numbered along secondary direction, so each contour of constant primary angle crosses all spans
+    const int primaryRes = 64, secondaryRes = 1024;
+    auto mesh = makeTorus( 1.0f, 0.1f, primaryRes, secondaryRes );
+    const auto & topology = mesh.topology;
+    EXPECT_GT( topology.numValidFaces(), 2 * MinFacesInSpan );
+
+    auto vert = [&]( int i, int j ) { return VertId( ( i % secondaryRes ) * primaryRes + j ); };
+    std::vector<EdgePath> contours( 2 );
+    for ( int i = 0; i < secondaryRes; ++i )
+    {
+        contours[0].push_back( topology.findEdge( vert( i, 0 ), vert( i + 1, 0 ) ) );
+        contours[1].push_back( topology.findEdge( vert( i + 1, primaryRes / 2 ), vert( i, primaryRes / 2 ) ) );
+    }
+    for ( const auto & c : contours )
+        for ( auto e : c )
+            ASSERT_TRUE( e.valid() );
+
+    // the metric prefers any other cut, but the contours are not crossable
+    auto filled = fillContourLeftByGraphCut( topology, contours, []( EdgeId ) { return 1.0f; } );
+    EXPECT_EQ( filled.count(), topology.numValidFaces() / 2 );
+    for ( auto f : filled )
+    {
+        for ( auto e : leftRing( topology, f ) )
+        {
+            if ( auto r = topology.right( e ); r && !filled.test( r ) )
+            {
+                EXPECT_TRUE( std::find( contours[0].begin(), contours[0].end(), e ) != contours[0].end()
+                          || std::find( contours[1].begin(), contours[1].end(), e ) != contours[1].end() );
+            }
+        }
+    }
+
+    // source and sink seeds in opposite halves of the torus: the minimal cut consists of two contours of constant primary angle
+    FaceBitSet source( topology.faceSize() ), sink( topology.faceSize() );
+    for ( int i = 0; i < secondaryRes; ++i )
+    {
+        source.set( topology.left( topology.findEdge( vert( i, primaryRes / 4 ), vert( i + 1, primaryRes / 4 ) ) ) );
+        sink.set( topology.left( topology.findEdge( vert( i, 3 * primaryRes / 4 ), vert( i + 1, 3 * primaryRes / 4 ) ) ) );
+    }
+    auto segment = segmentByGraphCut( topology, source, sink, []( EdgeId ) { return 1.0f; } );
+    EXPECT_TRUE( source.is_subset_of( segment ) );
+    EXPECT_FALSE( segment.intersects( sink ) );
+    int cutEdges = 0;
+    for ( auto f : segment )
+        for ( auto e : leftRing( topology, f ) )
+            if ( auto r = topology.right( e ); r && !segment.test( r ) )
+                ++cutEdges;
+    EXPECT_EQ( cutEdges, 2 * secondaryRes );
+}
+
 } // namespace MR
@@ -5,12 +5,13 @@
 #include "MRMesh/MRRegionBoundary.h"
 #include "MRMesh/MRMeshFillHole.h"
 #include "MRMesh/MRMeshFixer.h"
-#include "MRMesh/MRMeshRelax.h"
+#include "MRMesh/MRMeshRelax.hpp"
 #include "MRMesh/MRMeshComponents.h"
 #include "MRMesh/MRMeshSubdivide.h"
 #include "MRPch/MRSpdlog.h"
 #include "MRMesh/MRTimer.h"
 #include "MRMesh/MRBox.h"
+#include "MRMesh/MRRingIterator.h"
 #include <algorithm>
 
 namespace MR
@@ -25,83 +26,81 @@ Expected<FaceBitSet> getFaces( const Mesh& mesh, ProgressCallback cb )
     return findSelfCollidingTrianglesBS( mesh, cb, &faceToRegionMap );
 }
 
-// Helper function to fix self-intersections on part of mesh
-static Expected<void> doFix( Mesh& mesh, FaceBitSet& part, const Settings& settings,
-    int expandSize,
-    FaceBitSet& accumBadFaces,
-    ProgressCallback cb );
-
-// TODO: finish implementation
-Expected<void> fixOld( Mesh& mesh, const Settings& settings )
+// relaxes the vertices of given faces, refits AABB tree and returns all faces incident to moved vertices
+static Expected<FaceBitSet> relaxRegion( Mesh& mesh, const FaceBitSet& region, int iterations, ProgressCallback cb )
 {
-    Settings currentSettings = settings;
-    if ( currentSettings.subdivideEdgeLen <= 0.0f )
-        currentSettings.subdivideEdgeLen = mesh.averageEdgeLength();
-
-    // Examine current state
-    float progress = 0.1f, endProgress = 0.9f;
-    auto faceToRegionMap = MeshComponents::getAllComponentsMap( { mesh }, MeshComponents::FaceIncidence::PerEdge ).first;
-    auto res = findSelfCollidingTrianglesBS( mesh,
-        subprogress( settings.callback, 0.0f, progress ),
-        &faceToRegionMap);
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-    FaceBitSet badFaces = std::move( res.value() );
+    MR_TIMER;
+    auto verts = getIncidentVerts( mesh.topology, region );
+    MeshRelaxParams params;
+    params.iterations = iterations;
+    params.region = &verts;
+    const bool completed = relax( mesh.topology, mesh.points, params, cb );
+    // topology is not changed, so AABB tree can be refitted instead of full rebuild;
+    // this replaces MR_WRITER( mesh ) of relax( Mesh&, ... ), and it is called even if the relaxation was canceled,
+    // since some points could be already moved
+    mesh.updateCaches( verts );
+    if ( !completed )
+        return unexpectedOperationCanceled();
+    return getIncidentFaces( mesh.topology, verts );
+}
 
-    // Split mesh into separate component and possibly separate areas
-    FaceBitSet maxFaces = badFaces;
-    expand( mesh.topology, maxFaces, currentSettings.maxExpand );
-    std::vector<FaceBitSet> regions = MeshComponents::getAllComponents( { mesh, &maxFaces } );
-    spdlog::info( "SelfIntersections::fix: working on {} regions", int( regions.size() ) );
+// deletes given faces and fills the holes appeared not on mesh boundary, returns new faces
+static Expected<FaceBitSet> cutAndFillRegion( Mesh& mesh, const FaceBitSet& region, ProgressCallback cb )
+{
+    MR_TIMER;
+    auto& topology = mesh.topology;
 
-    // Handle areas
-    badFaces.reset();
-    float progressStep = ( endProgress - progress ) / regions.size();
-    for ( FaceBitSet &region : regions ) // Regions are updated in process
+    // the edges having deleted faces from the left
+    EdgeBitSet cutEdges( topology.edgeSize() );
+    VertBitSet touchedVerts( topology.vertSize() );
+    auto cut = [&] ( const FaceBitSet& faces )
     {
-        float progressSubStep = progressStep / currentSettings.maxExpand;
-        for ( int expandSize = 1; expandSize <= currentSettings.maxExpand; expandSize++ )
+        for ( auto f : faces )
         {
-            region &= mesh.topology.getValidFaces(); // Ensure bit set is valid, just in case
-            auto fixRes = doFix( mesh, region, currentSettings,
-                         expandSize,
-                         badFaces,
-                         subprogress( settings.callback, progress, progress + progressSubStep ) );
-            if ( true )
-                return {};
-            if ( !fixRes )
-                return fixRes;
-            progress += progressSubStep;
+            for ( auto e : leftRing( topology, f ) )
+            {
+                cutEdges.set( e );
+                touchedVerts.set( topology.org( e ) );
+            }
         }
-    }
-
-    // Handle global self-intersections (bridge-like between areas)
-    if ( settings.method == Settings::Method::Relax )
-        return {};
-    faceToRegionMap = MeshComponents::getAllComponentsMap( { mesh }, MeshComponents::FaceIncidence::PerEdge ).first;
-    res = findSelfCollidingTrianglesBS( mesh,
-        subprogress( settings.callback, endProgress, 1.0f ),
-        &faceToRegionMap );
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-    badFaces = res.value() - badFaces; // Exclude incurable faces
-    expand( mesh.topology, badFaces, 1 );
-    // Just clear regions and fill holes
-    std::vector<EdgeLoop> boundary = findRightBoundary( mesh.topology, &badFaces );
-    mesh.topology.deleteFaces( badFaces );
-    for ( const EdgeLoop& loop : boundary )
+        topology.deleteFaces( faces );
+    };
+    cut( region );
+    cut( findHoleComplicatingFaces( mesh ) );
+    mesh.invalidateCaches();
+
+    // find the holes near deleted faces, ignoring the ones touching initial mesh boundary
+    std::vector<EdgeId> holes;
+    EdgeBitSet visited( topology.edgeSize() );
+    for ( auto v : touchedVerts )
     {
-        if ( std::all_of( loop.begin(), loop.end(),
-            [&] ( EdgeId e ) { return mesh.topology.isLeftInRegion( e ); } ) )
+        if ( !topology.hasVert( v ) )
+            continue;
+        for ( auto e : orgRing( topology, v ) )
         {
-            if ( mesh.topology.left( loop.front().sym() ) )
-                // Invalid loop, ignoring
+            if ( topology.left( e ) || visited.test( e ) )
                 continue;
-            fillHole( mesh, loop.front().sym(), { .metric = getMinAreaMetric( mesh ) } );
+            bool inner = true;
+            for ( auto le : trackRightBoundaryLoop( topology, e ) )
+            {
+                visited.set( le );
+                inner = inner && cutEdges.test( le );
+            }
+            if ( inner )
+                holes.push_back( e );
         }
     }
 
-    return {};
+    if ( !reportProgress( cb, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    // MultipleEdgesResolveMode::Simple should be enough after deleting findHoleComplicatingFaces(...)
+    // But if multiple edges appear often, could be changed to MultipleEdgesResolveMode::Strong
+    FaceBitSet newFaces;
+    if ( !fillHoles( mesh, holes, { .metric = getMinAreaMetric( mesh ), .outNewFaces = &newFaces,
+        .multipleEdgesResolveMode = FillHoleParams::MultipleEdgesResolveMode::Simple }, subprogress( cb, 0.1f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
+    return newFaces;
 }
 
 Expected<void> fix( Mesh& mesh, const Settings& settings )
@@ -116,6 +115,7 @@ Expected<void> fix( Mesh& mesh, const Settings& settings )
     if ( !reportProgress( settings.callback, 0.05f ) )
         return unexpectedOperationCanceled();
 
+    // the only check of the whole mesh, all next checks are performed only near modified faces
     auto res = findSelfCollidingTrianglesBS( mesh,
                                              subprogress( settings.callback, 0.05f, 0.3f ),
                                              &faceToRegionMap );
@@ -125,212 +125,82 @@ Expected<void> fix( Mesh& mesh, const Settings& settings )
     if ( res->none() )
         return {};
 
-    expand( mesh.topology, *res, settings.maxExpand );
+    FaceBitSet dirtyFaces = std::move( *res );
+    expand( mesh.topology, dirtyFaces, settings.maxExpand );
 
-    Settings currentSettings = settings;
-    if ( currentSettings.subdivideEdgeLen < FLT_MAX )
+    if ( settings.subdivideEdgeLen < FLT_MAX )
     {
-        auto box = mesh.computeBoundingBox( &res.value() );
-        if ( currentSettings.subdivideEdgeLen <= 0.0f )
-            currentSettings.subdivideEdgeLen = box.valid() ? box.diagonal() * 1e-2f : mesh.getBoundingBox().diagonal() * 1e-4f;
-
+        float subdivideEdgeLen = settings.subdivideEdgeLen;
+        if ( subdivideEdgeLen <= 0.0f )
+        {
+            auto box = mesh.computeBoundingBox( &dirtyFaces );
+            subdivideEdgeLen = box.valid() ? box.diagonal() * 1e-2f : mesh.getBoundingBox().diagonal() * 1e-4f;
+        }
 
         SubdivideSettings ssettings;
-        ssettings.region = &res.value();
-        ssettings.maxEdgeLen = currentSettings.subdivideEdgeLen;
+        ssettings.region = &dirtyFaces;
+        ssettings.maxEdgeLen = subdivideEdgeLen;
         ssettings.maxEdgeSplits = 1000;
         ssettings.maxDeviationAfterFlip = ssettings.maxEdgeLen;
         ssettings.criticalAspectRatioFlip = FLT_MAX;
-        ssettings.progressCallback = subprogress( settings.callback, 0.3f, 0.5f );
+        ssettings.progressCallback = subprogress( settings.callback, 0.3f, 0.45f );
         subdivideMesh( mesh, ssettings );
+
+        faceToRegionMap = MeshComponents::getAllComponentsMap( { mesh } ).first;
     }
 
     if ( !reportProgress( settings.callback, 0.5f ) )
         return unexpectedOperationCanceled();
 
-    faceToRegionMap = MeshComponents::getAllComponentsMap( { mesh } ).first;
-
-    if ( !reportProgress( settings.callback, 0.55f ) )
-        return unexpectedOperationCanceled();
-
-    res = findSelfCollidingTrianglesBS( MeshPart( mesh, &res.value() ),
-                                        subprogress( settings.callback, 0.55f, 0.7f ),
-                                        &faceToRegionMap );
-
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-
-    expand( mesh.topology, *res, settings.maxExpand );
-
-    if ( settings.method == Settings::Method::Relax )
-    {
-        auto verts = getIncidentVerts( mesh.topology, *res );
-
-        if ( !reportProgress( settings.callback, 0.8f ) )
-            return unexpectedOperationCanceled();
-        MeshRelaxParams params;
-        params.iterations = settings.relaxIterations;
-        params.region = &verts;
-        if ( !relax( mesh, params, subprogress( settings.callback, 0.8f, 1.0f ) ) )
-            return unexpectedOperationCanceled();
-    }
-    else
+    const int numIterations = std::max( 1, settings.maxIterations );
+    for ( int i = 0; i < numIterations; ++i )
     {
-        auto boundaryEdges = mesh.topology.findBoundaryEdges();
-        mesh.topology.deleteFaces( *res );
-        mesh.topology.deleteFaces( findHoleComplicatingFaces( mesh ) );
-        mesh.invalidateCaches();
-        auto holes = findRightBoundary( mesh.topology );
+        auto sp = subprogress( settings.callback, 0.5f + 0.5f * i / numIterations, 0.5f + 0.5f * ( i + 1 ) / numIterations );
 
-        if ( !reportProgress( settings.callback, 0.8f ) )
-            return unexpectedOperationCanceled();
+        IterationStats stats;
+        stats.checkedFaces = int( dirtyFaces.count() );
+        res = findSelfCollidingTrianglesNearFaces( mesh, dirtyFaces, subprogress( sp, 0.0f, 0.3f ), &faceToRegionMap );
+        if ( !res.has_value() )
+            return unexpected( res.error() );
+        stats.collidingFaces = int( res->count() );
 
-        FaceBitSet newFaces;
-        VertBitSet newVerts;
-        auto sp = subprogress( settings.callback, 0.8f, 0.95f );
-        for ( int i = 0; i < holes.size(); ++i )
+        if ( res->any() )
         {
-            bool outerBounds = false;
-            for ( auto e : holes[i] )
+            expand( mesh.topology, *res, settings.maxExpand );
+            stats.modifiedFaces = int( res->count() );
+            if ( settings.method == Settings::Method::Relax )
             {
-                if ( boundaryEdges.test( e ) )
-                {
-                    outerBounds = true;
-                    break;
-                }
+                auto relaxed = relaxRegion( mesh, *res, settings.relaxIterations, subprogress( sp, 0.3f, 1.0f ) );
+                if ( !relaxed.has_value() )
+                    return unexpected( relaxed.error() );
+                dirtyFaces = std::move( *relaxed );
             }
-            if ( outerBounds )
-                continue; // part of mesh boundary
-
-            // Fill hole
-            // MultipleEdgesResolveMode::Simple should be enough after deleting findHoleComplicatingFaces(...)
-            // But if multiple edges appear often, could be changed to MultipleEdgesResolveMode::Strong
-            fillHole( mesh, holes[i].front(), {.metric = getMinAreaMetric(mesh),.outNewFaces = &newFaces,
-                .multipleEdgesResolveMode = FillHoleParams::MultipleEdgesResolveMode::Simple });
-
-            if ( !reportProgress( sp, float( i + 1 ) / float( holes.size() ) ) )
-                return unexpectedOperationCanceled();
-        }
-
-        relax( mesh, { {currentSettings.relaxIterations, &newVerts } } );
-
-        if ( !reportProgress( settings.callback, 1.0f ) )
-            return unexpectedOperationCanceled();
-    }
-    return {};
-}
-
-// Helper function to find own self-intersections on a mesh part
-static Expected<FaceBitSet> findSelfCollidingTrianglesBSForPart( Mesh& mesh, const FaceBitSet& part, ProgressCallback cb )
-{
-    FaceMap tgt2srcFaces;
-    PartMapping mapping;
-    mapping.tgt2srcFaces = &tgt2srcFaces;
-    Mesh partMesh = mesh.cloneRegion( part, false, mapping );
-    // Faster than searching in mesh part due to AABB tree rebuild
-    auto res = findSelfCollidingTrianglesBS( { partMesh }, cb );
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-    FaceBitSet result( mesh.topology.lastValidFace() + 1 );
-    for ( FaceId f : *res )
-        result.set( tgt2srcFaces[f] );
-    return result;
-}
-
-static Expected<void> doFix( Mesh &mesh, FaceBitSet &part, const Settings & settings,
-    int expandSize,
-    FaceBitSet& accumBadFaces,
-    ProgressCallback cb )
-{
-    // Find colliding triangles
-    float progress = 0.1f, endProgress = 0.9f;
-    auto res = findSelfCollidingTrianglesBSForPart( mesh, part, 
-        subprogress( cb, 0.0f, progress ) );
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-    // Get area around colliding triangles
-    FaceBitSet facesAround = std::move( res.value() );
-    if ( facesAround.empty() )
-        return {};
-    expand( mesh.topology, facesAround, expandSize );
-    // Iterate through regions around colliding triangles
-    std::vector<FaceBitSet> regions = MeshComponents::getAllComponents( { mesh, &facesAround } );
-    float progressStep = ( endProgress - progress ) / regions.size();
-    for ( const FaceBitSet &region : regions )
-    {
-        if ( !reportProgress( cb, progress ) )
-            return unexpectedOperationCanceled();
-        progress += progressStep;
-
-        std::vector<EdgeLoop> boundary = findLeftBoundary( mesh.topology, &region );
-        if ( boundary.empty() )
-        {
-            // Small separate component
-            mesh.topology.deleteFaces( region );
-            part &= mesh.topology.getValidFaces();
-            mesh.invalidateCaches();
-            continue;
-        }
-        bool isRegionOnBorder = std::any_of( boundary.begin(), boundary.end(),
-            [&] ( EdgeLoop& loop )
+            else
             {
-                // Check if loop touches mesh border (but exclude `region` inner holes)
-                size_t countOnBorder = std::count_if( loop.begin(), loop.end(),
-                        [&] ( EdgeId e ) { return !mesh.topology.isLeftInRegion( e.sym() ); } );
-                return countOnBorder != 0 && countOnBorder != loop.size();
-            } );
-        if ( isRegionOnBorder || settings.method == Settings::Method::Relax )
-        {
-            // Region is on border, cannot use fillHole
-            VertBitSet verts = getIncidentVerts( mesh.topology, region );
-            // Do not touch mesh border
-            for ( EdgeLoop &loop: boundary )
-                for ( EdgeId e : loop )
-                    if ( !mesh.topology.isLeftInRegion( e.sym() ) )
-                    {
-                        verts.reset( mesh.topology.org( e ) );
-                        verts.reset( mesh.topology.dest( e ) );
-                    }
-            // Try fixing by relax
-            relax( mesh, { { settings.relaxIterations, &verts } } );
+                auto newFaces = cutAndFillRegion( mesh, *res, subprogress( sp, 0.3f, 0.9f ) );
+                if ( !newFaces.has_value() )
+                    return unexpected( newFaces.error() );
+                // new faces shall be checked together with their neighbors
+                dirtyFaces = std::move( *newFaces );
+                expand( mesh.topology, dirtyFaces, 1 );
+                faceToRegionMap = MeshComponents::getAllComponentsMap( { mesh } ).first;
+            }
         }
-        else
-        {
-            // Inner region - fill hole
-            mesh.topology.deleteFaces( region );
-            part &= mesh.topology.getValidFaces();
-            mesh.invalidateCaches();
 
-            for ( EdgeLoop& loop : boundary )
-            {
-                if ( mesh.topology.left( loop.front().sym() ) )
-                    // Invalid loop, ignoring
-                    continue;
-                FaceBitSet newFaces;
-                fillHole( mesh, loop.front(), {
-                    .metric = getMinAreaMetric( mesh ),
-                    .outNewFaces = &newFaces } );
+        spdlog::debug( "SelfIntersections::fix: iteration {}, checked {} faces, found {} self-intersecting faces, modified {} faces",
+            i, stats.checkedFaces, stats.collidingFaces, stats.modifiedFaces );
+        if ( settings.outIterationStats )
+            settings.outIterationStats->push_back( stats );
 
-                VertBitSet newVerts;
-                SubdivideSettings subdivideSettings;
-                subdivideSettings.maxEdgeLen = settings.subdivideEdgeLen;
-                subdivideSettings.maxEdgeSplits = 1000000;
-                subdivideSettings.region = &newFaces;
-                subdivideSettings.newVerts = &newVerts;
-                subdivideMesh( mesh, subdivideSettings );
-                part |= newFaces;
+        if ( !reportProgress( sp, 1.0f ) )
+            return unexpectedOperationCanceled();
 
-                relax( mesh, { { 3, &newVerts } } );
-            }
-        }
-        mesh.invalidateCaches();
+        if ( stats.collidingFaces == 0 )
+            break;
     }
-    // Find resulting self-intersections
-    res = findSelfCollidingTrianglesBSForPart( mesh, part,
-        subprogress( cb, endProgress, 1.0 ) );
-    if ( !res.has_value() )
-        return unexpected( res.error() );
-    accumBadFaces |= res.value();
+
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
     return {};
 }
 
@@ -2,6 +2,7 @@
 
 #include "MRMesh/MRMeshFwd.h"
 #include "MRMesh/MRExpected.h"
+#include <vector>
 
 namespace MR
 {
@@ -9,6 +10,17 @@ namespace MR
 namespace SelfIntersections
 {
 
+/// Statistics of one repair iteration
+struct IterationStats
+{
+    /// Number of faces checked for self-intersections on this iteration
+    int checkedFaces = 0;
+    /// Number of self-intersecting faces found
+    int collidingFaces = 0;
+    /// Number of faces modified (relaxed or cut) around self-intersecting faces
+    int modifiedFaces = 0;
+};
+
 /// Setting set for mesh self-intersections fix
 struct Settings
 {
@@ -28,6 +40,12 @@ struct Settings
     /// Edge length for subdivision of holes covers (0.0f means auto)
     /// FLT_MAX to disable subdivision
     float subdivideEdgeLen = 0.0f;
+    /// Maximum number of repair iterations, should be > 0;
+    /// the whole mesh is checked only once, and each next iteration checks only the neighborhoods of the faces modified on the previous one;
+    /// the default value performs single repair pass as before, increase it to repair the self-intersections appearing after the repair
+    int maxIterations = 1;
+    /// Optional output of statistics of each performed iteration
+    std::vector<IterationStats>* outIterationStats = nullptr;
     /// Callback function
     ProgressCallback callback = {};
 };
@@ -3,6 +3,8 @@
 #include "MRMatrix2.h"
 #include "MRQuaternion.h"
 #include "MRTimer.h"
+#include "MRParallelFor.h"
+#include "MRGTest.h"
 #include <cassert>
 #include <chrono>
 
@@ -36,6 +38,26 @@ void GcodeProcessor::setGcodeSource( const GcodeSource& gcodeSource )
         gcodeSource_[i] = gcodeSource[i];
 }
 
+struct GcodeProcessor::LineState
+{
+    CoordType coordType = CoordType::Movement;
+    MoveMode moveMode = MoveMode::Idle;
+    WorkPlane workPlane = WorkPlane::xy;
+    Vector3f translationPos;
+    Vector3f rotationAngles;
+    bool absoluteCoordinates = true;
+    Vector3f scaling = Vector3f::diagonal( 1.f );
+    bool inches = false;
+    float feedrate = 100.f;
+
+    Vector3f inputCoords;
+    Vector3b inputCoordsReaded;
+    std::optional<float> radius;
+    std::optional<Vector3f> arcCenter;
+    Vector3f inputRotation;
+    Vector3b inputRotationReaded;
+};
+
 std::vector<MR::GcodeProcessor::MoveAction> GcodeProcessor::processSource()
 {
     MR_TIMER
@@ -43,15 +65,63 @@ std::vector<MR::GcodeProcessor::MoveAction> GcodeProcessor::processSource()
         return {};
 
     std::vector<MoveAction> res( gcodeSource_.size() );
-    std::vector<Command> tmp;
-    for ( int i = 0; i < gcodeSource_.size(); ++i )
-        res[i] = processLine( gcodeSource_[i], tmp );
 
-    for ( auto& action : res )
+    // workers generate move actions from saved states, so they need only the settings
+    GcodeProcessor exemplar;
+    exemplar.setCNCMachineSettings( cncSettings_ );
+    exemplar.accuracy_ = accuracy_;
+    tbb::enumerable_thread_specific<GcodeProcessor> workers( exemplar );
+
+    // lines are processed in blocks to limit the memory for parsed commands and saved states
+    constexpr size_t cBlockSize = 65536;
+    std::vector<std::vector<Command>> commands;
+    std::vector<LineState> states;
+    for ( size_t blockBegin = 0; blockBegin < gcodeSource_.size(); blockBegin += cBlockSize )
     {
+        const size_t blockSize = std::min( cBlockSize, gcodeSource_.size() - blockBegin );
+        commands.resize( blockSize );
+        states.resize( blockSize );
+
+        ParallelFor( size_t( 0 ), blockSize, [&] ( size_t i )
+        {
+            commands[i].clear();
+            const auto& line = gcodeSource_[blockBegin + i];
+            if ( !line.empty() )
+                parseFrame_( line, commands[i] );
+        } );
+
+        // modal states of each line depend on all previous lines
+        for ( size_t i = 0; i < blockSize; ++i )
+        {
+            if ( commands[i].empty() )
+                continue;
+            resetTemporaryStates_();
+            for ( const auto& command : commands[i] )
+                applyCommand_( command );
+            saveLineState_( states[i] );
+            advanceLineState_();
+        }
+
+        ParallelFor( size_t( 0 ), blockSize, workers, [&] ( size_t i, GcodeProcessor& worker )
+        {
+            if ( commands[i].empty() )
+                return;
+            worker.loadLineState_( states[i] );
+            if ( worker.coordType_ == CoordType::Movement )
+                res[blockBegin + i] = worker.generateMoveAction_();
+            else if ( worker.coordType_ == CoordType::ReturnToHome )
+                res[blockBegin + i] = worker.generateReturnToHomeAction_();
+        } );
+    }
+    // the scan does not update cached matrices, which are necessary for subsequent processLine calls
+    updateRotationAngleAndMatrix_( rotationAngles_ );
+
+    ParallelFor( res, [&] ( size_t i )
+    {
+        auto& action = res[i];
         if ( action.idle && action.feedrate == 0.f )
             action.feedrate = feedrateMax_;
-    }
+    } );
 
     return res;
 }
@@ -300,6 +370,66 @@ void GcodeProcessor::resetTemporaryStates_()
     inputRotationReaded_ = Vector3b( false, false, false );
 }
 
+void GcodeProcessor::saveLineState_( LineState& state ) const
+{
+    state.coordType = coordType_;
+    state.moveMode = moveMode_;
+    state.workPlane = workPlane_;
+    state.translationPos = translationPos_;
+    state.rotationAngles = rotationAngles_;
+    state.absoluteCoordinates = absoluteCoordinates_;
+    state.scaling = scaling_;
+    state.inches = inches_;
+    state.feedrate = feedrate_;
+
+    state.inputCoords = inputCoords_;
+    state.inputCoordsReaded = inputCoordsReaded_;
+    state.radius = radius_;
+    state.arcCenter = arcCenter_;
+    state.inputRotation = inputRotation_;
+    state.inputRotationReaded = inputRotationReaded_;
+}
+
+void GcodeProcessor::loadLineState_( const LineState& state )
+{
+    coordType_ = state.coordType;
+    moveMode_ = state.moveMode;
+    if ( workPlane_ != state.workPlane )
+        updateWorkPlane_( state.workPlane );
+    translationPos_ = state.translationPos;
+    if ( rotationAngles_ != state.rotationAngles )
+        updateRotationAngleAndMatrix_( state.rotationAngles );
+    absoluteCoordinates_ = state.absoluteCoordinates;
+    scaling_ = state.scaling;
+    inches_ = state.inches;
+    feedrate_ = state.feedrate;
+
+    inputCoords_ = state.inputCoords;
+    inputCoordsReaded_ = state.inputCoordsReaded;
+    radius_ = state.radius;
+    arcCenter_ = state.arcCenter;
+    inputRotation_ = state.inputRotation;
+    inputRotationReaded_ = state.inputRotationReaded;
+}
+
+void GcodeProcessor::advanceLineState_()
+{
+    if ( coordType_ == CoordType::Movement )
+    {
+        if ( moveMode_ != MoveMode::Idle )
+            feedrateMax_ = std::max( feedrateMax_, feedrate_ );
+        const Vector3f newTranslationPos = calcNewTranslationPos_();
+        rotationAngles_ = calcNewRotationAngles_();
+        translationPos_ = newTranslationPos;
+    }
+    else if ( coordType_ == CoordType::ReturnToHome )
+        translationPos_ = cncSettings_.getHomePosition();
+    else if ( coordType_ == CoordType::Scaling )
+        updateScaling_();
+
+    coordType_ = CoordType::Movement;
+}
+
 GcodeProcessor::MoveAction GcodeProcessor::moveLine_( const Vector3f& newPoint, const Vector3f& newAngles )
 {
     MoveAction res;
@@ -566,4 +696,59 @@ MR::Vector3f GcodeProcessor::calcRealCoordCached_( const Vector3f& translationPo
     return res;
 }
 
+TEST( MRMesh, GcodeProcessor )
+{
+    // the program with all supported modes repeated many times to occupy several blocks of parallel processing
+    const GcodeSource program = {
+        "G21 G90 G17 F1000",
+        "G0 X10 Y5 Z3",
+        "G1 X20 Y15 Z0 ; comment",
+        "",
+        "(only comment)",
+        "G2 X30 Y25 R10",
+        "G3 X20 Y15 I-5 J-5",
+        "G18 G2 X25 Z5 I2.5 K2.5",
+        "G19 G3 Y20 Z0 J2.5 K-2.5 F500",
+        "G17 G91 G1 X1 Y-1 A5",
+        "B10 C-5",
+        "G90 G20 X1 Y2 F30",
+        "G21 G51 X2 Y2",
+        "G1 X5 Y5 Z5",
+        "G50 G28 X0",
+        "G0 A0 B0 C0"
+    };
+    GcodeSource source;
+    for ( int i = 0; i < 10000; ++i )
+        source.insert( source.end(), program.begin(), program.end() );
+
+    GcodeProcessor processor;
+    processor.setGcodeSource( source );
+    const auto actions = processor.processSource();
+    ASSERT_EQ( actions.size(), source.size() );
+
+    GcodeProcessor sequential;
+    sequential.setGcodeSource( source );
+    std::vector<GcodeProcessor::MoveAction> refActions( source.size() );
+    std::vector<GcodeProcessor::Command> commands;
+    float feedrateMax = 0.f;
+    for ( int i = 0; i < source.size(); ++i )
+    {
+        refActions[i] = sequential.processLine( source[i], commands );
+        if ( !refActions[i].idle )
+            feedrateMax = std::max( feedrateMax, refActions[i].feedrate );
+    }
+    EXPECT_EQ( feedrateMax, 1000.f );
+
+    for ( int i = 0; i < source.size(); ++i )
+    {
+        const auto& a = actions[i];
+        const auto& ref = refActions[i];
+        EXPECT_EQ( a.action.path, ref.action.path );
+        EXPECT_EQ( a.toolDirection, ref.toolDirection );
+        EXPECT_EQ( a.action.warning, ref.action.warning );
+        EXPECT_EQ( a.idle, ref.idle );
+        EXPECT_EQ( a.feedrate, ref.idle && ref.feedrate == 0.f ? feedrateMax : ref.feedrate );
+    }
+}
+
 }
@@ -45,7 +45,9 @@ public:
     // set g-code source
     MRMESH_API void setGcodeSource( const GcodeSource& gcodeSource );
 
-    // process all lines g-code source and generate corresponding move actions
+    // process all lines g-code source and generate corresponding move actions;
+    // the lines are parsed in parallel, then modal states are propagated by fast sequential scan,
+    // and finally move actions are generated in parallel
     MRMESH_API std::vector<MoveAction> processSource();
 
     struct Command
@@ -78,6 +80,15 @@ private:
     MoveAction generateReturnToHomeAction_();
     void resetTemporaryStates_();
 
+    // modal and input states before generation of move action of one line
+    struct LineState;
+    // saves current states in given structure
+    void saveLineState_( LineState& state ) const;
+    // restores current states from given structure (only cached rotation matrices are updated if necessary)
+    void loadLineState_( const LineState& state );
+    // updates modal states after applying commands of one line as processLine does, but without generation of move action
+    void advanceLineState_();
+
     // g-command actions
 
     // g0, g1
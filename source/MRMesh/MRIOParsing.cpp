@@ -3,6 +3,9 @@
 #include "MRColor.h"
 #include "MRString.h"
 #include "MRPch/MRTBB.h"
+#include "MRGTest.h"
+
+#include <cstring>
 
 #include <boost/spirit/home/x3.hpp>
 
@@ -59,9 +62,9 @@ std::vector<size_t> splitByLines( const char* data, size_t size )
             std::vector<size_t> group;
             const auto begin = i * groupSize;
             const auto end = std::min( ( i + 1 ) * groupSize, size );
-            for ( auto ci = begin; ci < end; ci++ )
-                if ( data[ci] == '\n' )
-                    group.emplace_back( ci + 1 );
+            // memchr is vectorized in all standard libraries
+            for ( auto p = data + begin; const auto nl = (const char*)std::memchr( p, '\n', data + end - p ); p = nl + 1 )
+                group.emplace_back( nl + 1 - data );
             groups[i] = std::move( group );
         } );
     }
@@ -96,6 +99,23 @@ std::vector<size_t> splitByLines( const char* data, size_t size )
     return newlines;
 }
 
+std::vector<size_t> splitByLineChunks( const char* data, size_t size, size_t chunkSize )
+{
+    assert( chunkSize > 0 );
+    std::vector<size_t> res{ 0 };
+    for ( size_t pos = chunkSize; pos < size; pos += chunkSize )
+    {
+        const auto nl = (const char*)std::memchr( data + pos - 1, '\n', size - pos + 1 );
+        if ( !nl )
+            break;
+        pos = nl + 1 - data;
+        if ( pos < size )
+            res.push_back( pos );
+    }
+    res.push_back( size );
+    return res;
+}
+
 std::streamoff getStreamSize( std::istream& in )
 {
     const auto posStart = in.tellg();
@@ -349,4 +369,25 @@ template Expected<void> parseObjCoordinate<double>( const std::string_view& str,
 template Expected<void> parseAscCoordinate<float>( const std::string_view& str, Vector3f& v, Vector3f* n, Color* c );
 template Expected<void> parseAscCoordinate<double>( const std::string_view& str, Vector3d& v, Vector3d* n, Color* c );
 
-}
\ No newline at end of file
+TEST( MRMesh, SplitByLineChunks )
+{
+    std::string text;
+    for ( int i = 0; i < 1000; ++i )
+        text += std::to_string( i ) + ( i % 3 == 0 ? "\r\n" : "\n" );
+    const auto lines = splitByLines( text.data(), text.size() );
+    EXPECT_EQ( lines.size(), 1001 );
+
+    for ( size_t chunkSize : { 1, 7, 100, 100000 } )
+    {
+        const auto chunks = splitByLineChunks( text.data(), text.size(), chunkSize );
+        EXPECT_EQ( chunks.front(), 0 );
+        EXPECT_EQ( chunks.back(), text.size() );
+        for ( size_t i = 1; i + 1 < chunks.size(); ++i )
+        {
+            EXPECT_LT( chunks[i - 1], chunks[i] );
+            EXPECT_TRUE( std::binary_search( lines.begin(), lines.end(), chunks[i] ) );
+        }
+    }
+}
+
+} // namespace MR
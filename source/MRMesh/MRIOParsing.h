@@ -10,6 +10,10 @@ namespace MR
 // returns offsets for each new line in monolith char block
 MRMESH_API std::vector<size_t> splitByLines( const char* data, size_t size );
 
+// splits monolith char block on parts of approximately given size to be parsed in parallel, each part starting from a new line;
+// returns the offsets of parts' beginnings and the size of the block as the last element
+MRMESH_API std::vector<size_t> splitByLineChunks( const char* data, size_t size, size_t chunkSize = 1 << 20 );
+
 // get the size of the remaining data in the input stream
 MRMESH_API std::streamoff getStreamSize( std::istream& in );
 
@@ -5,6 +5,9 @@
 #include "MRBuffer.h"
 #include "MRTimer.h"
 #include "MRParallelFor.h"
+#include "MRHeapBytes.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 
 namespace MR
 {
@@ -127,4 +130,93 @@ std::shared_ptr<Object> makeLevelOfDetails( Mesh && mesh, int maxDepth )
     return res;
 }
 
+int MeshLods::findLevelByError( float maxError ) const
+{
+    // errors grow from level to level
+    int res = -1;
+    for ( int i = 0; i < levels.size() && levels[i].error <= maxError; ++i )
+        res = i;
+    return res;
+}
+
+int MeshLods::findLevelByFaces( int maxFaces ) const
+{
+    for ( int i = 0; i < levels.size(); ++i )
+        if ( levels[i].mesh->topology.numValidFaces() <= maxFaces )
+            return i;
+    return int( levels.size() ) - 1;
+}
+
+size_t MeshLods::heapBytes() const
+{
+    size_t res = levels.capacity() * sizeof( Level );
+    for ( const auto & l : levels )
+        res += MR::heapBytes( l.mesh );
+    return res;
+}
+
+Expected<MeshLods> makeMeshLods( const Mesh & mesh, const MeshLodsSettings & settings )
+{
+    MR_TIMER
+    MeshLods res;
+    Mesh curr = mesh;
+    curr.packOptimally( false );
+    int numFaces = curr.topology.numValidFaces();
+    float error = 0;
+    for ( int l = 0; l < settings.maxLevels && numFaces / 2 >= settings.minFaces; ++l )
+    {
+        DecimateSettings dsettings;
+        dsettings.maxError = FLT_MAX;
+        dsettings.maxDeletedFaces = numFaces - numFaces / 2;
+        dsettings.subdivideParts = settings.subdivideParts;
+        dsettings.progressCallback = subprogress( settings.progress, float( l ) / settings.maxLevels, float( l + 1 ) / settings.maxLevels );
+        const auto dres = decimateMesh( curr, dsettings );
+        if ( dres.cancelled )
+            return unexpectedOperationCanceled();
+        if ( dres.facesDeleted <= 0 )
+            break;
+
+        // the deviation of the next level from the original mesh is estimated as the sum of deviations between successive levels
+        error += dres.errorIntroduced;
+        // optimal packing is necessary for the decimation of the next level in parallel parts, and it speeds up the rendering of this level
+        curr.packOptimally( false );
+        numFaces = curr.topology.numValidFaces();
+        res.levels.push_back( { std::make_shared<Mesh>( curr ), error } );
+    }
+
+    if ( !reportProgress( settings.progress, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+TEST( MRMesh, MeshLods )
+{
+    const auto mesh = makeTorus( 1.0f, 0.3f, 128, 64 );
+    const int numFaces = mesh.topology.numValidFaces();
+    MeshLodsSettings settings;
+    settings.maxLevels = 4;
+    settings.minFaces = 2000;
+    settings.subdivideParts = 8;
+    auto lods = makeMeshLods( mesh, settings );
+    ASSERT_TRUE( lods.has_value() );
+    ASSERT_EQ( lods->levels.size(), 3 );
+
+    int prevFaces = numFaces;
+    float prevError = 0;
+    for ( const auto & l : lods->levels )
+    {
+        const auto f = l.mesh->topology.numValidFaces();
+        EXPECT_LE( f, prevFaces / 2 + 2 );
+        EXPECT_TRUE( l.mesh->topology.isClosed() );
+        EXPECT_GE( l.error, prevError );
+        prevFaces = f;
+        prevError = l.error;
+    }
+
+    EXPECT_EQ( lods->findLevelByError( -1.0f ), -1 );
+    EXPECT_EQ( lods->findLevelByError( FLT_MAX ), 2 );
+    EXPECT_EQ( lods->findLevelByFaces( numFaces ), 0 );
+    EXPECT_EQ( lods->findLevelByFaces( 0 ), 2 );
+}
+
 } //namespace MR
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRProgressCallback.h"
+#include <memory>
+#include <vector>
 
 namespace MR
 {
@@ -11,4 +15,44 @@ namespace MR
 /// the number of faces in any object on any level is about the same.
 [[nodiscard]] MRMESH_API std::shared_ptr<Object> makeLevelOfDetails( Mesh && mesh, int maxDepth );
 
+/// progressively simplified versions of one mesh (not including the mesh itself),
+/// each next level has about half of the faces of the previous one
+struct MeshLods
+{
+    struct Level
+    {
+        std::shared_ptr<const Mesh> mesh;
+        /// estimated maximal distance deviation of this level from the original mesh
+        float error = 0;
+    };
+    /// from the finest level to the coarsest one
+    std::vector<Level> levels;
+
+    /// returns the index of the coarsest level with the error not exceeding given value,
+    /// or -1 if even the finest level has larger error and the original mesh shall be used
+    [[nodiscard]] MRMESH_API int findLevelByError( float maxError ) const;
+
+    /// returns the index of the finest level having at most given number of faces, or the coarsest level if all have more faces
+    [[nodiscard]] MRMESH_API int findLevelByFaces( int maxFaces ) const;
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] MRMESH_API size_t heapBytes() const;
+};
+
+struct MeshLodsSettings
+{
+    /// maximal number of levels to generate
+    int maxLevels = 8;
+    /// no level with less faces is generated
+    int minFaces = 1000;
+    /// the mesh is virtually subdivided on this number of parts decimated in parallel, see DecimateSettings::subdivideParts
+    int subdivideParts = 64;
+    /// to report algorithm progress and cancel it by user request
+    ProgressCallback progress;
+};
+
+/// makes levels of details of given mesh by its repeated decimation, each time removing about half of the faces;
+/// the decimation of each level runs in parallel in the parts of the mesh
+[[nodiscard]] MRMESH_API Expected<MeshLods> makeMeshLods( const Mesh & mesh, const MeshLodsSettings & settings = {} );
+
 } //namespace MR
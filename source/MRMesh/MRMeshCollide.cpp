@@ -7,6 +7,10 @@
 #include "MRGTest.h"
 #include "MRPch/MRTBB.h"
 #include "MRExpected.h"
+#include "MRBitSetParallelFor.h"
+#include "MRTorus.h"
+#include "MRMeshComponents.h"
+#include "MRScratchVector.h"
 #include <atomic>
 #include <thread>
 
@@ -43,7 +47,9 @@ std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart
         bNodesPtr = &bNodes;
     }
 
-    std::vector<NodeNode> subtasks{ { NodeId{ 0 }, NodeId{ 0 } } };
+    ScratchVector<NodeNode> subtasksBuf;
+    auto & subtasks = *subtasksBuf;
+    subtasks.push_back( { NodeId{ 0 }, NodeId{ 0 } } );
 
     while( !subtasks.empty() )
     {
@@ -172,6 +178,35 @@ inline std::pair<int, int> sharedVertex( const VertId av[3], const VertId bv[3]
     return { -1, -1 };
 }
 
+// returns true if two given faces of one mesh intersect not only by common vertex or common edge
+static bool doFacesCollide( const Mesh & mesh, FaceId aFace, FaceId bFace )
+{
+    if ( mesh.topology.sharedEdge( aFace, bFace ) )
+        return false;
+
+    VertId av[3], bv[3];
+    mesh.topology.getTriVerts( aFace, av[0], av[1], av[2] );
+    mesh.topology.getTriVerts( bFace, bv[0], bv[1], bv[2] );
+
+    Vector3d ap[3], bp[3];
+    for ( int j = 0; j < 3; ++j )
+    {
+        ap[j] = Vector3d{ mesh.points[av[j]] };
+        bp[j] = Vector3d{ mesh.points[bv[j]] };
+    }
+
+    auto sv = sharedVertex( av, bv );
+    if ( sv.first >= 0 )
+    {
+        // shared vertex
+        const int j = sv.first;
+        const int k = sv.second;
+        return doTriangleSegmentIntersect( ap[0], ap[1], ap[2], bp[ ( k + 1 ) % 3 ], bp[ ( k + 2 ) % 3 ] ) ||
+               doTriangleSegmentIntersect( bp[0], bp[1], bp[2], ap[ ( j + 1 ) % 3 ], ap[ ( j + 2 ) % 3 ] );
+    }
+    return doTrianglesIntersectExt( ap[0], ap[1], ap[2], bp[0], bp[1], bp[2] );
+}
+
 static void processSelfSubtasks( const AABBTree & tree,
     std::vector<NodeNode> & subtasks,
     std::vector<NodeNode> & nextSubtasks, // may be same as subtasks
@@ -261,7 +296,8 @@ Expected<bool> findSelfCollidingTriangles(
     tbb::parallel_for( tbb::blocked_range<size_t>( 0, subtasks.size() ),
         [&]( const tbb::blocked_range<size_t>& range )
     {
-        std::vector<NodeNode> mySubtasks;
+        ScratchVector<NodeNode> mySubtasksBuf;
+        auto & mySubtasks = *mySubtasksBuf;
         for ( auto is = range.begin(); is < range.end(); ++is )
         {
             if ( sb && !keepGoing.load( std::memory_order_relaxed ) )
@@ -280,33 +316,9 @@ Expected<bool> findSelfCollidingTriangles(
                     const auto bFace = bNode.leafId();
                     if ( mp.region && !mp.region->test( bFace ) )
                         return Processing::Continue;
-                    if ( mp.mesh.topology.sharedEdge( aFace, bFace ) )
-                        return Processing::Continue;
                     if ( regionMap && (*regionMap)[aFace] != (*regionMap)[bFace] )
                         return Processing::Continue;
-
-                    VertId av[3], bv[3];
-                    mp.mesh.topology.getTriVerts( aFace, av[0], av[1], av[2] );
-                    mp.mesh.topology.getTriVerts( bFace, bv[0], bv[1], bv[2] );
-
-                    Vector3d ap[3], bp[3];
-                    for ( int j = 0; j < 3; ++j )
-                    {
-                        ap[j] = Vector3d{ mp.mesh.points[av[j]] };
-                        bp[j] = Vector3d{ mp.mesh.points[bv[j]] };
-                    }
-
-                    auto sv = sharedVertex( av, bv );
-                    if ( sv.first >= 0 )
-                    {
-                        // shared vertex
-                        const int j = sv.first;
-                        const int k = sv.second;
-                        if ( !doTriangleSegmentIntersect( ap[0], ap[1], ap[2], bp[ ( k + 1 ) % 3 ], bp[ ( k + 2 ) % 3 ] ) &&
-                             !doTriangleSegmentIntersect( bp[0], bp[1], bp[2], ap[ ( j + 1 ) % 3 ], ap[ ( j + 2 ) % 3 ] ) )
-                            return Processing::Continue;
-                    }
-                    else if ( !doTrianglesIntersectExt( ap[0], ap[1], ap[2], bp[0], bp[1], bp[2] ) )
+                    if ( !doFacesCollide( mp.mesh, aFace, bFace ) )
                         return Processing::Continue;
                     myRes.emplace_back( aFace, bFace );
                     if ( !outCollidingPairs )
@@ -383,6 +395,66 @@ Expected<FaceBitSet> findSelfCollidingTrianglesBS( const MeshPart & mp, Progress
     return res;
 }
 
+Expected<FaceBitSet> findSelfCollidingTrianglesNearFaces( const Mesh & mesh, const FaceBitSet & faces, ProgressCallback cb,
+    const Face2RegionMap * regionMap )
+{
+    MR_TIMER
+    FaceBitSet res( mesh.topology.faceSize() );
+    const AABBTree & tree = mesh.getAABBTree();
+    if ( tree.nodes().empty() )
+        return res;
+
+    // the faces colliding with given ones are collected in thread-local vectors,
+    // since they can be located in the blocks of the bit set processed by other threads
+    tbb::enumerable_thread_specific<std::vector<FaceId>> threadOtherFaces;
+    if ( !BitSetParallelFor( faces, [&]( FaceId f )
+    {
+        if ( !mesh.topology.hasFace( f ) )
+            return;
+        Box3f fBox;
+        for ( auto v : mesh.topology.getTriVerts( f ) )
+            fBox.include( mesh.points[v] );
+
+        constexpr int MaxStackSize = 32; // to avoid allocations
+        NodeId subtasks[MaxStackSize];
+        int stackSize = 0;
+        subtasks[stackSize++] = tree.rootNodeId();
+
+        bool collides = false;
+        auto & otherFaces = threadOtherFaces.local();
+        while ( stackSize > 0 )
+        {
+            const auto & node = tree[subtasks[--stackSize]];
+            if ( !node.box.intersects( fBox ) )
+                continue;
+            if ( !node.leaf() )
+            {
+                assert( stackSize + 2 <= MaxStackSize );
+                subtasks[stackSize++] = node.l;
+                subtasks[stackSize++] = node.r;
+                continue;
+            }
+            const FaceId g = node.leafId();
+            if ( g == f || ( g < f && faces.test( g ) ) ) // the pair of two given faces is checked only once
+                continue;
+            if ( regionMap && (*regionMap)[f] != (*regionMap)[g] )
+                continue;
+            if ( !doFacesCollide( mesh, f, g ) )
+                continue;
+            otherFaces.push_back( g );
+            collides = true;
+        }
+        if ( collides )
+            res.set( f );
+    }, cb ) )
+        return unexpectedOperationCanceled();
+
+    for ( const auto & otherFaces : threadOtherFaces )
+        for ( auto g : otherFaces )
+            res.set( g );
+    return res;
+}
+
 bool isInside( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A )
 {
     auto cols = findCollidingTriangles( a, b, rigidB2A );
@@ -426,4 +498,34 @@ TEST( MRMesh, DegenerateTrianglesIntersect )
     EXPECT_FALSE( intersection );
 }
 
+TEST( MRMesh, SelfCollidingTrianglesNearFaces )
+{
+    auto mesh = makeTorus( 1.0f, 0.2f, 16, 16 );
+    auto mesh2 = mesh;
+    mesh2.transform( AffineXf3f::translation( Vector3f( 0.5f, 0.0f, 0.0f ) ) );
+    mesh.addPart( mesh2 );
+
+    auto all = findSelfCollidingTrianglesBS( mesh );
+    ASSERT_TRUE( all.has_value() );
+    EXPECT_TRUE( all->any() );
+    all->resize( mesh.topology.faceSize() );
+
+    auto near = findSelfCollidingTrianglesNearFaces( mesh, mesh.topology.getValidFaces() );
+    ASSERT_TRUE( near.has_value() );
+    EXPECT_EQ( *near, *all );
+
+    // each colliding face of the first torus is enough to find all faces of the second torus colliding with it
+    FaceBitSet firstTorus( mesh.topology.faceSize() );
+    firstTorus.set( 0_f, mesh2.topology.faceSize(), true );
+    near = findSelfCollidingTrianglesNearFaces( mesh, *all & firstTorus );
+    ASSERT_TRUE( near.has_value() );
+    EXPECT_EQ( *near, *all );
+
+    // no collisions within one component
+    const auto regionMap = MeshComponents::getAllComponentsMap( mesh ).first;
+    near = findSelfCollidingTrianglesNearFaces( mesh, mesh.topology.getValidFaces(), {}, &regionMap );
+    ASSERT_TRUE( near.has_value() );
+    EXPECT_TRUE( near->none() );
+}
+
 } //namespace MR
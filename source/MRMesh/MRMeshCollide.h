@@ -36,6 +36,13 @@ namespace MR
 /// the same \ref findSelfCollidingTriangles but returns the union of all self-intersecting faces
 [[nodiscard]] MRMESH_API Expected<FaceBitSet> findSelfCollidingTrianglesBS( const MeshPart & mp, ProgressCallback cb = {},
     const Face2RegionMap * regionMap = nullptr ); ///< if regionMap is provided then only self-intersections within a region are returned
+
+/// finds all faces of the mesh colliding with at least one face from given set (not necessarily with another face from the set),
+/// returns the union of given colliding faces and the faces they collide with;
+/// the AABB tree is descended only in the neighborhood of each given face (in parallel), so it is much faster than
+/// \ref findSelfCollidingTrianglesBS for small sets in large meshes, e.g. to re-check the regions modified by local repair
+[[nodiscard]] MRMESH_API Expected<FaceBitSet> findSelfCollidingTrianglesNearFaces( const Mesh & mesh, const FaceBitSet & faces, ProgressCallback cb = {},
+    const Face2RegionMap * regionMap = nullptr ); ///< if regionMap is provided then only self-intersections within a region are returned
  
 /**
  * \brief checks that arbitrary mesh part A is inside of closed mesh part B
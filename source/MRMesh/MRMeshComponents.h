@@ -173,7 +173,7 @@ MRMESH_API void excludeFullySelectedComponents( const Mesh& mesh, VertBitSet& se
     VertBitSet* outPathVerts = nullptr );
 
 /// gets union-find structure for all undirected edges in \param mesh
-/// \param allPointToRoots if true, then every element in the structure will point directly to the root of its respective component
+/// \param allPointToRoots not used anymore: every element in the returned structure always points directly to the root of its respective component
 [[nodiscard]] MRMESH_API UnionFind<UndirectedEdgeId> getUnionFindStructureUndirectedEdges( const Mesh& mesh, bool allPointToRoots = false );
 
 /// returns union of connected components, each of which contains at least one seed edge
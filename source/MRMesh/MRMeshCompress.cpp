@@ -0,0 +1,801 @@
+#include "MRMeshCompress.h"
+#include "MRMesh.h"
+#include "MRMeshBuilder.h"
+#include "MRBitSet.h"
+#include "MRBox.h"
+#include "MRSaveSettings.h"
+#include "MRIOParsing.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRTorus.h"
+#include "MRMeshSave.h"
+#include "MRMeshLoad.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace MR
+{
+
+namespace
+{
+
+// adaptive binary range coder of LZMA: the probabilities of bits are represented by 11-bit integers
+constexpr int ProbBits = 11;
+constexpr std::uint16_t ProbInit = 1 << ( ProbBits - 1 );
+constexpr int ProbMoveBits = 5;
+constexpr std::uint32_t TopValue = 1u << 24;
+
+class RangeEncoder
+{
+public:
+    explicit RangeEncoder( std::string & out ) : out_( out ) {}
+
+    void encodeBit( std::uint16_t & prob, int bit )
+    {
+        const std::uint32_t bound = ( range_ >> ProbBits ) * prob;
+        if ( bit == 0 )
+        {
+            range_ = bound;
+            prob += ( ( 1 << ProbBits ) - prob ) >> ProbMoveBits;
+        }
+        else
+        {
+            low_ += bound;
+            range_ -= bound;
+            prob -= prob >> ProbMoveBits;
+        }
+        normalize_();
+    }
+
+    // encodes given number of lower bits of the value with equal probabilities of zeros and ones
+    void encodeDirect( std::uint32_t value, int numBits )
+    {
+        for ( int i = numBits - 1; i >= 0; --i )
+        {
+            range_ >>= 1;
+            if ( ( value >> i ) & 1 )
+                low_ += range_;
+            normalize_();
+        }
+    }
+
+    void flush()
+    {
+        for ( int i = 0; i < 5; ++i )
+            shiftLow_();
+    }
+
+private:
+    void normalize_()
+    {
+        while ( range_ < TopValue )
+        {
+            range_ <<= 8;
+            shiftLow_();
+        }
+    }
+
+    void shiftLow_()
+    {
+        if ( std::uint32_t( low_ ) < 0xFF000000u || ( low_ >> 32 ) != 0 )
+        {
+            const auto carry = std::uint8_t( low_ >> 32 );
+            auto temp = cache_;
+            do
+            {
+                out_.push_back( char( std::uint8_t( temp + carry ) ) );
+                temp = 0xFF;
+            } while ( --cacheSize_ != 0 );
+            cache_ = std::uint8_t( low_ >> 24 );
+        }
+        ++cacheSize_;
+        low_ = ( low_ & 0x00FFFFFF ) << 8;
+    }
+
+    std::string & out_;
+    std::uint64_t low_ = 0;
+    std::uint32_t range_ = 0xFFFFFFFF;
+    std::uint8_t cache_ = 0;
+    std::uint64_t cacheSize_ = 1;
+};
+
+class RangeDecoder
+{
+public:
+    RangeDecoder( const char * data, size_t size ) : p_( data ), end_( data + size )
+    {
+        for ( int i = 0; i < 5; ++i )
+            code_ = ( code_ << 8 ) | nextByte_();
+    }
+
+    int decodeBit( std::uint16_t & prob )
+    {
+        const std::uint32_t bound = ( range_ >> ProbBits ) * prob;
+        int bit;
+        if ( code_ < bound )
+        {
+            range_ = bound;
+            prob += ( ( 1 << ProbBits ) - prob ) >> ProbMoveBits;
+            bit = 0;
+        }
+        else
+        {
+            code_ -= bound;
+            range_ -= bound;
+            prob -= prob >> ProbMoveBits;
+            bit = 1;
+        }
+        normalize_();
+        return bit;
+    }
+
+    std::uint32_t decodeDirect( int numBits )
+    {
+        std::uint32_t res = 0;
+        for ( int i = 0; i < numBits; ++i )
+        {
+            range_ >>= 1;
+            code_ -= range_;
+            const std::uint32_t t = 0 - ( code_ >> 31 );
+            code_ += range_ & t;
+            res = ( res << 1 ) + ( t + 1 );
+            normalize_();
+        }
+        return res;
+    }
+
+    /// returns true if the decoder tried to read after the end of data, which means corrupted input
+    bool overrun() const { return overrun_; }
+
+private:
+    std::uint8_t nextByte_()
+    {
+        if ( p_ < end_ )
+            return std::uint8_t( *p_++ );
+        overrun_ = true;
+        return 0;
+    }
+
+    void normalize_()
+    {
+        while ( range_ < TopValue )
+        {
+            range_ <<= 8;
+            code_ = ( code_ << 8 ) | nextByte_();
+        }
+    }
+
+    const char * p_;
+    const char * end_;
+    std::uint32_t range_ = 0xFFFFFFFF;
+    std::uint32_t code_ = 0;
+    bool overrun_ = false;
+};
+
+// adaptive probabilities of the symbols with NumBits bits
+template<int NumBits>
+struct BitTreeModel
+{
+    std::array<std::uint16_t, 1 << NumBits> probs;
+    BitTreeModel() { probs.fill( ProbInit ); }
+
+    void encode( RangeEncoder & enc, std::uint32_t symbol )
+    {
+        std::uint32_t m = 1;
+        for ( int i = NumBits - 1; i >= 0; --i )
+        {
+            const int bit = ( symbol >> i ) & 1;
+            enc.encodeBit( probs[m], bit );
+            m = ( m << 1 ) | bit;
+        }
+    }
+
+    std::uint32_t decode( RangeDecoder & dec )
+    {
+        std::uint32_t m = 1;
+        for ( int i = 0; i < NumBits; ++i )
+            m = ( m << 1 ) | dec.decodeBit( probs[m] );
+        return m - ( 1u << NumBits );
+    }
+};
+
+// the model of unsigned numbers: the number of significant bits is coded adaptively, and the bits after the highest one directly
+struct NumberModel
+{
+    BitTreeModel<6> numBits;
+
+    void encode( RangeEncoder & enc, std::uint32_t value )
+    {
+        const int n = std::bit_width( value );
+        numBits.encode( enc, n );
+        if ( n > 1 )
+            enc.encodeDirect( value, n - 1 );
+    }
+
+    std::uint32_t decode( RangeDecoder & dec )
+    {
+        const int n = numBits.decode( dec );
+        if ( n <= 1 )
+            return n;
+        if ( n > 32 )
+            return 0;
+        return ( 1u << ( n - 1 ) ) | dec.decodeDirect( n - 1 );
+    }
+};
+
+inline std::uint32_t zigzag( std::int32_t v )
+{
+    return ( std::uint32_t( v ) << 1 ) ^ std::uint32_t( v >> 31 );
+}
+
+inline std::int32_t unzigzag( std::uint32_t v )
+{
+    return std::int32_t( v >> 1 ) ^ -std::int32_t( v & 1 );
+}
+
+// how the next triangle is attached to the gate - a half-edge of already coded triangle
+enum class Symbol : std::uint32_t
+{
+    New,    ///< the third vertex of the triangle was not seen before
+    Left,   ///< the third vertex is the end of the latest open half-edge from the gate's end
+    Right,  ///< the third vertex is the origin of the latest open half-edge to the gate's origin
+    Skip,   ///< no triangle behind the gate: mesh boundary or the triangle was already coded
+    Index,  ///< the third vertex is given explicitly
+    Count
+};
+
+// the last symbol is the context of the next one; one extra context for the start
+struct SymbolModel
+{
+    std::array<BitTreeModel<3>, int( Symbol::Count ) + 1> trees;
+    std::uint32_t prev = int( Symbol::Count );
+
+    void encode( RangeEncoder & enc, Symbol s )
+    {
+        trees[prev].encode( enc, std::uint32_t( s ) );
+        prev = std::uint32_t( s );
+    }
+
+    Symbol decode( RangeDecoder & dec )
+    {
+        const auto s = trees[prev].decode( dec );
+        prev = std::min( s, std::uint32_t( Symbol::Count ) );
+        return Symbol( s );
+    }
+};
+
+// all models of connectivity stream
+struct ConnectivityModel
+{
+    SymbolModel symbols;
+    std::uint16_t seedVertNew = ProbInit;
+    NumberModel index;
+};
+
+// open half-edges of already coded triangles with not yet coded triangles on the other side;
+// the encoder and the decoder perform exactly the same operations with it
+class GateGraph
+{
+public:
+    struct Gate
+    {
+        VertId org, dest;
+        EdgeId edge; ///< the edge in the original mesh (only for encoder)
+        int prevOut = -1, nextOut = -1; ///< in the list of gates from org
+        int prevIn = -1, nextIn = -1;   ///< in the list of gates to dest
+        bool alive = true;
+    };
+
+    explicit GateGraph( size_t numVerts ) : outHead_( numVerts, -1 ), inHead_( numVerts, -1 ) {}
+
+    const Gate & gate( int g ) const { return gates_[g]; }
+
+    /// registers the half-edge org->dest of just coded triangle:
+    /// either it closes the open half-edge dest->org of another triangle or it opens new gate
+    void addHalfEdge( VertId org, VertId dest, EdgeId edge )
+    {
+        for ( int g = outHead_[dest]; g >= 0; g = gates_[g].nextOut )
+        {
+            if ( gates_[g].dest == org )
+            {
+                kill_( g );
+                return;
+            }
+        }
+        const int g = int( gates_.size() );
+        auto & gate = gates_.emplace_back();
+        gate.org = org;
+        gate.dest = dest;
+        gate.edge = edge;
+        gate.nextOut = outHead_[org];
+        if ( gate.nextOut >= 0 )
+            gates_[gate.nextOut].prevOut = g;
+        outHead_[org] = g;
+        gate.nextIn = inHead_[dest];
+        if ( gate.nextIn >= 0 )
+            gates_[gate.nextIn].prevIn = g;
+        inHead_[dest] = g;
+        stack_.push_back( g );
+    }
+
+    /// returns the latest open gate removing it from the graph, or -1 if all gates are closed
+    int pop()
+    {
+        while ( !stack_.empty() )
+        {
+            const int g = stack_.back();
+            stack_.pop_back();
+            if ( gates_[g].alive )
+            {
+                kill_( g );
+                return g;
+            }
+        }
+        return -1;
+    }
+
+    /// the end of the latest open half-edge from v not going to u
+    VertId leftCandidate( VertId v, VertId u ) const
+    {
+        for ( int g = outHead_[v]; g >= 0; g = gates_[g].nextOut )
+            if ( gates_[g].dest != u )
+                return gates_[g].dest;
+        return {};
+    }
+
+    /// the origin of the latest open half-edge to u not starting in v
+    VertId rightCandidate( VertId u, VertId v ) const
+    {
+        for ( int g = inHead_[u]; g >= 0; g = gates_[g].nextIn )
+            if ( gates_[g].org != v )
+                return gates_[g].org;
+        return {};
+    }
+
+private:
+    void kill_( int g )
+    {
+        auto & gate = gates_[g];
+        gate.alive = false;
+        if ( gate.prevOut >= 0 )
+            gates_[gate.prevOut].nextOut = gate.nextOut;
+        else
+            outHead_[gate.org] = gate.nextOut;
+        if ( gate.nextOut >= 0 )
+            gates_[gate.nextOut].prevOut = gate.prevOut;
+        if ( gate.prevIn >= 0 )
+            gates_[gate.prevIn].nextIn = gate.nextIn;
+        else
+            inHead_[gate.dest] = gate.nextIn;
+        if ( gate.nextIn >= 0 )
+            gates_[gate.nextIn].prevIn = gate.prevIn;
+    }
+
+    std::vector<Gate> gates_;
+    std::vector<int> stack_;
+    Vector<int, VertId> outHead_, inHead_;
+};
+
+#pragma pack(push, 1)
+struct Header
+{
+    char magic[4];
+    std::uint32_t numVerts = 0;
+    std::uint32_t numFaces = 0;
+    std::uint32_t numBlocks = 0;
+    double origin[3] = {};
+    double step = 1;
+    std::uint64_t connectivityBytes = 0;
+};
+#pragma pack(pop)
+static_assert( sizeof( Header ) == 56, "check your padding" );
+
+// the number of vertices in independently coded block of coordinates
+constexpr size_t BlockSize = 16384;
+
+// the quantized coordinates are limited to keep the differences in 32 bits
+constexpr double MaxQuantized = 1 << 30;
+
+// the probability of any coded bit is at most 2017/2048 (limited by ProbBits and ProbMoveBits), so each of them takes more than 1/46 of a bit in the stream;
+// a triangle needs at least 3 coded bits (symbol or seed flags), so one byte of connectivity codes less than 8 * 46 / 3 < 123 triangles,
+// and a vertex needs at least 18 coded bits (the lengths of 3 numbers), so one byte of coordinates codes less than 8 * 46 / 18 < 21 vertices;
+// the limits below are taken with a margin, they only protect from huge allocations requested by corrupted headers
+constexpr size_t MaxFacesPerByte = 256;
+constexpr size_t MaxVertsPerByte = 64;
+
+} // anonymous namespace
+
+Expected<void> compressMesh( const Mesh & mesh, std::ostream & out, const MeshCompressSettings & settings )
+{
+    MR_TIMER
+    const auto & topology = mesh.topology;
+    const size_t numFaces = topology.numValidFaces();
+
+    // connectivity
+    std::string connectivity;
+    VertMap new2oldVerts;
+    FaceMap new2oldFaces;
+    new2oldFaces.reserve( numFaces );
+    Vector<VertId, VertId> old2newVerts( topology.vertSize() );
+    FaceBitSet coded( topology.faceSize() );
+    {
+        RangeEncoder enc( connectivity );
+        ConnectivityModel model;
+        GateGraph graph( topology.vertSize() );
+        auto newVert = [&]( VertId old )
+        {
+            const VertId res( new2oldVerts.size() );
+            new2oldVerts.push_back( old );
+            old2newVerts[old] = res;
+            return res;
+        };
+        auto encodeIndex = [&]( VertId v )
+        {
+            model.index.encode( enc, std::uint32_t( new2oldVerts.size() - 1 - v ) );
+        };
+
+        const auto sp = subprogress( settings.progress, 0.0f, 0.6f );
+        FaceId nextSeed( 0 );
+        while ( new2oldFaces.size() < numFaces )
+        {
+            if ( !reportProgress( sp, float( new2oldFaces.size() ) / numFaces, new2oldFaces.size(), 1 << 16 ) )
+                return unexpectedOperationCanceled();
+            const int g = graph.pop();
+            if ( g < 0 )
+            {
+                // start new connected component from the first not coded triangle
+                while ( !topology.hasFace( nextSeed ) || coded.test( nextSeed ) )
+                    ++nextSeed;
+                EdgeId es[3];
+                es[0] = topology.edgeWithLeft( nextSeed );
+                es[1] = topology.prev( es[0].sym() );
+                es[2] = topology.prev( es[1].sym() );
+                VertId vs[3];
+                for ( int j = 0; j < 3; ++j )
+                {
+                    const auto old = topology.org( es[j] );
+                    vs[j] = old2newVerts[old];
+                    enc.encodeBit( model.seedVertNew, vs[j] ? 0 : 1 );
+                    if ( vs[j] )
+                        encodeIndex( vs[j] );
+                    else
+                        vs[j] = newVert( old );
+                }
+                coded.set( nextSeed );
+                new2oldFaces.push_back( nextSeed );
+                for ( int j = 0; j < 3; ++j )
+                    graph.addHalfEdge( vs[j], vs[( j + 1 ) % 3], es[j] );
+                continue;
+            }
+
+            const auto & gate = graph.gate( g );
+            const VertId u = gate.org, v = gate.dest;
+            const EdgeId e = gate.edge.sym(); // v->u
+            const FaceId f = topology.left( e );
+            if ( !f || coded.test( f ) )
+            {
+                model.symbols.encode( enc, Symbol::Skip );
+                continue;
+            }
+            const EdgeId e1 = topology.prev( e.sym() ); // u->c
+            const EdgeId e2 = topology.prev( e1.sym() ); // c->v
+            const VertId oldC = topology.org( e2 );
+            VertId c = old2newVerts[oldC];
+            if ( !c )
+            {
+                model.symbols.encode( enc, Symbol::New );
+                c = newVert( oldC );
+            }
+            else if ( c == graph.leftCandidate( v, u ) )
+                model.symbols.encode( enc, Symbol::Left );
+            else if ( c == graph.rightCandidate( u, v ) )
+                model.symbols.encode( enc, Symbol::Right );
+            else
+            {
+                model.symbols.encode( enc, Symbol::Index );
+                encodeIndex( c );
+            }
+            coded.set( f );
+            new2oldFaces.push_back( f );
+            graph.addHalfEdge( u, c, e1 );
+            graph.addHalfEdge( c, v, e2 );
+        }
+        enc.flush();
+    }
+
+    // quantization
+    const auto box = tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, new2oldVerts.size() ), Box3d{},
+        [&]( const tbb::blocked_range<size_t> & range, Box3d curr )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                curr.include( applyDouble( settings.xf, mesh.points[new2oldVerts[VertId( i )]] ) );
+            return curr;
+        },
+        []( Box3d a, const Box3d & b )
+        {
+            a.include( b );
+            return a;
+        } );
+
+    Header header;
+    std::copy( std::begin( MeshCompressMagic ), std::end( MeshCompressMagic ), header.magic );
+    header.numVerts = std::uint32_t( new2oldVerts.size() );
+    header.numFaces = std::uint32_t( numFaces );
+    header.numBlocks = std::uint32_t( ( new2oldVerts.size() + BlockSize - 1 ) / BlockSize );
+    header.connectivityBytes = connectivity.size();
+    if ( box.valid() )
+    {
+        const double diagonal = box.diagonal();
+        const double precision = settings.precision > 0 ? double( settings.precision ) : 1e-6 * diagonal;
+        if ( precision > 0 )
+            header.step = 2 * precision;
+        for ( int i = 0; i < 3; ++i )
+        {
+            header.origin[i] = box.min[i];
+            if ( box.size()[i] / header.step >= MaxQuantized )
+                return unexpected( "The precision is too fine for the size of the mesh" );
+        }
+    }
+
+    // coordinates
+    std::vector<std::string> blocks( header.numBlocks );
+    const auto quantize = [&]( VertId newV )
+    {
+        const auto p = applyDouble( settings.xf, mesh.points[new2oldVerts[newV]] );
+        Vector3i res;
+        for ( int i = 0; i < 3; ++i )
+            res[i] = int( std::lround( ( p[i] - header.origin[i] ) / header.step ) );
+        return res;
+    };
+    if ( !ParallelFor( size_t( 0 ), blocks.size(), [&]( size_t b )
+    {
+        RangeEncoder enc( blocks[b] );
+        NumberModel models[3];
+        Vector3i prev;
+        const size_t end = std::min( size_t( header.numVerts ), ( b + 1 ) * BlockSize );
+        for ( size_t i = b * BlockSize; i < end; ++i )
+        {
+            const auto q = quantize( VertId( i ) );
+            for ( int j = 0; j < 3; ++j )
+                models[j].encode( enc, zigzag( q[j] - prev[j] ) );
+            prev = q;
+        }
+        enc.flush();
+    }, subprogress( settings.progress, 0.6f, 0.9f ) ) )
+        return unexpectedOperationCanceled();
+
+    out.write( ( const char* )&header, sizeof( header ) );
+    out.write( connectivity.data(), connectivity.size() );
+    for ( const auto & block : blocks )
+    {
+        const auto size = std::uint32_t( block.size() );
+        out.write( ( const char* )&size, 4 );
+    }
+    for ( const auto & block : blocks )
+        out.write( block.data(), block.size() );
+    if ( !out )
+        return unexpected( std::string( "Error writing compressed mesh" ) );
+
+    if ( settings.outNew2OldVerts )
+        *settings.outNew2OldVerts = std::move( new2oldVerts );
+    if ( settings.outNew2OldFaces )
+        *settings.outNew2OldFaces = std::move( new2oldFaces );
+    reportProgress( settings.progress, 1.0f );
+    return {};
+}
+
+Expected<Mesh> decompressMesh( std::istream & in, ProgressCallback progress )
+{
+    MR_TIMER
+    Header header;
+    in.read( ( char* )&header, sizeof( header ) );
+    if ( !in || !std::equal( std::begin( MeshCompressMagic ), std::end( MeshCompressMagic ), header.magic ) )
+        return unexpected( std::string( "Not a compressed mesh stream" ) );
+    // each vertex belongs to a triangle
+    if ( header.numBlocks != ( size_t( header.numVerts ) + BlockSize - 1 ) / BlockSize || header.numVerts > 3 * size_t( header.numFaces ) )
+        return unexpected( std::string( "Compressed mesh stream is corrupted" ) );
+
+    const auto streamSize = getStreamSize( in );
+    if ( streamSize < std::streamoff( header.connectivityBytes + 4 * size_t( header.numBlocks ) ) )
+        return unexpected( std::string( "Compressed mesh stream is too short" ) );
+    // do not allocate the memory for the elements, which cannot be coded in the remaining bytes
+    const size_t coordinateBytes = size_t( streamSize ) - header.connectivityBytes - 4 * size_t( header.numBlocks );
+    if ( header.numFaces > MaxFacesPerByte * header.connectivityBytes || header.numVerts > MaxVertsPerByte * coordinateBytes )
+        return unexpected( std::string( "Compressed mesh stream has corrupted header" ) );
+    std::string connectivity( header.connectivityBytes, '\0' );
+    in.read( connectivity.data(), connectivity.size() );
+    std::vector<std::uint32_t> blockSizes( header.numBlocks );
+    in.read( ( char* )blockSizes.data(), blockSizes.size() * 4 );
+    std::vector<size_t> blockOffsets( header.numBlocks + 1, 0 );
+    for ( size_t b = 0; b < blockSizes.size(); ++b )
+        blockOffsets[b + 1] = blockOffsets[b] + blockSizes[b];
+    if ( !in || std::streamoff( header.connectivityBytes + 4 * size_t( header.numBlocks ) + blockOffsets.back() ) > streamSize )
+        return unexpected( std::string( "Compressed mesh stream is too short" ) );
+    std::string coordinates( blockOffsets.back(), '\0' );
+    in.read( coordinates.data(), coordinates.size() );
+    if ( !in )
+        return unexpected( std::string( "Error reading compressed mesh" ) );
+
+    const auto corrupted = unexpected( std::string( "Compressed mesh stream is corrupted" ) );
+    const VertId numVerts( header.numVerts );
+
+    // connectivity
+    Triangulation t;
+    // do not trust the number of faces in corrupted stream before decoding
+    t.reserve( std::min( size_t( header.numFaces ), 1024 * ( connectivity.size() + 1 ) ) );
+    {
+        RangeDecoder dec( connectivity.data(), connectivity.size() );
+        ConnectivityModel model;
+        GateGraph graph( header.numVerts );
+        VertId nextNewVert( 0 );
+        auto decodeIndex = [&]() -> VertId
+        {
+            const auto n = model.index.decode( dec );
+            if ( n >= std::uint32_t( nextNewVert ) )
+                return {};
+            return VertId( int( nextNewVert ) - 1 - int( n ) );
+        };
+
+        const auto sp = subprogress( progress, 0.0f, 0.5f );
+        while ( t.size() < header.numFaces )
+        {
+            if ( !reportProgress( sp, float( t.size() ) / header.numFaces, t.size(), 1 << 16 ) )
+                return unexpectedOperationCanceled();
+            if ( dec.overrun() )
+                return corrupted;
+            const int g = graph.pop();
+            if ( g < 0 )
+            {
+                ThreeVertIds vs;
+                for ( int j = 0; j < 3; ++j )
+                {
+                    vs[j] = dec.decodeBit( model.seedVertNew ) ? nextNewVert++ : decodeIndex();
+                    if ( !vs[j] || vs[j] >= numVerts )
+                        return corrupted;
+                }
+                t.push_back( vs );
+                for ( int j = 0; j < 3; ++j )
+                    graph.addHalfEdge( vs[j], vs[( j + 1 ) % 3], {} );
+                continue;
+            }
+
+            const auto & gate = graph.gate( g );
+            const VertId u = gate.org, v = gate.dest;
+            VertId c;
+            switch ( model.symbols.decode( dec ) )
+            {
+            case Symbol::Skip:
+                continue;
+            case Symbol::New:
+                c = nextNewVert++;
+                break;
+            case Symbol::Left:
+                c = graph.leftCandidate( v, u );
+                break;
+            case Symbol::Right:
+                c = graph.rightCandidate( u, v );
+                break;
+            case Symbol::Index:
+                c = decodeIndex();
+                break;
+            default:
+                return corrupted;
+            }
+            if ( !c || c >= numVerts )
+                return corrupted;
+            t.push_back( { v, u, c } );
+            graph.addHalfEdge( u, c, {} );
+            graph.addHalfEdge( c, v, {} );
+        }
+        if ( nextNewVert != numVerts )
+            return corrupted;
+    }
+
+    Mesh res;
+    res.topology = MeshBuilder::fromTriangles( t, {}, subprogress( progress, 0.5f, 0.8f ) );
+
+    // coordinates
+    res.points.resizeNoInit( numVerts );
+    std::atomic<bool> blocksOk{ true };
+    if ( !ParallelFor( size_t( 0 ), size_t( header.numBlocks ), [&]( size_t b )
+    {
+        RangeDecoder dec( coordinates.data() + blockOffsets[b], blockSizes[b] );
+        NumberModel models[3];
+        Vector3i q;
+        const size_t end = std::min( size_t( header.numVerts ), ( b + 1 ) * BlockSize );
+        for ( size_t i = b * BlockSize; i < end; ++i )
+        {
+            for ( int j = 0; j < 3; ++j )
+                q[j] += unzigzag( models[j].decode( dec ) );
+            Vector3f p;
+            for ( int j = 0; j < 3; ++j )
+                p[j] = float( header.origin[j] + header.step * q[j] );
+            res.points[VertId( i )] = p;
+        }
+        if ( dec.overrun() )
+            blocksOk = false;
+    }, subprogress( progress, 0.8f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
+    if ( !blocksOk )
+        return corrupted;
+
+    return res;
+}
+
+TEST( MRMesh, MeshCompress )
+{
+    auto mesh = makeTorus( 1.0f, 0.3f, 128, 64 );
+    // make some holes and separate parts
+    FaceBitSet del( mesh.topology.faceSize() );
+    for ( FaceId f( 0 ); f < del.size(); f += 97 )
+        del.set( f );
+    mesh.topology.deleteFaces( del );
+
+    std::stringstream ss;
+    VertMap new2oldVerts;
+    FaceMap new2oldFaces;
+    MeshCompressSettings settings;
+    settings.precision = 1e-4f;
+    settings.outNew2OldVerts = &new2oldVerts;
+    settings.outNew2OldFaces = &new2oldFaces;
+    ASSERT_TRUE( compressMesh( mesh, ss, settings ).has_value() );
+    const auto compressedSize = ss.str().size();
+
+    auto loaded = decompressMesh( ss );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->topology.numValidFaces(), mesh.topology.numValidFaces() );
+    EXPECT_EQ( loaded->topology.numValidVerts(), mesh.topology.numValidVerts() );
+    ASSERT_EQ( new2oldFaces.size(), loaded->topology.faceSize() );
+    ASSERT_EQ( new2oldVerts.size(), loaded->points.size() );
+    for ( auto f : loaded->topology.getValidFaces() )
+    {
+        auto vs = loaded->topology.getTriVerts( f );
+        for ( auto & v : vs )
+            v = new2oldVerts[v];
+        // the same triangle with possibly other first vertex
+        auto ref = mesh.topology.getTriVerts( new2oldFaces[f] );
+        while ( ref[0] != vs[0] )
+            std::rotate( ref.begin(), ref.begin() + 1, ref.end() );
+        EXPECT_EQ( vs, ref );
+    }
+    for ( auto v : loaded->topology.getValidVerts() )
+    {
+        const auto d = loaded->points[v] - mesh.points[new2oldVerts[v]];
+        EXPECT_LE( std::max( { std::abs( d.x ), std::abs( d.y ), std::abs( d.z ) } ), 1.0001e-4f );
+    }
+    EXPECT_EQ( loaded->topology.findHoleRepresentiveEdges().size(), mesh.topology.findHoleRepresentiveEdges().size() );
+
+    std::stringstream raw;
+    ASSERT_TRUE( MeshSave::toMrmesh( mesh, raw ).has_value() );
+    EXPECT_LT( 5 * compressedSize, raw.str().size() );
+
+    // both versions are read by the loader of .mrmesh format
+    std::stringstream compressed;
+    ASSERT_TRUE( MeshSave::toCompressedMrmesh( mesh, compressed, 1e-4f ).has_value() );
+    const auto compressedStr = compressed.str();
+    for ( auto * s : { &raw, &compressed } )
+    {
+        auto m = MeshLoad::fromMrmesh( *s );
+        ASSERT_TRUE( m.has_value() );
+        EXPECT_EQ( m->topology.numValidFaces(), mesh.topology.numValidFaces() );
+    }
+
+    std::stringstream truncated( compressedStr.substr( 0, compressedStr.size() / 2 ) );
+    EXPECT_FALSE( decompressMesh( truncated ).has_value() );
+
+    // the header promises much more triangles than the stream can code
+    auto header = ss.str();
+    const std::uint32_t hugeNumFaces = 1u << 30;
+    std::memcpy( header.data() + 8, &hugeNumFaces, sizeof( hugeNumFaces ) );
+    std::stringstream corrupted( header );
+    auto res = decompressMesh( corrupted );
+    ASSERT_FALSE( res.has_value() );
+    EXPECT_EQ( res.error(), "Compressed mesh stream has corrupted header" );
+}
+
+} // namespace MR
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRProgressCallback.h"
+#include <istream>
+#include <ostream>
+
+namespace MR
+{
+
+/// \addtogroup IOGroup
+/// \{
+
+/// the first bytes of compressed mesh stream; they never start the stream of MeshTopology::write( ) (version 1 of .mrmesh format),
+/// because its first byte is the lowest byte of the number of half-edges, which is always even
+constexpr char MeshCompressMagic[4] = { 'M', 'R', 'M', '2' };
+
+struct MeshCompressSettings
+{
+    /// maximal deviation of each decoded coordinate from the original one;
+    /// if not positive then 1e-6 of the bounding box diagonal is taken
+    float precision = 0;
+
+    /// this transformation can optionally be applied to all points before their quantization
+    const AffineXf3d * xf = nullptr;
+
+    /// optional outputs: the ids in the original mesh of saved vertices and faces, in the order they will be loaded
+    VertMap * outNew2OldVerts = nullptr;
+    FaceMap * outNew2OldFaces = nullptr;
+
+    /// to report progress and cancel saving if user desires
+    ProgressCallback progress;
+};
+
+/// writes the mesh in compact form (version 2 of .mrmesh format):
+/// * the connectivity is encoded during the traversal of triangles, typically in 1-2 bits per triangle;
+/// * the coordinates are quantized with given precision, and the differences between consecutive vertices are entropy coded
+///   in independent blocks, which are decoded in parallel;
+/// the vertices and faces are renumbered in the order of traversal, deleted elements and the edges without faces are not saved
+MRMESH_API Expected<void> compressMesh( const Mesh & mesh, std::ostream & out, const MeshCompressSettings & settings = {} );
+
+/// reads the mesh written by compressMesh( ), the stream must start from MeshCompressMagic
+MRMESH_API Expected<Mesh> decompressMesh( std::istream & in, ProgressCallback progress = {} );
+
+/// \}
+
+} // namespace MR
@@ -2,41 +2,42 @@
 #include "MRMesh.h"
 #include "MRTimer.h"
 #include "MRMeshBuilder.h"
+#include "MRBitSetParallelFor.h"
+#include "MRPartialChangeMeshAction.h"
+#include "MRTorus.h"
 #include "MRGTest.h"
 
 namespace MR
 {
 
-MeshDiff::MeshDiff( const Mesh & from, const Mesh & to )
+VertCoordsDiff::VertCoordsDiff( const VertCoords & from, const VertCoords & to )
 {
     MR_TIMER
 
-    toPointsSize_ = to.points.size();
-    for ( VertId v{0}; v < toPointsSize_; ++v )
+    toPointsSize_ = to.size();
+    // find changed points in parallel, and then store them sequentially
+    VertBitSet changed( toPointsSize_ );
+    BitSetParallelForAll( changed, [&]( VertId v )
     {
-        if ( v >= from.points.size() || from.points[v] != to.points[v] )
-            changedPoints_[v] = to.points[v];
-    }
-
-    toEdgesSize_ = to.topology.edges_.size();
-    for ( EdgeId e{0}; e < toEdgesSize_; ++e )
-    {
-        if ( e >= from.topology.edges_.size() || from.topology.edges_[e] != to.topology.edges_[e] )
-            changedEdges_[e] = to.topology.edges_[e];
-    }
+        if ( v >= from.size() || from[v] != to[v] )
+            changed.set( v );
+    } );
+    changedPoints_.reserve( changed.count() );
+    for ( auto v : changed )
+        changedPoints_[v] = to[v];
 }
 
-void MeshDiff::applyAndSwap( Mesh & m )
+void VertCoordsDiff::applyAndSwap( VertCoords & m )
 {
     MR_TIMER
 
-    auto mPointsSize = m.points.size();
+    auto mPointsSize = m.size();
     // remember points being deleted from m
     for ( VertId v{toPointsSize_}; v < mPointsSize; ++v )
     {
-        changedPoints_[v] = m.points[v];
+        changedPoints_[v] = m[v];
     }
-    m.points.resize( toPointsSize_ );
+    m.resize( toPointsSize_ );
     // swap common points and delete points for vertices missing in original m (that will be next target)
     for ( auto it = changedPoints_.begin(); it != changedPoints_.end(); )
     {
@@ -44,7 +45,7 @@ void MeshDiff::applyAndSwap( Mesh & m )
         auto & pos = it->second;
         if ( v < toPointsSize_ )
         {
-            std::swap( pos, m.points[v] );
+            std::swap( pos, m[v] );
             if ( v >= mPointsSize )
             {
                 it = changedPoints_.erase( it );
@@ -54,6 +55,35 @@ void MeshDiff::applyAndSwap( Mesh & m )
         ++it;
     }
     toPointsSize_ = mPointsSize;
+}
+
+size_t VertCoordsDiff::heapBytes() const
+{
+    // each slot of flat hash map holds a value and one byte of control information
+    return changedPoints_.bucket_count() * ( sizeof( std::pair<VertId, Vector3f> ) + 1 );
+}
+
+MeshDiff::MeshDiff( const Mesh & from, const Mesh & to ) : pointsDiff_( from.points, to.points )
+{
+    MR_TIMER
+
+    toEdgesSize_ = to.topology.edges_.size();
+    EdgeBitSet changed( toEdgesSize_ );
+    BitSetParallelForAll( changed, [&]( EdgeId e )
+    {
+        if ( e >= from.topology.edges_.size() || from.topology.edges_[e] != to.topology.edges_[e] )
+            changed.set( e );
+    } );
+    changedEdges_.reserve( changed.count() );
+    for ( auto e : changed )
+        changedEdges_[e] = to.topology.edges_[e];
+}
+
+void MeshDiff::applyAndSwap( Mesh & m )
+{
+    MR_TIMER
+
+    pointsDiff_.applyAndSwap( m.points );
 
     auto mEdgesSize = m.topology.edges_.size();
     // remember topology.edges_ being deleted from m
@@ -83,6 +113,12 @@ void MeshDiff::applyAndSwap( Mesh & m )
     m.topology.computeAllFromEdges_();
 }
 
+size_t MeshDiff::heapBytes() const
+{
+    return pointsDiff_.heapBytes()
+        + changedEdges_.bucket_count() * ( sizeof( std::pair<EdgeId, MeshTopology::HalfEdgeRecord> ) + 1 );
+}
+
 TEST(MRMesh, MeshDiff)
 {
     Triangulation t
@@ -115,4 +151,59 @@ TEST(MRMesh, MeshDiff)
     EXPECT_EQ( MeshDiff( m, m ).any(), false );
 }
 
+TEST(MRMesh, VertCoordsDiff)
+{
+    VertCoords points0;
+    points0.emplace_back( 0.f, 0.f, 0.f );
+    points0.emplace_back( 1.f, 0.f, 0.f );
+    points0.emplace_back( 1.f, 1.f, 0.f );
+
+    VertCoords points1 = points0;
+    points1[1_v] = Vector3f( 2.f, 0.f, 0.f );
+    points1.emplace_back( 0.f, 1.f, 0.f );
+
+    VertCoordsDiff diff( points0, points1 );
+    EXPECT_EQ( diff.any(), true );
+    EXPECT_GT( diff.heapBytes(), 0 );
+    VertCoords p = points0;
+    diff.applyAndSwap( p );
+    EXPECT_EQ( p, points1 );
+    diff.applyAndSwap( p );
+    EXPECT_EQ( p, points0 );
+
+    EXPECT_EQ( VertCoordsDiff( p, p ).any(), false );
+}
+
+TEST(MRMesh, PartialChangeMeshAction)
+{
+    auto objMesh = std::make_shared<ObjectMesh>();
+    objMesh->setMesh( std::make_shared<Mesh>( makeTorus() ) );
+    const Mesh mesh0 = *objMesh->mesh();
+
+    // local change of topology and points
+    auto mesh1 = std::make_shared<Mesh>( mesh0 );
+    mesh1->topology.deleteFace( 0_f );
+    mesh1->points[1_v] += Vector3f( 0.f, 0.f, 0.1f );
+    const Mesh mesh1Copy = *mesh1;
+
+    PartialChangeMeshAction action( "change mesh", objMesh, setNew, std::move( mesh1 ) );
+    EXPECT_EQ( *objMesh->mesh(), mesh1Copy );
+    EXPECT_LT( action.heapBytes(), mesh0.heapBytes() );
+    action.action( HistoryAction::Type::Undo );
+    EXPECT_EQ( *objMesh->mesh(), mesh0 );
+    action.action( HistoryAction::Type::Redo );
+    EXPECT_EQ( *objMesh->mesh(), mesh1Copy );
+
+    // object already contains new points
+    const VertCoords points1 = objMesh->mesh()->points;
+    objMesh->varMesh()->points[2_v] += Vector3f( 0.1f, 0.f, 0.f );
+    const VertCoords points2 = objMesh->mesh()->points;
+    PartialChangeMeshPointsAction pointsAction( "move point", objMesh, cmpOld, points1 );
+    EXPECT_LT( pointsAction.heapBytes(), points1.heapBytes() );
+    pointsAction.action( HistoryAction::Type::Undo );
+    EXPECT_EQ( objMesh->mesh()->points, points1 );
+    pointsAction.action( HistoryAction::Type::Redo );
+    EXPECT_EQ( objMesh->mesh()->points, points2 );
+}
+
 } // namespace MR
@@ -7,7 +7,10 @@
 #include "MRPlane3.h"
 #include "MRMeshBuilder.h"
 #include "MRMeshDelone.h"
+#include "MRTorus.h"
 #include "MRHash.h"
+#include "MRParallelFor.h"
+#include "MRScratchVector.h"
 #include "MRPch/MRTBB.h"
 #include "MRPch/MRSpdlog.h"
 #include "MRGTest.h"
@@ -47,7 +50,25 @@ bool operator<( const WeightedConn& left, const WeightedConn& right )
     return left.weight > right.weight;
 }
 
-typedef std::vector<std::vector<WeightedConn>> NewEdgesMap;
+// table of connections between the vertices of loops, all rows are stored in one scratch buffer
+class NewEdgesMap
+{
+public:
+    NewEdgesMap( size_t rows, size_t cols, const WeightedConn & init = {} ) : cols_( cols )
+    {
+        buf_->resize( rows * cols, init );
+    }
+
+    WeightedConn * operator[]( size_t row ) { return buf_->data() + row * cols_; }
+    const WeightedConn * operator[]( size_t row ) const { return buf_->data() + row * cols_; }
+
+    /// the connection in the last column of the last row
+    WeightedConn & last() { return buf_->back(); }
+
+private:
+    ScratchVector<WeightedConn> buf_;
+    size_t cols_ = 0;
+};
 
 bool sameEdgeExists( const MeshTopology& topology, EdgeId e1Org, EdgeId e2Org )
 {
@@ -436,7 +457,7 @@ void buildCylinderBetweenTwoHoles( Mesh & mesh, EdgeId a0, EdgeId b0, const Stit
 
     // [0..aLoopEdgesCounter][0..bLoopEdgesCounter]
     // last one represents the same edge as first one, but reaching it means that algorithm has finished
-    NewEdgesMap newEdgesMap( aLoopEdgesCounter + 1, std::vector<WeightedConn>( bLoopEdgesCounter + 1 ) );
+    NewEdgesMap newEdgesMap( aLoopEdgesCounter + 1, bLoopEdgesCounter + 1 );
 
     WeightedConn& firstWConn = newEdgesMap[0][0];
     firstWConn.a = 0; firstWConn.b = 0; firstWConn.weight = std::sqrt( minDistSq );
@@ -454,7 +475,7 @@ void buildCylinderBetweenTwoHoles( Mesh & mesh, EdgeId a0, EdgeId b0, const Stit
         processCandidate( mesh, current, queue, newEdgesMap, aEdgeMap, bEdgeMap, metrics, false );
     } while ( !queue.empty() );
 
-    current = newEdgesMap.back().back();
+    current = newEdgesMap.last();
     // connect two boundaries with the first edge
     EdgeId e1 = mesh.topology.makeEdge();
     mesh.topology.splice( ac, e1 );
@@ -596,7 +617,9 @@ HoleFillPlan getHoleFillPlan( const Mesh& mesh, EdgeId a0, const FillHoleParams&
     }
 
     // Fill EdgeMaps
-    std::vector<EdgeId> edgeMap( loopEdgesCounter );
+    ScratchVector<EdgeId> edgeMapBuf;
+    auto & edgeMap = *edgeMapBuf;
+    edgeMap.resize( loopEdgesCounter );
     a = a0;
     for ( unsigned i = 0; i < loopEdgesCounter; ++i )
     {
@@ -604,7 +627,7 @@ HoleFillPlan getHoleFillPlan( const Mesh& mesh, EdgeId a0, const FillHoleParams&
         a = mesh.topology.prev( a.sym() );
     }
 
-    NewEdgesMap newEdgesMap( loopEdgesCounter, std::vector<WeightedConn>( loopEdgesCounter, { -1,-1,0.0,0 } ) );
+    NewEdgesMap newEdgesMap( loopEdgesCounter, loopEdgesCounter, { -1,-1,0.0,0 } );
 
     FillHoleMetric metrics = params.metric;
     if ( !metrics.edgeMetric && !metrics.triangleMetric )
@@ -619,7 +642,8 @@ HoleFillPlan getHoleFillPlan( const Mesh& mesh, EdgeId a0, const FillHoleParams&
     {
         tbb::parallel_for( tbb::blocked_range<unsigned>( 0, loopEdgesCounter, 15 ), [&]( const tbb::blocked_range<unsigned>& range )
         {
-            std::vector<unsigned> optimalStepsCache;
+            ScratchVector<unsigned> optimalStepsCacheBuf;
+            auto & optimalStepsCache = *optimalStepsCacheBuf;
             optimalStepsCache.resize( params.maxPolygonSubdivisions );
             for ( unsigned i = range.begin(); i < range.end(); ++i )
             {
@@ -739,6 +763,34 @@ HoleFillPlan getPlanarHoleFillPlan( const Mesh& mesh, EdgeId e )
     return res;
 }
 
+std::vector<HoleFillPlan> getHoleFillPlans( const Mesh& mesh, const std::vector<EdgeId>& holeRepresentativeEdges,
+    const FillHoleParams& params, ProgressCallback cb )
+{
+    MR_TIMER
+    FillHoleParams localParams = params;
+    localParams.stopBeforeBadTriangulation = nullptr;
+
+    std::vector<HoleFillPlan> res( holeRepresentativeEdges.size() );
+    if ( !ParallelFor( res, [&]( size_t i )
+    {
+        res[i] = getHoleFillPlan( mesh, holeRepresentativeEdges[i], localParams );
+    }, cb, 1 ) )
+        return {};
+    return res;
+}
+
+std::vector<HoleFillPlan> getPlanarHoleFillPlans( const Mesh& mesh, const std::vector<EdgeId>& holeRepresentativeEdges, ProgressCallback cb )
+{
+    MR_TIMER
+    std::vector<HoleFillPlan> res( holeRepresentativeEdges.size() );
+    if ( !ParallelFor( res, [&]( size_t i )
+    {
+        res[i] = getPlanarHoleFillPlan( mesh, holeRepresentativeEdges[i] );
+    }, cb, 1 ) )
+        return {};
+    return res;
+}
+
 bool isHoleBd( const MeshTopology & topology, const EdgeLoop & loop )
 {
     if ( loop.empty() )
@@ -810,14 +862,80 @@ void fillHole( Mesh& mesh, EdgeId a0, const FillHoleParams& params )
     executeHoleFillPlan( mesh, a0, plan, params.outNewFaces );
 }
 
-void fillHoles( Mesh& mesh, const std::vector<EdgeId> & as, const FillHoleParams& params )
+bool fillHoles( Mesh& mesh, const std::vector<EdgeId> & as, const FillHoleParams& params, ProgressCallback cb )
 {
     MR_TIMER
+    MR_WRITER( mesh );
+    if ( params.stopBeforeBadTriangulation )
+        *params.stopBeforeBadTriangulation = false;
 
-    // TODO: parallel getHoleFillPlan
-
+    // holes having 2 or less edges and the holes sharing vertices with previous holes are filled sequentially,
+    // because the triangulation of one hole can change the best triangulation of another one
+    struct PlannedHole
+    {
+        EdgeId e;
+        HoleFillPlan plan;
+        bool bad = false;
+    };
+    std::vector<PlannedHole> planned;
+    std::vector<EdgeId> sequential;
+    VertBitSet holeVerts( mesh.topology.vertSize() );
     for ( auto a : as )
-        fillHole( mesh, a, params );
+    {
+        assert( !mesh.topology.left( a ) );
+        if ( mesh.topology.left( a ) )
+            continue;
+        if ( params.makeDegenerateBand )
+            a = makeDegenerateBandAroundHole( mesh, a, params.outNewFaces );
+        bool shared = false;
+        int numEdges = 0;
+        for ( auto e : leftRing( mesh.topology, a ) )
+        {
+            ++numEdges;
+            auto v = mesh.topology.org( e );
+            if ( holeVerts.test( v ) )
+                shared = true;
+            holeVerts.autoResizeSet( v );
+        }
+        if ( shared || numEdges <= 2 )
+            sequential.push_back( a );
+        else
+            planned.push_back( { a, {}, false } );
+    }
+
+    FillHoleParams localParams = params;
+    localParams.makeDegenerateBand = false; // already made above
+    localParams.outNewFaces = nullptr;
+    const auto plannedShare = float( planned.size() ) / std::max( size_t( 1 ), planned.size() + sequential.size() );
+    if ( !ParallelFor( planned, [&]( size_t i )
+    {
+        auto lp = localParams;
+        lp.stopBeforeBadTriangulation = params.stopBeforeBadTriangulation ? &planned[i].bad : nullptr;
+        planned[i].plan = getHoleFillPlan( mesh, planned[i].e, lp );
+    }, subprogress( cb, 0.0f, plannedShare ), 1 ) )
+        return false;
+
+    for ( auto & h : planned )
+    {
+        if ( h.bad )
+            *params.stopBeforeBadTriangulation = true;
+        else
+            executeHoleFillPlan( mesh, h.e, h.plan, params.outNewFaces );
+    }
+
+    localParams.outNewFaces = params.outNewFaces;
+    bool bad = false;
+    if ( params.stopBeforeBadTriangulation )
+        localParams.stopBeforeBadTriangulation = &bad;
+    for ( size_t i = 0; i < sequential.size(); ++i )
+    {
+        fillHole( mesh, sequential[i], localParams );
+        if ( bad )
+            *params.stopBeforeBadTriangulation = true;
+        if ( !reportProgress( cb, plannedShare + ( 1 - plannedShare ) * float( i + 1 ) / sequential.size() ) )
+            return false;
+    }
+    return true;
 }
 
 VertId fillHoleTrivially( Mesh& mesh, EdgeId a, FaceBitSet * outNewFaces /*= nullptr */ )
@@ -1119,6 +1237,61 @@ TEST( MRMesh, buildCylinderBetweenTwoHoles )
     EXPECT_EQ( bdEdges.size(), 0 );
 }
 
+TEST( MRMesh, fillHoles )
+{
+    auto mesh = makeTorus();
+    const auto numFaces0 = mesh.topology.numValidFaces();
+
+    // three separated holes, each around a deleted vertex star
+    FaceBitSet del;
+    for ( auto v : { 0_v, 100_v, 200_v } )
+        for ( auto e : orgRing( mesh.topology, v ) )
+            del.autoResizeSet( mesh.topology.left( e ) );
+    mesh.topology.deleteFaces( del );
+    auto holes = mesh.topology.findHoleRepresentiveEdges();
+    EXPECT_EQ( holes.size(), 3 );
+
+    FaceBitSet newFaces;
+    FillHoleParams params;
+    params.outNewFaces = &newFaces;
+    EXPECT_TRUE( fillHoles( mesh, holes, params ) );
+    EXPECT_EQ( mesh.topology.findHoleRepresentiveEdges().size(), 0 );
+    EXPECT_EQ( mesh.topology.numValidFaces(), numFaces0 - del.count() + newFaces.count() );
+
+    // canceled operation
+    mesh.topology.deleteFaces( newFaces );
+    holes = mesh.topology.findHoleRepresentiveEdges();
+    EXPECT_EQ( holes.size(), 3 );
+    EXPECT_FALSE( fillHoles( mesh, holes, {}, []( float ) { return false; } ) );
+}
+
+TEST( MRMesh, HoleFillPlanScratch )
+{
+    auto mesh = makeTorus();
+    FaceBitSet del;
+    for ( auto e : orgRing( mesh.topology, 0_v ) )
+        del.autoResizeSet( mesh.topology.left( e ) );
+    mesh.topology.deleteFaces( del );
+    const auto hole = mesh.topology.findHoleRepresentiveEdges().front();
+
+    // single thread to get all buffers from the same pool
+    tbb::task_arena arena( 1 );
+    arena.execute( [&]
+    {
+        const auto plan0 = getHoleFillPlan( mesh, hole );
+        resetScratchStats();
+        const auto plan1 = getHoleFillPlan( mesh, hole );
+        EXPECT_EQ( plan1.numTris, plan0.numTris );
+        EXPECT_EQ( plan1.items.size(), plan0.items.size() );
+
+        // repeated plan takes all its buffers from the pool without new allocations
+        const auto stats = getScratchStats();
+        EXPECT_GE( stats.acquired, 3 );
+        EXPECT_EQ( stats.reused, stats.acquired );
+        EXPECT_EQ( stats.grown, 0 );
+    } );
+}
+
 TEST( MRMesh, makeBridge )
 {
     MeshTopology topology;
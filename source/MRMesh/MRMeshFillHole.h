@@ -132,8 +132,13 @@ MRMESH_API bool buildCylinderBetweenTwoHoles( Mesh & mesh, const StitchHolesPara
   */
 MRMESH_API void fillHole( Mesh& mesh, EdgeId a, const FillHoleParams& params = {} );
 
-/// fill all holes given by their representative edges in \param as
-MRMESH_API void fillHoles( Mesh& mesh, const std::vector<EdgeId> & as, const FillHoleParams& params = {} );
+/// fill all holes given by their representative edges in \param as;
+/// the plans for the holes not sharing vertices with other holes are prepared in parallel and then executed one by one,
+/// the remaining holes are filled sequentially after them;
+/// if params.stopBeforeBadTriangulation is given then it is set to true if at least one hole was left unfilled due to bad triangulation
+/// \param cb optional progress callback, which can cancel the operation between holes
+/// \return false if the operation was canceled and some holes can remain unfilled
+MRMESH_API bool fillHoles( Mesh& mesh, const std::vector<EdgeId> & as, const FillHoleParams& params = {}, ProgressCallback cb = {} );
 
 /// returns true if given loop is a boundary of one hole in given mesh topology:
 /// * every edge in the loop does not have left face,
@@ -159,10 +164,23 @@ struct HoleFillPlan
 /// several getHoleFillPlan can work in parallel
 MRMESH_API HoleFillPlan getHoleFillPlan( const Mesh& mesh, EdgeId e, const FillHoleParams& params = {} );
 
+/// prepares the plans how to triangulate the faces or holes, each given by a boundary edge (with filling target to the left),
+/// the plans are prepared in parallel, all given holes must be distinct;
+/// params.stopBeforeBadTriangulation is ignored here
+/// \param cb optional progress callback, if it cancels the operation then empty vector is returned
+[[nodiscard]] MRMESH_API std::vector<HoleFillPlan> getHoleFillPlans( const Mesh& mesh, const std::vector<EdgeId>& holeRepresentativeEdges,
+    const FillHoleParams& params = {}, ProgressCallback cb = {} );
+
 /// prepares the plan how to triangulate the planar face or planar hole to the left of (e) (not filling it immediately),
 /// several getPlanarHoleFillPlan can work in parallel
 MRMESH_API HoleFillPlan getPlanarHoleFillPlan( const Mesh& mesh, EdgeId e );
 
+/// prepares the plans how to triangulate the planar faces or holes, each given by a boundary edge (with filling target to the left),
+/// the plans are prepared in parallel
+/// \param cb optional progress callback, if it cancels the operation then empty vector is returned
+[[nodiscard]] MRMESH_API std::vector<HoleFillPlan> getPlanarHoleFillPlans( const Mesh& mesh, const std::vector<EdgeId>& holeRepresentativeEdges,
+    ProgressCallback cb = {} );
+
 /// quickly triangulates the face or hole to the left of (e) given the plan (quickly compared to fillHole function)
 MRMESH_API void executeHoleFillPlan( Mesh & mesh, EdgeId a0, HoleFillPlan & plan, FaceBitSet * outNewFaces = nullptr );
 
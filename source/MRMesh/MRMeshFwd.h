@@ -479,6 +479,7 @@ struct MRMESH_CLASS CloudPartMapping;
 struct MRMESH_CLASS PartMapping;
 struct MeshOrPointsXf;
 struct MeshTexture;
+struct MeshLods;
 struct GridSettings;
 struct TriMesh;
 
@@ -147,6 +147,152 @@ MeshIntersectionResult rayMeshIntersect( const MeshPart& meshPart, const Line3d&
     }
 }
 
+template<typename T>
+void rayPacketMeshIntersect_( const MeshPart& meshPart, const Vector3<T>* origins, int numRays, const Vector3<T>& dir,
+    MeshIntersectionResult* res, T rayStart, T rayEnd, const IntersectionPrecomputes<T>& prec, bool closestIntersect, const FacePredicate & validFaces )
+{
+    assert( numRays >= 0 && numRays <= RayPacketSize );
+    for ( int i = 0; i < numRays; ++i )
+        res[i] = {};
+
+    const auto& m = meshPart.mesh;
+    constexpr int maxTreeDepth = 32;
+    const auto& tree = m.getAABBTree();
+    if ( tree.nodes().size() == 0 || numRays <= 0 )
+        return;
+
+    // i-th bit is set if i-th ray of the packet still searches for intersection
+    using Mask = unsigned;
+    Mask active = ( Mask( 1 ) << numRays ) - 1;
+
+    RayOrigin<T> rayOrigins[RayPacketSize];
+    T rayEnds[RayPacketSize];
+    FaceId faceIds[RayPacketSize];
+    TriPointf triPs[RayPacketSize];
+    for ( int i = 0; i < numRays; ++i )
+    {
+        rayOrigins[i] = RayOrigin<T>{ origins[i] };
+        rayEnds[i] = rayEnd;
+    }
+
+    // each node keeps the rays that intersected its parent box, and it is tested against the rays when popped from the stack,
+    // so the rays shortened by found intersections meanwhile are not considered
+    std::pair<NodeId, Mask> nodesStack[maxTreeDepth];
+    int currentNode = 0;
+    nodesStack[0] = { tree.rootNodeId(), active };
+
+    while ( currentNode >= 0 && active )
+    {
+        if ( currentNode >= maxTreeDepth ) // max depth exceeded
+        {
+            spdlog::critical( "Maximal AABBTree depth reached!" );
+            assert( false );
+            break;
+        }
+
+        const auto [nodeId, parentMask] = nodesStack[currentNode--];
+        const auto& node = tree[nodeId];
+        const Box3<T> box{ node.box };
+        Mask mask = 0;
+        for ( int i = 0; i < numRays; ++i )
+        {
+            const Mask bit = Mask( 1 ) << i;
+            if ( !( parentMask & active & bit ) )
+                continue;
+            T s = rayStart, e = rayEnds[i];
+            if ( rayBoxIntersect( box, rayOrigins[i], s, e, prec ) && s < rayEnds[i] )
+                mask |= bit;
+        }
+        if ( !mask )
+            continue;
+
+        if ( node.leaf() )
+        {
+            auto face = node.leafId();
+            if ( ( meshPart.region && !meshPart.region->test( face ) ) || ( validFaces && !validFaces( face ) ) )
+                continue;
+            VertId a, b, c;
+            m.topology.getTriVerts( face, a, b, c );
+            const Vector3<T> pA( m.points[a] );
+            const Vector3<T> pB( m.points[b] );
+            const Vector3<T> pC( m.points[c] );
+            for ( int i = 0; i < numRays; ++i )
+            {
+                const Mask bit = Mask( 1 ) << i;
+                if ( !( mask & bit ) )
+                    continue;
+                if ( auto triIsect = rayTriangleIntersect( pA - origins[i], pB - origins[i], pC - origins[i], prec ) )
+                {
+                    if ( triIsect->t < rayEnds[i] && triIsect->t > rayStart )
+                    {
+                        faceIds[i] = face;
+                        triPs[i] = triIsect->bary;
+                        rayEnds[i] = triIsect->t;
+                        if ( !closestIntersect )
+                            active &= ~bit;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // all rays have the same direction, so visit first the child with the center closer to ray origins
+            const auto& lBox = tree[node.l].box;
+            const auto& rBox = tree[node.r].box;
+            if ( dot( Vector3<T>( lBox.center() - rBox.center() ), dir ) > 0 )
+            {
+                nodesStack[++currentNode] = { node.l, mask };
+                nodesStack[++currentNode] = { node.r, mask };
+            }
+            else
+            {
+                nodesStack[++currentNode] = { node.r, mask };
+                nodesStack[++currentNode] = { node.l, mask };
+            }
+        }
+    }
+
+    for ( int i = 0; i < numRays; ++i )
+    {
+        if ( !faceIds[i] )
+            continue;
+        res[i].proj.face = faceIds[i];
+        res[i].proj.point = Vector3f( origins[i] + rayEnds[i] * dir );
+        res[i].mtp = MeshTriPoint( m.topology.edgeWithLeft( faceIds[i] ), triPs[i] );
+        res[i].distanceAlongLine = float( rayEnds[i] );
+    }
+}
+
+void rayPacketMeshIntersect( const MeshPart& meshPart, const Vector3f* origins, int numRays, const Vector3f& dir,
+    MeshIntersectionResult* res, float rayStart, float rayEnd, const IntersectionPrecomputes<float>* prec,
+    bool closestIntersect, const FacePredicate & validFaces )
+{
+    if( prec )
+    {
+        rayPacketMeshIntersect_<float>( meshPart, origins, numRays, dir, res, rayStart, rayEnd, *prec, closestIntersect, validFaces );
+    }
+    else
+    {
+        const IntersectionPrecomputes<float> precNew( dir );
+        rayPacketMeshIntersect_<float>( meshPart, origins, numRays, dir, res, rayStart, rayEnd, precNew, closestIntersect, validFaces );
+    }
+}
+
+void rayPacketMeshIntersect( const MeshPart& meshPart, const Vector3d* origins, int numRays, const Vector3d& dir,
+    MeshIntersectionResult* res, double rayStart, double rayEnd, const IntersectionPrecomputes<double>* prec,
+    bool closestIntersect, const FacePredicate & validFaces )
+{
+    if( prec )
+    {
+        rayPacketMeshIntersect_<double>( meshPart, origins, numRays, dir, res, rayStart, rayEnd, *prec, closestIntersect, validFaces );
+    }
+    else
+    {
+        const IntersectionPrecomputes<double> precNew( dir );
+        rayPacketMeshIntersect_<double>( meshPart, origins, numRays, dir, res, rayStart, rayEnd, precNew, closestIntersect, validFaces );
+    }
+}
+
 void multiRayMeshIntersect(
     const MeshPart& meshPart,
     const std::vector<Vector3f>& origins,
@@ -190,13 +336,14 @@ void multiRayMeshIntersect(
 
     meshPart.mesh.getAABBTree(); // prepare tree before parallel region
 
-    auto processRay = [&]( size_t i )
+    auto storeResult = [&]( size_t i, const MeshIntersectionResult & res )
     {
-        auto res = rayMeshIntersect( meshPart, Line3f( origins[i], dirs[i] ), rayStart, rayEnd, nullptr, closestIntersect, validFaces );
         if ( !res )
             return;
         if ( result.intersectingRays )
             result.intersectingRays->set( i );
+        if ( result.rayParams )
+            (*result.rayParams)[i] = res.distanceAlongLine;
         if ( result.isectFaces )
             (*result.isectFaces)[i] = res.proj.face;
         if ( result.isectBary )
@@ -205,10 +352,33 @@ void multiRayMeshIntersect(
             (*result.isectPts)[i] = res.proj.point;
     };
 
-    if ( result.intersectingRays )
-        BitSetParallelForAll( *result.intersectingRays, processRay );
-    else
-        ParallelFor( size_t( 0 ), sz, processRay );
+    // each block has whole number of bit set words, so different threads never modify the same word in intersectingRays
+    constexpr size_t raysInBlock = BitSet::bits_per_block;
+    static_assert( raysInBlock % RayPacketSize == 0 );
+    const size_t numBlocks = ( sz + raysInBlock - 1 ) / raysInBlock;
+    ParallelFor( size_t( 0 ), numBlocks, [&]( size_t block )
+    {
+        const auto blockEnd = std::min( sz, ( block + 1 ) * raysInBlock );
+        MeshIntersectionResult packetRes[RayPacketSize];
+        for ( size_t i0 = block * raysInBlock; i0 < blockEnd; i0 += RayPacketSize )
+        {
+            const auto packetEnd = std::min( blockEnd, i0 + RayPacketSize );
+            bool sameDir = true;
+            for ( auto i = i0 + 1; sameDir && i < packetEnd; ++i )
+                sameDir = dirs[i] == dirs[i0];
+            if ( sameDir )
+            {
+                rayPacketMeshIntersect( meshPart, origins.data() + i0, int( packetEnd - i0 ), dirs[i0], packetRes, rayStart, rayEnd, nullptr, closestIntersect, validFaces );
+                for ( auto i = i0; i < packetEnd; ++i )
+                    storeResult( i, packetRes[i - i0] );
+            }
+            else
+            {
+                for ( auto i = i0; i < packetEnd; ++i )
+                    storeResult( i, rayMeshIntersect( meshPart, Line3f( origins[i], dirs[i] ), rayStart, rayEnd, nullptr, closestIntersect, validFaces ) );
+            }
+        }
+    } );
 }
 
 template<typename T>
@@ -475,4 +645,44 @@ TEST(MRMesh, MeshIntersect)
     }
 }
 
+TEST(MRMesh, RayPacketMeshIntersect)
+{
+    Mesh sphere = makeUVSphere( 1, 16, 16 );
+    const Vector3f dir = Vector3f( 1, 2, -3 ).normalized();
+    const auto [x, y] = dir.perpendicular();
+
+    std::vector<Vector3f> origins;
+    for ( int i = -10; i <= 10; ++i )
+        for ( int j = -10; j <= 10; ++j )
+            origins.push_back( -2.0f * dir + 0.1f * float( i ) * x + 0.1f * float( j ) * y );
+
+    for ( size_t i0 = 0; i0 < origins.size(); i0 += RayPacketSize )
+    {
+        const int n = int( std::min( origins.size() - i0, size_t( RayPacketSize ) ) );
+        MeshIntersectionResult res[RayPacketSize];
+        rayPacketMeshIntersect( sphere, origins.data() + i0, n, dir, res );
+        for ( int i = 0; i < n; ++i )
+        {
+            const auto ref = rayMeshIntersect( sphere, Line3f( origins[i0 + i], dir ) );
+            EXPECT_EQ( bool( res[i] ), bool( ref ) );
+            if ( ref )
+            {
+                EXPECT_EQ( res[i].distanceAlongLine, ref.distanceAlongLine );
+            }
+        }
+    }
+
+    std::vector<float> rayParams;
+    multiRayMeshIntersect( sphere, origins, std::vector<Vector3f>( origins.size(), dir ), { .rayParams = &rayParams } );
+    ASSERT_EQ( rayParams.size(), origins.size() );
+    for ( size_t i = 0; i < origins.size(); ++i )
+    {
+        const auto ref = rayMeshIntersect( sphere, Line3f( origins[i], dir ) );
+        if ( ref )
+            EXPECT_EQ( rayParams[i], ref.distanceAlongLine );
+        else
+            EXPECT_TRUE( std::isnan( rayParams[i] ) );
+    }
+}
+
 } //namespace MR
@@ -46,6 +46,22 @@ struct MeshIntersectionResult
     double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr, bool closestIntersect = true,
     const FacePredicate & validFaces = {} );
 
+/// the maximal number of rays processed together by rayPacketMeshIntersect
+constexpr int RayPacketSize = 8;
+
+/// Finds intersections between a mesh and up to RayPacketSize parallel rays with common direction \p dir (in float-precision).
+/// All rays of the packet traverse AABB tree together, which is faster than independent rayMeshIntersect calls for close rays (e.g. from neighbor pixels).
+/// The result for each ray is the same as from rayMeshIntersect, except for the choice among several triangles intersected exactly at the same distance.
+/// \p res must point on the array of \p numRays elements to be filled
+MRMESH_API void rayPacketMeshIntersect( const MeshPart& meshPart, const Vector3f* origins, int numRays, const Vector3f& dir,
+    MeshIntersectionResult* res, float rayStart = 0.0f, float rayEnd = FLT_MAX, const IntersectionPrecomputes<float>* prec = nullptr,
+    bool closestIntersect = true, const FacePredicate & validFaces = {} );
+
+/// Same as rayPacketMeshIntersect above, but in double-precision
+MRMESH_API void rayPacketMeshIntersect( const MeshPart& meshPart, const Vector3d* origins, int numRays, const Vector3d& dir,
+    MeshIntersectionResult* res, double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr,
+    bool closestIntersect = true, const FacePredicate & validFaces = {} );
+
 struct MultiRayMeshIntersectResult
 {
     // outputs (each one if optional) for every ray:
@@ -57,6 +73,7 @@ struct MultiRayMeshIntersectResult
 };
 
 /// Finds intersections between a mesh and multiple rays in parallel (in float-precision).
+/// Consecutive rays with equal directions are processed in packets by rayPacketMeshIntersect.
 /// \p rayStart and \p rayEnd define the interval on all rays to detect an intersection.
 /// \p vadidFaces if given then all faces for which false is returned will be skipped
 MRMESH_API void multiRayMeshIntersect(
@@ -15,10 +15,15 @@
 #include "MRIOParsing.h"
 #include "MRMeshDelone.h"
 #include "MRParallelFor.h"
+#include "MRMeshSave.h"
+#include "MRMeshCompress.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include "MRPch/MRFmt.h"
 #include "MRPch/MRTBB.h"
 
 #include <array>
+#include <atomic>
 #include <future>
 
 namespace MR
@@ -40,6 +45,9 @@ Expected<Mesh> fromMrmesh( std::istream& in, const MeshLoadSettings& settings /*
 {
     MR_TIMER
 
+    if ( in.peek() == MeshCompressMagic[0] )
+        return decompressMesh( in, settings.callback );
+
     Mesh mesh;
     auto readRes = mesh.topology.read( in, subprogress( settings.callback, 0.f, 0.5f) );
     if ( !readRes.has_value() )
@@ -379,80 +387,93 @@ Expected<Mesh> fromASCIIStl( std::istream& in, const MeshLoadSettings& settings
 {
     MR_TIMER;
 
-    using HMap = ParallelHashMap<Vector3f, VertId>;
-    HMap hmap;
-    VertCoords points;
-    Triangulation t;
-
-    std::string line;
-    std::string prefix;
-    Vector3f point;
-    ThreeVertIds currTri;
-    int triPos = 0;
-    bool solidFound = false;
-
-    const auto posStart = in.tellg();
-    const auto streamSize = getStreamSize( in );
+    auto buf = readCharBuffer( in );
+    if ( !buf )
+        return unexpected( std::move( buf.error() ) );
+    const std::string_view text( buf->data(), buf->size() );
 
-    for ( int i = 0; std::getline( in, line ); ++i )
+    auto skipSpaces = [] ( std::string_view str )
     {
-        std::istringstream iss( line );
-        if ( !( iss >> prefix ) )
-            break;
+        const auto pos = str.find_first_not_of( " \t\r" );
+        return pos == std::string_view::npos ? std::string_view{} : str.substr( pos );
+    };
+    if ( !skipSpaces( text ).starts_with( "solid" ) )
+        return unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
 
-        if ( !solidFound )
-        {
-            if ( prefix == "solid" )
-                solidFound = true;
-            else
-                break;
-        }
+    if ( !reportProgress( settings.callback, 0.1f ) )
+        return unexpected( std::string( "Loading canceled" ) );
 
-        if ( prefix == "outer" )
-        {
-            triPos = 0;
-            continue;
-        }
-        if ( prefix == "vertex" )
+    // the text is parsed in parallel by parts starting from new lines, each part collects its vertices in the order of appearance
+    const auto chunks = splitByLineChunks( buf->data(), buf->size() );
+    const auto numChunks = chunks.size() - 1;
+    std::vector<std::vector<Vector3f>> chunkVerts( numChunks );
+    std::string parseError;
+    std::atomic<bool> failed{ false };
+    const auto keepGoing = ParallelFor( size_t( 0 ), numChunks, [&] ( size_t ci )
+    {
+        // skip remaining parts after the first parsing error
+        if ( failed )
+            return;
+        auto & verts = chunkVerts[ci];
+        auto chunk = text.substr( chunks[ci], chunks[ci + 1] - chunks[ci] );
+        while ( !chunk.empty() )
         {
-            double x, y, z; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
-            if ( !( iss >> x >> y >> z ) )
-                break;
-            point = Vector3f{ Vector3d{ x, y, z } };
-
-            VertId& id = hmap[point];
-            if ( !id.valid() )
+            const auto nl = chunk.find( '\n' );
+            auto line = skipSpaces( chunk.substr( 0, nl ) );
+            chunk.remove_prefix( nl == std::string_view::npos ? chunk.size() : nl + 1 );
+            if ( !line.starts_with( "vertex" ) )
+                continue;
+            line.remove_prefix( 6 );
+            Vector3d p; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
+            if ( auto res = parseTextCoordinate( line, p ); !res )
             {
-                id = VertId( points.size() );
-                points.push_back( point );
+                if ( !failed.exchange( true ) )
+                    parseError = std::move( res.error() );
+                return;
             }
-            currTri[triPos] = id;
-            ++triPos;
-            continue;
+            verts.push_back( Vector3f( p ) );
         }
-        if ( prefix == "endloop" )
-        {
-            t.push_back( currTri );
-            continue;
-        }
-        if ( settings.callback && !( i & 0x3FF ) )
+    }, subprogress( settings.callback, 0.1f, 0.5f ) );
+
+    if ( !keepGoing )
+        return unexpected( std::string( "Loading canceled" ) );
+    if ( !parseError.empty() )
+        return unexpected( std::move( parseError ) );
+
+    size_t numVerts = 0;
+    for ( const auto & verts : chunkVerts )
+        numVerts += verts.size();
+    if ( numVerts % 3 != 0 )
+        return unexpected( std::string( "The number of vertices in ascii STL is not divisible by 3" ) );
+
+    std::vector<Triangle3f> tris( numVerts / 3 );
+    size_t k = 0;
+    for ( auto & verts : chunkVerts )
+    {
+        for ( const auto & v : verts )
         {
-            const float progress = float( in.tellg() - posStart ) / float( streamSize );
-            if ( !settings.callback( progress ) )
-                return unexpected( std::string( "Loading canceled" ) );
+            tris[k / 3][k % 3] = v;
+            ++k;
         }
+        verts = {};
     }
 
-    if ( !solidFound )
-        return unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
+    MeshBuilder::VertexIdentifier vi;
+    vi.reserve( tris.size() );
+    vi.addTriangles( tris );
+    if ( !reportProgress( settings.callback, 0.75f ) )
+        return unexpected( std::string( "Loading canceled" ) );
 
+    auto t = vi.takeTriangulation();
     std::vector<MeshBuilder::VertDuplication> dups;
     std::vector<MeshBuilder::VertDuplication>* dupsPtr = nullptr;
     if ( settings.duplicatedVertexCount )
         dupsPtr = &dups;
-    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t, dupsPtr, { .skippedFaceCount = settings.skippedFaceCount } );
+    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( vi.takePoints(), t, dupsPtr, { .skippedFaceCount = settings.skippedFaceCount } );
     if ( settings.duplicatedVertexCount )
         *settings.duplicatedVertexCount = int( dups.size() );
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpected( std::string( "Loading canceled" ) );
     return res;
 }
 
@@ -685,6 +706,27 @@ MR_ADD_MESH_LOADER( IOFilter( "3D model object (.obj)", "*.obj" ), fromObj )
 MR_ADD_MESH_LOADER( IOFilter( "Polygon File Format (.ply)", "*.ply" ), fromPly )
 MR_ADD_MESH_LOADER( IOFilter( "Drawing Interchange Format (.dxf)", "*.dxf" ), fromDxf )
 
+TEST( MRMesh, LoadAsciiStl )
+{
+    // large enough to be parsed in several parts
+    const auto torus = makeTorus( 1.0f, 0.3f, 64, 64 );
+    std::stringstream ss;
+    ASSERT_TRUE( MeshSave::toAsciiStl( torus, ss ).has_value() );
+    EXPECT_GT( ss.str().size(), 1 << 20 );
+
+    auto loaded = fromASCIIStl( ss );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->topology.numValidFaces(), torus.topology.numValidFaces() );
+    EXPECT_EQ( loaded->topology.numValidVerts(), torus.topology.numValidVerts() );
+    EXPECT_TRUE( loaded->topology.isClosed() );
+    EXPECT_NEAR( loaded->volume(), torus.volume(), 1e-4 );
+
+    std::stringstream bad( "solid x\n facet normal 0 0 1\n outer loop\n vertex 0 0 0\n vertex 1 0 0\n endloop\n endfacet\nendsolid\n" );
+    EXPECT_FALSE( fromASCIIStl( bad ).has_value() );
+    std::stringstream notStl( "hello" );
+    EXPECT_FALSE( fromASCIIStl( notStl ).has_value() );
+}
+
 } //namespace MeshLoad
 
 } //namespace MR
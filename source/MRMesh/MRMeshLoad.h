@@ -20,7 +20,7 @@ namespace MeshLoad
 /// \ingroup IOGroup
 /// \{
 
-/// loads from internal file format
+/// loads from internal file format, both original one and compressed by compressMesh( )
 MRMESH_API Expected<Mesh> fromMrmesh( const std::filesystem::path& file, const MeshLoadSettings& settings = {} );
 MRMESH_API Expected<Mesh> fromMrmesh( std::istream& in, const MeshLoadSettings& settings = {} );
 
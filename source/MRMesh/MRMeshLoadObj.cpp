@@ -7,6 +7,7 @@
 #include "MRIOParsing.h"
 #include "MRImageLoad.h"
 #include "MRMeshBuilder.h"
+#include "MRParallelFor.h"
 #include "MRObjectMesh.h"
 #include "MRStringConvert.h"
 #include "MRTimer.h"
@@ -18,6 +19,7 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/spirit/home/x3.hpp>
 
+#include <algorithm>
 #include <map>
 
 namespace
@@ -160,20 +162,50 @@ namespace
     };
 
     template <typename Element>
-    std::vector<ElementGroup<Element>> groupLines( const char* data, size_t, const std::vector<size_t>& newlines )
+    std::vector<ElementGroup<Element>> groupLines( const char* data, size_t size, const std::vector<size_t>& newlines )
     {
         const auto lineCount = newlines.size() - 1;
 
+        // the lines are grouped in parallel by parts of the text starting from new lines,
+        // then the groups of all parts are concatenated in order joining the groups of the same element at part boundaries
+        const auto chunks = splitByLineChunks( data, size );
+        const auto numChunks = chunks.size() - 1;
+        std::vector<std::vector<ElementGroup<Element>>> chunkGroups( numChunks );
+        ParallelFor( size_t( 0 ), numChunks, [&] ( size_t ci )
+        {
+            // each part begins at the start of some line
+            const auto begin = size_t( std::lower_bound( newlines.begin(), newlines.end(), chunks[ci] ) - newlines.begin() );
+            const auto end = ci + 1 < numChunks ? size_t( std::lower_bound( newlines.begin() + begin, newlines.end(), chunks[ci + 1] ) - newlines.begin() ) : lineCount;
+            auto & groups = chunkGroups[ci];
+            for ( size_t li = begin; li < end; li++ )
+            {
+                std::string_view line( data + newlines[li], newlines[li + 1] - newlines[li + 0] );
+                const auto element = parseToken<Element>( line );
+                if ( groups.empty() || element != groups.back().element )
+                {
+                    if ( !groups.empty() )
+                        groups.back().end = li;
+                    groups.push_back( { element, li, 0 } );
+                }
+            }
+            if ( !groups.empty() )
+                groups.back().end = end;
+        } );
+
         std::vector<ElementGroup<Element>> groups{ { Element(), 0, 0 } }; // emplace stub initial group
-        for ( size_t li = 0; li < lineCount; li++ )
+        for ( auto & partGroups : chunkGroups )
         {
-            std::string_view line( data + newlines[li], newlines[li + 1] - newlines[li + 0] );
-            const auto element = parseToken<Element>( line );
-            if ( element != groups.back().element )
+            for ( const auto & group : partGroups )
             {
-                groups.back().end = li;
-                groups.push_back( { element, li, 0 } );
+                if ( group.element == groups.back().element )
+                {
+                    groups.back().end = group.end;
+                    continue;
+                }
+                groups.back().end = group.begin;
+                groups.push_back( group );
             }
+            partGroups = {};
         }
         groups.back().end = lineCount;
         return groups;
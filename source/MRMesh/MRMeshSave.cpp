@@ -9,6 +9,15 @@
 #include "MRPch/MRFmt.h"
 #include "MRMeshTexture.h"
 #include "MRImageSave.h"
+#include "MRMeshLoad.h"
+#include "MRMeshCompress.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
+#include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
+#include <chrono>
+#include <sstream>
+#include <iterator>
 
 namespace MR
 {
@@ -16,6 +25,54 @@ namespace MR
 namespace MeshSave
 {
 
+namespace
+{
+
+// the number of vertices or faces encoded by one task
+constexpr size_t ChunkSize = 16384;
+
+// encodes items [0, numItems) by chunks in parallel and writes them in out stream in order
+template<typename F>
+bool writeItems( std::ostream & out, size_t numItems, F && encodeItem, ProgressCallback callback )
+{
+    const size_t numChunks = ( numItems + ChunkSize - 1 ) / ChunkSize;
+    return writeByChunks( out, numChunks, [&]( size_t chunk, std::string & buf )
+    {
+        const size_t end = std::min( numItems, ( chunk + 1 ) * ChunkSize );
+        for ( size_t i = chunk * ChunkSize; i < end; ++i )
+            encodeItem( i, buf );
+    }, std::move( callback ) );
+}
+
+#if FMT_VERSION >= 80000
+#define MR_SAVE_FMT( s ) FMT_COMPILE( s )
+#else
+#define MR_SAVE_FMT( s ) s
+#endif
+
+// formats given values in a small buffer on stack and appends it to buf;
+// together with compiled format string it is about twice faster than fmt::format and writing in std::ostream;
+// the buffer is large enough for the longest line of the savers: 6 numbers in double precision,
+// and longer lines are formatted directly in buf
+template<typename S, typename... Args>
+void appendText( std::string & buf, const S & format, const Args &... args )
+{
+    char tmp[256];
+    const auto res = fmt::format_to_n( tmp, sizeof( tmp ), format, args... );
+    if ( res.size <= sizeof( tmp ) )
+        buf.append( tmp, res.out );
+    else
+        fmt::format_to( std::back_inserter( buf ), format, args... );
+}
+
+template<typename T>
+void appendBinary( std::string & buf, const T & t )
+{
+    buf.append( ( const char* )&t, sizeof( T ) );
+}
+
+} // anonymous namespace
+
 Expected<void> toMrmesh( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
 {
     std::ofstream out( file, std::ofstream::binary );
@@ -46,6 +103,24 @@ Expected<void> toMrmesh( const Mesh & mesh, std::ostream & out, const SaveSettin
     return {};
 }
 
+Expected<void> toCompressedMrmesh( const Mesh & mesh, const std::filesystem::path & file, float precision, const SaveSettings & settings )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    return toCompressedMrmesh( mesh, out, precision, settings );
+}
+
+Expected<void> toCompressedMrmesh( const Mesh & mesh, std::ostream & out, float precision, const SaveSettings & settings )
+{
+    MeshCompressSettings compressSettings;
+    compressSettings.precision = precision;
+    compressSettings.xf = settings.xf;
+    compressSettings.progress = settings.progress;
+    return compressMesh( mesh, out, compressSettings );
+}
+
 Expected<void> toOff( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
 {
     // although .off is a textual format, we open the file in binary mode to get exactly the same result on Windows and Linux
@@ -66,39 +141,36 @@ Expected<void> toOff( const Mesh& mesh, std::ostream& out, const SaveSettings &
     const int numPolygons = mesh.topology.numValidFaces();
 
     out << "OFF\n" << numPoints << ' ' << numPolygons << " 0\n\n";
-    int numSaved = 0;
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    const bool vertsOk = writeItems( out, size_t( lastVertId + 1 ), [&]( size_t i, std::string & buf )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
+        const VertId v( i );
+        if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+            return;
         auto saveVertex = [&]( auto && p )
         {
-            out << fmt::format( "{} {} {}\n", p.x, p.y, p.z );
+            appendText( buf, MR_SAVE_FMT( "{} {} {}\n" ), p.x, p.y, p.z );
         };
         if ( settings.xf )
-            saveVertex( applyDouble( settings.xf, mesh.points[i] ) );
+            saveVertex( applyDouble( settings.xf, mesh.points[v] ) );
         else
-            saveVertex( mesh.points[i] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / numPoints * 0.5f ) )
-            return unexpected( std::string( "Saving canceled" ) );
-    }
+            saveVertex( mesh.points[v] );
+    }, subprogress( settings.progress, 0.0f, 0.5f ) );
+    if ( !vertsOk )
+        return unexpected( std::string( "Saving canceled" ) );
     out << '\n';
 
-    const float facesNum = float( mesh.topology.edgePerFace().size() );
-    size_t faceIndex = 0;
-    for ( const auto& e : mesh.topology.edgePerFace() )
+    const auto & edgePerFace = mesh.topology.edgePerFace();
+    const bool facesOk = writeItems( out, edgePerFace.size(), [&]( size_t i, std::string & buf )
     {
-        ++faceIndex;
-        if ( settings.progress && !( faceIndex & 0x3FF ) && !settings.progress( float( faceIndex ) / facesNum * 0.5f + 0.5f ) )
-            return unexpected( std::string( "Saving canceled" ) );
+        const auto e = edgePerFace[FaceId( i )];
         if ( !e.valid() )
-            continue;
-
+            return;
         VertId a, b, c;
         mesh.topology.getLeftTriVerts( e, a, b, c );
-        out << fmt::format( "3 {} {} {}\n", vertRenumber( a ), vertRenumber( b ), vertRenumber( c ) );
-    }
+        appendText( buf, MR_SAVE_FMT( "3 {} {} {}\n" ), vertRenumber( a ), vertRenumber( b ), vertRenumber( c ) );
+    }, subprogress( settings.progress, 0.5f, 1.0f ) );
+    if ( !facesOk )
+        return unexpected( std::string( "Saving canceled" ) );
 
     if ( !out )
         return unexpected( std::string( "Error saving in OFF-format" ) );
@@ -144,77 +216,69 @@ Expected<void> toObj( const Mesh & mesh, std::ostream & out, const SaveSettings
         out << fmt::format( "mtllib {}.mtl\n", settings.materialName );
 
     const VertRenumber vertRenumber( mesh.topology.getValidVerts(), settings.saveValidOnly );
-    const int numPoints = vertRenumber.sizeVerts();
     const VertId lastVertId = mesh.topology.lastValidVert();
+    const size_t numVerts = size_t( lastVertId + 1 );
 
-    int numSaved = 0;
-    auto sb = subprogress( settings.progress, 0.0f, settings.uvMap ? 0.35f : 0.5f );
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    const bool vertsOk = writeItems( out, numVerts, [&]( size_t i, std::string & buf )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
-
+        const VertId v( i );
+        if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+            return;
         auto saveVertex = [&]( auto && p )
         {
             if ( settings.colors )
             {
-                const auto c = (Vector4f)( *settings.colors )[i];
-                out << fmt::format( "v {} {} {} {} {} {}\n", p.x, p.y, p.z, c[0], c[1], c[2] );
+                const auto c = (Vector4f)( *settings.colors )[v];
+                appendText( buf, MR_SAVE_FMT( "v {} {} {} {} {} {}\n" ), p.x, p.y, p.z, c[0], c[1], c[2] );
             }
             else
             {
-                out << fmt::format( "v {} {} {}\n", p.x, p.y, p.z );
+                appendText( buf, MR_SAVE_FMT( "v {} {} {}\n" ), p.x, p.y, p.z );
             }
         };
         if ( settings.xf )
-            saveVertex( applyDouble( settings.xf, mesh.points[i] ) );
+            saveVertex( applyDouble( settings.xf, mesh.points[v] ) );
         else
-            saveVertex( mesh.points[i] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !sb( float( numSaved ) / numPoints ) )
-            return unexpected( std::string( "Saving canceled" ) );
-    }
+            saveVertex( mesh.points[v] );
+    }, subprogress( settings.progress, 0.0f, settings.uvMap ? 0.35f : 0.5f ) );
+    if ( !vertsOk )
+        return unexpected( std::string( "Saving canceled" ) );
 
     if ( settings.uvMap )
     {
-        numSaved = 0;
-        sb = subprogress( settings.progress, 0.35f, 0.7f );
-        for ( VertId i{ 0 }; i <= lastVertId; ++i )
+        const bool uvOk = writeItems( out, numVerts, [&]( size_t i, std::string & buf )
         {
-            if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-                continue;
-            const auto& uv = ( *settings.uvMap )[i];
-            out << fmt::format( "vt {} {}\n", uv.x, uv.y );
-            ++numSaved;
-            if ( settings.progress && !( numSaved & 0x3FF ) && !sb( float( numSaved ) / numPoints ) )
-                return unexpected( std::string( "Saving canceled" ) );
-        }
+            const VertId v( i );
+            if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+                return;
+            const auto& uv = ( *settings.uvMap )[v];
+            appendText( buf, MR_SAVE_FMT( "vt {} {}\n" ), uv.x, uv.y );
+        }, subprogress( settings.progress, 0.35f, 0.7f ) );
+        if ( !uvOk )
+            return unexpected( std::string( "Saving canceled" ) );
         out << "usemtl Texture\n";
     }
 
-    sb = subprogress( settings.progress, settings.uvMap ? 0.7f : 0.5f, 1.0f );
-    const float facesNum = float( mesh.topology.edgePerFace().size() );
-    size_t faceIndex = 0;
-    for ( const auto& e : mesh.topology.edgePerFace() )
+    const auto & edgePerFace = mesh.topology.edgePerFace();
+    const bool facesOk = writeItems( out, edgePerFace.size(), [&]( size_t i, std::string & buf )
     {
-        ++faceIndex;
-        if ( settings.progress && !( faceIndex & 0x3FF ) && !sb( faceIndex / facesNum ) )
-            return unexpected( std::string( "Saving canceled" ) );
+        const auto e = edgePerFace[FaceId( i )];
         if ( !e.valid() )
-            continue;
-
+            return;
         VertId a, b, c;
         mesh.topology.getLeftTriVerts( e, a, b, c );
         Vector3i values( vertRenumber( a ) + firstVertId, vertRenumber( b ) + firstVertId, vertRenumber( c ) + firstVertId );
         if ( settings.uvMap )
-            out << fmt::format( "f {}/{} {}/{} {}/{}\n",
+            appendText( buf, MR_SAVE_FMT( "f {}/{} {}/{} {}/{}\n" ),
                 values.x, values.x,
                 values.y, values.y,
                 values.z, values.z );
         else
-            out << fmt::format( "f {} {} {}\n",
+            appendText( buf, MR_SAVE_FMT( "f {} {} {}\n" ),
                 values.x, values.y, values.z );
-    }
+    }, subprogress( settings.progress, settings.uvMap ? 0.7f : 0.5f, 1.0f ) );
+    if ( !facesOk )
+        return unexpected( std::string( "Saving canceled" ) );
 
     if ( !out )
         return unexpected( std::string( "Error saving in OBJ-format" ) );
@@ -272,10 +336,20 @@ Expected<void> toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSet
     auto numTris = (std::uint32_t)notDegenTris.count();
     out.write( ( const char* )&numTris, 4 );
 
-    const float trisNum = float( notDegenTris.count() );
-    int trisIndex = 0;
-    for ( auto f : notDegenTris )
+#pragma pack(push, 1)
+    struct StlTriangle
+    {
+        Vector3f normal, a, b, c;
+        std::uint16_t attr = 0;
+    };
+#pragma pack(pop)
+    static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
+
+    const bool ok = writeItems( out, notDegenTris.size(), [&]( size_t i, std::string & buf )
     {
+        const FaceId f( i );
+        if ( !notDegenTris.test( f ) )
+            return;
         VertId a, b, c;
         mesh.topology.getTriVerts( f, a, b, c );
         assert( a.valid() && b.valid() && c.valid() );
@@ -284,21 +358,15 @@ Expected<void> toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSet
         const Vector3d ad = applyDouble( settings.xf, mesh.points[a] );
         const Vector3d bd = applyDouble( settings.xf, mesh.points[b] );
         const Vector3d cd = applyDouble( settings.xf, mesh.points[c] );
-        const Vector3f normal( cross( bd - ad, cd - ad ).normalized() );
-        const Vector3f ap( ad );
-        const Vector3f bp( bd );
-        const Vector3f cp( cd );
-
-        out.write( (const char*)&normal, 12 );
-        out.write( (const char*)&ap, 12 );
-        out.write( (const char*)&bp, 12 );
-        out.write( (const char*)&cp, 12 );
-        std::uint16_t attr{ 0 };
-        out.write( ( const char* )&attr, 2 );
-        if ( settings.progress && !( trisIndex & 0x3FF ) && !settings.progress( trisIndex / trisNum ) )
-            return unexpected( std::string( "Saving canceled" ) );
-        ++trisIndex;
-    }
+        StlTriangle tri;
+        tri.normal = Vector3f( cross( bd - ad, cd - ad ).normalized() );
+        tri.a = Vector3f( ad );
+        tri.b = Vector3f( bd );
+        tri.c = Vector3f( cd );
+        appendBinary( buf, tri );
+    }, settings.progress );
+    if ( !ok )
+        return unexpected( std::string( "Saving canceled" ) );
 
     if ( !out )
         return unexpected( std::string( "Error saving in binary STL-format" ) );
@@ -322,21 +390,22 @@ Expected<void> toAsciiStl( const Mesh& mesh, std::ostream& out, const SaveSettin
 
     static const char* solid_name = "MeshInspector.com";
     out << "solid " << solid_name << "\n";
-    auto notDegenTris = getNotDegenTris( mesh );
-    const float trisNum = float( notDegenTris.count() );
-    int trisIndex = 0;
-    for ( auto f : notDegenTris )
+    const auto notDegenTris = getNotDegenTris( mesh );
+    const bool ok = writeItems( out, notDegenTris.size(), [&]( size_t i, std::string & buf )
     {
+        const FaceId f( i );
+        if ( !notDegenTris.test( f ) )
+            return;
         VertId a, b, c;
         mesh.topology.getTriVerts( f, a, b, c );
         assert( a.valid() && b.valid() && c.valid() );
         auto saveVertex = [&]( auto && ap, auto && bp, auto && cp )
         {
             const auto normal = cross( bp - ap, cp - ap ).normalized();
-            out << "" << fmt::format( "facet normal {} {} {}\n", normal.x, normal.y, normal.z );
-            out << "outer loop\n";
+            appendText( buf, MR_SAVE_FMT( "facet normal {} {} {}\n" ), normal.x, normal.y, normal.z );
+            buf += "outer loop\n";
             for ( const auto & p : { ap, bp, cp } )
-                out << fmt::format( "vertex {} {} {}\n", p.x, p.y, p.z );
+                appendText( buf, MR_SAVE_FMT( "vertex {} {} {}\n" ), p.x, p.y, p.z );
         };
         if ( settings.xf )
             saveVertex( applyDouble( settings.xf, mesh.points[a] ),
@@ -344,12 +413,11 @@ Expected<void> toAsciiStl( const Mesh& mesh, std::ostream& out, const SaveSettin
                         applyDouble( settings.xf, mesh.points[c] ) );
         else
             saveVertex( mesh.points[a], mesh.points[b], mesh.points[c] );
-        out << "endloop\n";
-        out << "endfacet\n";
-        if ( settings.progress && !( trisIndex & 0x3FF ) && !settings.progress( trisIndex / trisNum ) )
-            return unexpected( std::string( "Saving canceled" ) );
-        ++trisIndex;
-    }
+        buf += "endloop\n";
+        buf += "endfacet\n";
+    }, settings.progress );
+    if ( !ok )
+        return unexpected( std::string( "Saving canceled" ) );
     out << "endsolid " << solid_name << "\n";
 
     if ( !out )
@@ -394,23 +462,20 @@ Expected<void> toPly( const Mesh & mesh, std::ostream & out, const SaveSettings
     static_assert( sizeof( PlyColor ) == 3, "check your padding" );
 
     // write vertices
-    int numSaved = 0;
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    const bool vertsOk = writeItems( out, size_t( lastVertId + 1 ), [&]( size_t i, std::string & buf )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
-        const Vector3f p = applyFloat( settings.xf, mesh.points[i] );
-        out.write( ( const char* )&p, 12 );
-        if ( settings.colors )
+        const VertId v( i );
+        if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+            return;
+        appendBinary( buf, applyFloat( settings.xf, mesh.points[v] ) );
+        if ( saveColors )
         {
-            const auto c = ( *settings.colors )[i];
-            PlyColor pc{ .r = c.r, .g = c.g, .b = c.b };
-            out.write( ( const char* )&pc, 3 );
+            const auto c = ( *settings.colors )[v];
+            appendBinary( buf, PlyColor{ .r = c.r, .g = c.g, .b = c.b } );
         }
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / numPoints * 0.5f ) )
-            return unexpectedOperationCanceled();
-    }
+    }, subprogress( settings.progress, 0.0f, 0.5f ) );
+    if ( !vertsOk )
+        return unexpectedOperationCanceled();
 
     // write triangles
     #pragma pack(push, 1)
@@ -422,20 +487,21 @@ Expected<void> toPly( const Mesh & mesh, std::ostream & out, const SaveSettings
     #pragma pack(pop)
     static_assert( sizeof( PlyTriangle ) == 13, "check your padding" );
 
-    PlyTriangle tri;
-    const float facesNum = float( mesh.topology.getValidFaces().count() );
-    int faceIndex = 0;
-    for ( auto f : mesh.topology.getValidFaces() )
+    const auto & validFaces = mesh.topology.getValidFaces();
+    const bool facesOk = writeItems( out, validFaces.size(), [&]( size_t i, std::string & buf )
     {
+        const FaceId f( i );
+        if ( !validFaces.test( f ) )
+            return;
         VertId vs[3];
         mesh.topology.getTriVerts( f, vs );
-        for ( int i = 0; i < 3; ++i )
-            tri.v[i] = vertRenumber( vs[i] );
-        out.write( (const char *)&tri, 13 );
-        if ( settings.progress && !( faceIndex & 0x3FF ) && !settings.progress( float( faceIndex ) / facesNum * 0.5f + 0.5f ) )
-            return unexpected( std::string( "Saving canceled" ) );
-        ++faceIndex;
-    }
+        PlyTriangle tri;
+        for ( int j = 0; j < 3; ++j )
+            tri.v[j] = vertRenumber( vs[j] );
+        appendBinary( buf, tri );
+    }, subprogress( settings.progress, 0.5f, 1.0f ) );
+    if ( !facesOk )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in PLY-format" ) );
@@ -471,6 +537,51 @@ Expected<void> toAnySupportedFormat( const Mesh& mesh, const std::string& extens
     return saver.streamSave( mesh, out, settings );
 }
 
+TEST( MRMesh, SaveByChunks )
+{
+    // the mesh is large enough to be split in several chunks, and has deleted faces to be skipped
+    auto mesh = makeTorus( 1.0f, 0.3f, 256, 128 );
+    FaceBitSet del( mesh.topology.faceSize() );
+    for ( FaceId f( 0 ); f < del.size(); f += 7 )
+        del.set( f );
+    mesh.topology.deleteFaces( del );
+    const auto numFaces = mesh.topology.numValidFaces();
+
+    for ( auto ext : { "*.stl", "*.off", "*.obj", "*.ply" } )
+    {
+        std::stringstream ss;
+        ASSERT_TRUE( toAnySupportedFormat( mesh, ext, ss ).has_value() ) << ext;
+        auto loaded = MeshLoad::fromAnySupportedFormat( ss, ext );
+        ASSERT_TRUE( loaded.has_value() ) << ext;
+        EXPECT_EQ( loaded->topology.numValidFaces(), numFaces ) << ext;
+        EXPECT_EQ( loaded->topology.numValidVerts(), mesh.topology.numValidVerts() ) << ext;
+    }
+
+    std::stringstream ss;
+    SaveSettings settings;
+    settings.progress = []( float p ) { return p < 0.5f; };
+    EXPECT_FALSE( toPly( mesh, ss, settings ).has_value() );
+}
+
+// measures the time of saving a torus with 2M triangles in a memory stream in each text and binary format;
+// run with --gtest_also_run_disabled_tests
+TEST( MRMesh, DISABLED_SaveThroughputBenchmark )
+{
+    const auto mesh = makeTorus( 1.0f, 0.3f, 1024, 1024 );
+    // single thread to measure the encoding itself, not the scaling
+    tbb::task_arena arena( 1 );
+    for ( auto ext : { "*.stl", "*.ply", "*.off", "*.obj" } )
+    {
+        std::stringstream ss;
+        Expected<void> res;
+        const auto start = std::chrono::steady_clock::now();
+        arena.execute( [&] { res = toAnySupportedFormat( mesh, ext, ss ); } );
+        const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        ASSERT_TRUE( res.has_value() ) << ext;
+        spdlog::info( "Saving {} triangles in {}: {:.1f} ms, {} bytes", mesh.topology.numValidFaces(), ext, time.count(), size_t( ss.tellp() ) );
+    }
+}
+
 MR_ADD_MESH_SAVER_WITH_PRIORITY( IOFilter( "MrMesh (.mrmesh)", "*.mrmesh" ), toMrmesh, -1 )
 MR_ADD_MESH_SAVER( IOFilter( "Binary STL (.stl)", "*.stl"   ), toBinaryStl )
 MR_ADD_MESH_SAVER( IOFilter( "OFF (.off)",        "*.off"   ), toOff )
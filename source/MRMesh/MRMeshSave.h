@@ -24,6 +24,13 @@ MRMESH_API Expected<void> toMrmesh( const Mesh & mesh, const std::filesystem::pa
 MRMESH_API Expected<void> toMrmesh( const Mesh & mesh, std::ostream & out,
                                                      const SaveSettings & settings = {} );
 
+/// saves in compressed internal file format with given maximal deviation of coordinates, see compressMesh( );
+/// the vertices and faces are renumbered, SaveSettings::saveValidOnly = false is ignored
+MRMESH_API Expected<void> toCompressedMrmesh( const Mesh & mesh, const std::filesystem::path & file, float precision,
+                                                     const SaveSettings & settings = {} );
+MRMESH_API Expected<void> toCompressedMrmesh( const Mesh & mesh, std::ostream & out, float precision,
+                                                     const SaveSettings & settings = {} );
+
 /// saves in .off file
 MRMESH_API Expected<void> toOff( const Mesh & mesh, const std::filesystem::path & file,
                                                   const SaveSettings & settings = {} );
@@ -1,11 +1,14 @@
 #include "MRMeshThickness.h"
 #include "MRMesh.h"
 #include "MRMeshIntersect.h"
+#include "MRAABBTree.h"
 #include "MRLine3.h"
 #include "MRRingIterator.h"
-#include "MRBitSetParallelFor.h"
+#include "MRParallelFor.h"
 #include "MRClosestPointInTriangle.h"
 #include "MRTimer.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include <cfloat>
 
 namespace MR
@@ -55,11 +58,52 @@ MeshIntersectionResult rayInsideIntersect( const Mesh& mesh, VertId v, float ray
     return rayInsideIntersect( mesh, m, rayEnd );
 }
 
+namespace
+{
+
+// returns valid vertices of the mesh in the order of AABB tree leaves, so consecutive vertices are spatially close,
+// and the queries from them visit mostly the same tree nodes and triangles, which are already in CPU cache
+std::vector<VertId> getVerticesInTreeOrder( const Mesh& mesh )
+{
+    MR_TIMER
+    std::vector<VertId> res;
+    res.reserve( mesh.topology.numValidVerts() );
+    VertBitSet added( mesh.topology.vertSize() );
+    for ( const auto & node : mesh.getAABBTree().nodes() )
+    {
+        if ( !node.leaf() )
+            continue;
+        VertId vs[3];
+        mesh.topology.getTriVerts( node.leafId(), vs );
+        for ( auto v : vs )
+            if ( !added.test_set( v ) )
+                res.push_back( v );
+    }
+    // vertices without incident triangles
+    for ( auto v : mesh.topology.getValidVerts() )
+        if ( !added.test( v ) )
+            res.push_back( v );
+    return res;
+}
+
+// calls f( v ) for all valid vertices of the mesh in parallel, each thread gets a block of spatially close vertices
+template <typename F>
+bool parallelForVerticesInTreeOrder( const Mesh& mesh, F && f, const ProgressCallback & progress )
+{
+    const auto order = getVerticesInTreeOrder( mesh );
+    return ParallelFor( order, [&]( size_t i )
+    {
+        f( order[i] );
+    }, progress );
+}
+
+} // anonymous namespace
+
 std::optional<VertScalars> computeRayThicknessAtVertices( const Mesh& mesh, const ProgressCallback & progress )
 {
     MR_TIMER
     VertScalars res( mesh.points.size(), FLT_MAX );
-    if ( !BitSetParallelFor( mesh.topology.getValidVerts(), [&]( VertId v )
+    if ( !parallelForVerticesInTreeOrder( mesh, [&]( VertId v )
     {
         if ( auto isec = rayInsideIntersect( mesh, v ) )
             res[v] = isec.distanceAlongLine;
@@ -232,7 +276,7 @@ std::optional<VertScalars> computeInSphereThicknessAtVertices( const Mesh& mesh,
 {
     MR_TIMER
     VertScalars res( mesh.points.size(), FLT_MAX );
-    if ( !BitSetParallelFor( mesh.topology.getValidVerts(), [&]( VertId v )
+    if ( !parallelForVerticesInTreeOrder( mesh, [&]( VertId v )
     {
         auto sph = findInSphere( mesh, v, settings );
         res[v] = 2 * sph.radius;
@@ -241,4 +285,36 @@ std::optional<VertScalars> computeInSphereThicknessAtVertices( const Mesh& mesh,
     return res;
 }
 
+TEST( MRMesh, MeshThickness )
+{
+    const auto mesh = makeTorus( 1.0f, 0.2f, 64, 32 );
+
+    // batched computations return exactly the same values as independent computations for each vertex
+    const auto rayThickness = computeRayThicknessAtVertices( mesh );
+    ASSERT_TRUE( rayThickness.has_value() );
+    for ( auto v : mesh.topology.getValidVerts() )
+    {
+        const auto isec = rayInsideIntersect( mesh, v );
+        ASSERT_TRUE( isec );
+        EXPECT_EQ( ( *rayThickness )[v], isec.distanceAlongLine );
+        EXPECT_NEAR( ( *rayThickness )[v], 0.4f, 0.01f );
+    }
+
+    InSphereSearchSettings settings;
+    settings.maxRadius = 1.0f;
+    for ( bool insideAndOutside : { false, true } )
+    {
+        settings.insideAndOutside = insideAndOutside;
+        const auto inSphereThickness = computeInSphereThicknessAtVertices( mesh, settings );
+        ASSERT_TRUE( inSphereThickness.has_value() );
+        for ( auto v : mesh.topology.getValidVerts() )
+        {
+            EXPECT_EQ( ( *inSphereThickness )[v], 2 * findInSphere( mesh, v, settings ).radius );
+            // the sphere is a bit smaller than the tube because of the flat triangles
+            EXPECT_GT( ( *inSphereThickness )[v], 0.3f );
+            EXPECT_LT( ( *inSphereThickness )[v], 0.41f );
+        }
+    }
+}
+
 } // namespace MR
@@ -6,10 +6,63 @@
 #include "MRTimer.h"
 #include "MRMatrix3.h"
 #include "MRContour.h"
+#include "MRParallelFor.h"
+#include "MRGTest.h"
 
 namespace MR
 {
 
+namespace
+{
+
+// the number of consecutive body copies connected in one part of the result, which are built in parallel
+constexpr int cCopiesInPart = 4096;
+
+// connects by triangles two copies of body contours, given by their first edges
+void connectBlocks( MeshTopology& tp, EdgeId newFirstEdge, EdgeId prevFirstEdge, int numEdges )
+{
+    assert( numEdges != 0 );
+    EdgeId firstNewEdgeInLoop;
+    for ( int i = 0; i < numEdges; ++i )
+    {
+        // first edge
+        auto newEdge = tp.makeEdge();
+        tp.splice( tp.prev( prevFirstEdge + i * 2 ), newEdge );
+        tp.splice( newFirstEdge + i * 2, newEdge.sym() );
+
+        if ( !firstNewEdgeInLoop )
+            firstNewEdgeInLoop = newEdge;
+        else
+            tp.setLeft( newEdge.sym(), tp.addFaceId() );
+
+        // diagonal edge
+        newEdge = tp.makeEdge();
+        tp.splice( tp.prev( prevFirstEdge + i * 2 ), newEdge );
+        tp.splice( tp.prev( ( newFirstEdge + i * 2 ).sym() ), newEdge.sym() );
+        tp.setLeft( newEdge.sym(), tp.addFaceId() );
+
+        auto diagEdgePrev = tp.prev( newEdge.sym() );
+        
+        if ( diagEdgePrev == ( newFirstEdge + ( i + 1 ) * 2 ) )
+            continue;
+        if ( diagEdgePrev == firstNewEdgeInLoop.sym() )
+        {
+            tp.setLeft( firstNewEdgeInLoop.sym(), tp.addFaceId() );
+            firstNewEdgeInLoop = {};
+            continue;
+        }
+        // same as first if path is not finished
+        // last in non closed path
+        firstNewEdgeInLoop = {};
+        newEdge = tp.makeEdge();
+        tp.splice( ( prevFirstEdge + i * 2 ).sym(), newEdge );
+        tp.splice( diagEdgePrev, newEdge.sym() );
+        tp.setLeft( newEdge.sym(), tp.addFaceId() );
+    }
+}
+
+} // anonymous namespace
+
 Mesh makeMovementBuildBody( const Contours3f& bodyContours, const Contours3f& trajectoryContoursOrg,
     const MovementBuildBodyParams& params )
 {
@@ -70,55 +123,35 @@ Mesh makeMovementBuildBody( const Contours3f& bodyContours, const Contours3f& tr
         return Matrix3f::rotation( cross( from, from.furthestBasisVector() ), halfAng );
     };
 
-    Mesh res;
-    int numEdges = 0;
-    auto connectBlocks = [&] ( EdgeId newFirstEdge, EdgeId prevFirstEdge )
+    int numEdges = 0, numVerts = 0, numOpenContours = 0;
+    for ( const auto& bc : bodyContours )
     {
-        assert( numEdges != 0 );
-        auto& tp = res.topology;
-        EdgeId firstNewEdgeInLoop;
-        for ( int i = 0; i < numEdges; ++i )
-        {
-            // first edge
-            auto newEdge = tp.makeEdge();
-            tp.splice( tp.prev( prevFirstEdge + i * 2 ), newEdge );
-            tp.splice( newFirstEdge + i * 2, newEdge.sym() );
-
-            if ( !firstNewEdgeInLoop )
-                firstNewEdgeInLoop = newEdge;
-            else
-                tp.setLeft( newEdge.sym(), tp.addFaceId() );
-
-            // diagonal edge
-            newEdge = tp.makeEdge();
-            tp.splice( tp.prev( prevFirstEdge + i * 2 ), newEdge );
-            tp.splice( tp.prev( ( newFirstEdge + i * 2 ).sym() ), newEdge.sym() );
-            tp.setLeft( newEdge.sym(), tp.addFaceId() );
+        if ( bc.empty() )
+            continue;
+        const bool closed = bc.size() > 2 && bc.front() == bc.back();
+        numEdges += int( bc.size() ) - 1;
+        numVerts += int( closed ? bc.size() - 1 : bc.size() );
+        if ( !closed )
+            ++numOpenContours;
+    }
 
-            auto diagEdgePrev = tp.prev( newEdge.sym() );
-            
-            if ( diagEdgePrev == ( newFirstEdge + ( i + 1 ) * 2 ) )
-                continue;
-            if ( diagEdgePrev == firstNewEdgeInLoop.sym() )
-            {
-                tp.setLeft( firstNewEdgeInLoop.sym(), tp.addFaceId() );
-                firstNewEdgeInLoop = {};
-                continue;
-            }
-            // same as first if path is not finished
-            // last in non closed path
-            firstNewEdgeInLoop = {};
-            newEdge = tp.makeEdge();
-            tp.splice( ( prevFirstEdge + i * 2 ).sym(), newEdge );
-            tp.splice( diagEdgePrev, newEdge.sym() );
-            tp.setLeft( newEdge.sym(), tp.addFaceId() );
-        }
+    // transformations of body copies are accumulated by sequential walk along trajectories,
+    // then the copies are connected in parts in parallel
+    std::vector<AffineXf3f> xfs;
+    struct Part
+    {
+        int firstCopy = 0;
+        int endCopy = 0;
+        bool connectToPrev = false; // the first copy of this part will be connected with the last copy of previous part
+        int closeWithPart = -1; // the last copy of this part will be connected with the first copy of given part
+        EdgeId firstBodyEdge;
+        EdgeId lastBodyEdge;
     };
+    std::vector<Part> parts;
     for ( const auto& trajectoryCont : trajectoryContours )
     {
         bool closed = trajectoryCont.size() > 2 && trajectoryCont.front() == trajectoryCont.back();
-        EdgeId firstBodyEdge;
-        EdgeId prevBodyEdge;
+        const int firstCopy = int( xfs.size() );
         bool initRotationDone = false;
         prevHalfRot = accumRot = Matrix3f();
         for ( int i = 0; i + ( closed ? 1 : 0 ) < trajectoryCont.size(); ++i )
@@ -177,23 +210,103 @@ Mesh makeMovementBuildBody( const Contours3f& bodyContours, const Contours3f& tr
                 xf = xf * ( *params.b2tXf );
 
 
-            auto curBodyEdge = res.addSeparateContours( bodyContours, &xf );
-            if ( !firstBodyEdge )
-                firstBodyEdge = curBodyEdge;
+            xfs.push_back( xf );
+        }
+        const int firstPart = int( parts.size() );
+        for ( int c = firstCopy; c < xfs.size(); c += cCopiesInPart )
+            parts.push_back( { .firstCopy = c, .endCopy = std::min( c + cCopiesInPart, int( xfs.size() ) ), .connectToPrev = c > firstCopy } );
+        if ( closed && parts.size() > firstPart )
+            parts.back().closeWithPart = firstPart;
+    }
 
+    std::vector<Mesh> partMeshes( parts.size() );
+    ParallelFor( partMeshes, [&] ( size_t i )
+    {
+        auto& part = parts[i];
+        auto& mesh = partMeshes[i];
+        const size_t numCopies = part.endCopy - part.firstCopy;
+        mesh.topology.edgeReserve( numCopies * ( 6 * numEdges + 2 * numOpenContours ) );
+        mesh.topology.vertReserve( numCopies * numVerts );
+        mesh.topology.faceReserve( numCopies * 2 * numEdges );
+        mesh.points.reserve( numCopies * numVerts );
+        EdgeId prevBodyEdge;
+        for ( int c = part.firstCopy; c < part.endCopy; ++c )
+        {
+            auto curBodyEdge = mesh.addSeparateContours( bodyContours, &xfs[c] );
             if ( prevBodyEdge )
-            {
-                if ( numEdges == 0 )
-                    numEdges = ( curBodyEdge - prevBodyEdge ) / 2;
-                connectBlocks( curBodyEdge, prevBodyEdge );
-            }
+                connectBlocks( mesh.topology, curBodyEdge, prevBodyEdge, numEdges );
+            else
+                part.firstBodyEdge = curBodyEdge;
             prevBodyEdge = curBodyEdge;
         }
-        if ( closed )
-            connectBlocks( firstBodyEdge, prevBodyEdge );
+        part.lastBodyEdge = prevBodyEdge;
+    } );
+
+    // offsets of parts' elements in the result
+    std::vector<int> firstPartEdge( parts.size() + 1 ), firstPartVert( parts.size() + 1 ), firstPartFace( parts.size() + 1 );
+    for ( int i = 0; i < parts.size(); ++i )
+    {
+        const auto& tp = partMeshes[i].topology;
+        firstPartEdge[i + 1] = firstPartEdge[i] + int( tp.edgeSize() );
+        firstPartVert[i + 1] = firstPartVert[i] + int( tp.vertSize() );
+        firstPartFace[i + 1] = firstPartFace[i] + int( tp.faceSize() );
+    }
+
+    Mesh res;
+    res.topology.edgeReserve( firstPartEdge.back() + 6 * size_t( numEdges ) * parts.size() ); // enough for connecting neighbor parts
+    res.topology.resizeBeforeParallelAdd( firstPartEdge.back(), firstPartVert.back(), firstPartFace.back() );
+    res.points.resizeNoInit( firstPartVert.back() );
+    ParallelFor( partMeshes, [&] ( size_t i )
+    {
+        auto& mesh = partMeshes[i];
+        VertMap vmap( mesh.topology.vertSize() );
+        for ( VertId v( 0 ); v < vmap.size(); ++v )
+        {
+            vmap[v] = VertId( firstPartVert[i] + v );
+            res.points[vmap[v]] = mesh.points[v];
+        }
+        FaceMap fmap( mesh.topology.faceSize() );
+        for ( FaceId f( 0 ); f < fmap.size(); ++f )
+            fmap[f] = FaceId( firstPartFace[i] + f );
+        res.topology.addPackedPart( mesh.topology, EdgeId( firstPartEdge[i] ), fmap, vmap );
+        mesh = {};
+    } );
+    res.topology.computeValidsFromEdges();
+
+    for ( int i = 0; i < parts.size(); ++i )
+    {
+        const auto& part = parts[i];
+        if ( part.connectToPrev )
+            connectBlocks( res.topology, part.firstBodyEdge + firstPartEdge[i], parts[i - 1].lastBodyEdge + firstPartEdge[i - 1], numEdges );
+        if ( part.closeWithPart >= 0 )
+            connectBlocks( res.topology, parts[part.closeWithPart].firstBodyEdge + firstPartEdge[part.closeWithPart],
+                part.lastBodyEdge + firstPartEdge[i], numEdges );
     }
 
     return res;
 }
 
-}
\ No newline at end of file
+TEST( MRMesh, MovementBuildBody )
+{
+    // circle body moved along closed circular trajectory, which is long enough to be built in several parts
+    const int numBodyPoints = 8;
+    const int numTrajectoryPoints = 3 * cCopiesInPart + 10;
+    Contours3f body( 1 ), trajectory( 1 );
+    for ( int i = 0; i < numBodyPoints; ++i )
+        body[0].push_back( Vector3f( std::cos( 2 * PI_F * i / numBodyPoints ), std::sin( 2 * PI_F * i / numBodyPoints ), 0.f ) );
+    body[0].push_back( body[0].front() );
+    for ( int i = 0; i < numTrajectoryPoints; ++i )
+        trajectory[0].push_back( Vector3f( 10 * std::cos( 2 * PI_F * i / numTrajectoryPoints ), 10 * std::sin( 2 * PI_F * i / numTrajectoryPoints ), 0.f ) );
+    trajectory[0].push_back( trajectory[0].front() );
+
+    const auto mesh = makeMovementBuildBody( body, trajectory );
+    EXPECT_EQ( mesh.topology.numValidVerts(), numBodyPoints * numTrajectoryPoints );
+    EXPECT_EQ( mesh.topology.numValidFaces(), 2 * numBodyPoints * numTrajectoryPoints );
+    EXPECT_TRUE( mesh.topology.findHoleRepresentiveEdges().empty() );
+    EXPECT_TRUE( mesh.topology.checkValidity() );
+    // the volume of torus with octagonal cross-section
+    const float sectionArea = 0.5f * numBodyPoints * std::sin( 2 * PI_F / numBodyPoints );
+    EXPECT_NEAR( mesh.volume(), 2 * PI_F * 10 * sectionArea, 0.1f );
+}
+
+}
@@ -6,6 +6,7 @@
 #include "MRMeshSave.h"
 #include "MRSerializer.h"
 #include "MRMeshLoad.h"
+#include "MRLevelOfDetails.h"
 #include "MRSceneColors.h"
 #include "MRIRenderObject.h"
 #include "MRViewportId.h"
@@ -15,6 +16,12 @@
 #include "MRTimer.h"
 #include "MRParallelFor.h"
 #include "MRDirectory.h"
+#include "MRObjectMesh.h"
+#include "MRObjectSave.h"
+#include "MRObjectLoad.h"
+#include "MRUniqueTemporaryFolder.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include "MRPch/MRJson.h"
 #include "MRPch/MRAsyncLaunchType.h"
 
@@ -59,20 +66,38 @@ Expected<std::future<Expected<void>>> ObjectMeshHolder::serializeModel_( const s
     saveSettings.rearrangeTriangles = false;
     if ( !vertsColorMap_.empty() )
         saveSettings.colors = &vertsColorMap_;
-    auto save = [mesh = mesh_, saveMeshFormat = saveMeshFormat_, path, saveSettings]()
+    auto save = [mesh = mesh_, lods = lods_, saveMeshFormat = saveMeshFormat_, path, saveSettings]() -> Expected<void>
     {
-        auto filename = path;
         const auto extension = std::string( "*" ) + saveMeshFormat;
-        if ( auto meshSaver = MeshSave::getMeshSaver( extension ); meshSaver.fileSave != nullptr )
+        const auto meshSaver = MeshSave::getMeshSaver( extension );
+        auto saveOne = [&]( const Mesh & m, std::filesystem::path filename, const SaveSettings & settings )
         {
-            filename += saveMeshFormat;
-            return meshSaver.fileSave( *mesh, filename, saveSettings );
-        }
-        else
+            if ( meshSaver.fileSave != nullptr )
+            {
+                filename += saveMeshFormat;
+                return meshSaver.fileSave( m, filename, settings );
+            }
+            else
+            {
+                filename += ".mrmesh";
+                return MR::MeshSave::toAnySupportedFormat( m, filename, settings );
+            }
+        };
+        if ( auto res = saveOne( *mesh, path, saveSettings ); !res )
+            return res;
+
+        // levels of details are saved in separate files with suffixes .lod0, .lod1, ... to avoid their recomputation on loading
+        if ( lods )
         {
-            filename += ".mrmesh";
-            return MR::MeshSave::toAnySupportedFormat( *mesh, filename, saveSettings );
+            for ( int i = 0; i < lods->levels.size(); ++i )
+            {
+                auto lodPath = path;
+                lodPath += ".lod" + std::to_string( i );
+                if ( auto res = saveOne( *lods->levels[i].mesh, lodPath, {} ); !res )
+                    return res;
+            }
         }
+        return {};
     };
     return std::async( getAsyncLaunchType(), save );
 }
@@ -140,6 +165,14 @@ void ObjectMeshHolder::serializeFields_( Json::Value& root ) const
 
     root["PointSize"] = pointSize_;
 
+    if ( lods_ && mesh_ && !ancillary_ )
+    {
+        auto & errors = root["LodErrors"];
+        errors = Json::arrayValue;
+        for ( const auto & l : lods_->levels )
+            errors.append( l.error );
+    }
+
     root["Type"].append( ObjectMeshHolder::TypeName() );
 }
 
@@ -240,6 +273,21 @@ void ObjectMeshHolder::deserializeFields_( const Json::Value& root )
 
     if ( root["UseDefaultSceneProperties"].isBool() && root["UseDefaultSceneProperties"].asBool() )
         setDefaultSceneProperties_();
+
+    // levels of details were loaded in deserializeModel_, here their errors are assigned
+    if ( lods_ )
+    {
+        const auto& errorsJson = root["LodErrors"];
+        if ( errorsJson.isArray() && errorsJson.size() == lods_->levels.size() )
+        {
+            auto lods = std::make_shared<MeshLods>( *lods_ );
+            for ( int i = 0; i < lods->levels.size(); ++i )
+                lods->levels[i].error = errorsJson[i].asFloat();
+            lods_ = std::move( lods );
+        }
+        else
+            lods_.reset();
+    }
 }
 
 Expected<void> ObjectMeshHolder::deserializeModel_( const std::filesystem::path& path, ProgressCallback progressCb )
@@ -258,6 +306,22 @@ Expected<void> ObjectMeshHolder::deserializeModel_( const std::filesystem::path&
         return unexpected( res.error() );
 
     mesh_ = std::make_shared<Mesh>( std::move( res.value() ) );
+
+    // load levels of details if they were saved, their errors are read later in deserializeFields_
+    lods_.reset();
+    auto lods = std::make_shared<MeshLods>();
+    for ( int i = 0; ; ++i )
+    {
+        const auto lodPath = findPathWithExtension( pathFromUtf8( utf8string( path ) + ".lod" + std::to_string( i ) ) );
+        if ( lodPath.empty() )
+            break;
+        auto lod = MeshLoad::fromAnySupportedFormat( lodPath );
+        if ( !lod.has_value() )
+            break; // levels of details can be always recomputed
+        lods->levels.push_back( { std::make_shared<Mesh>( std::move( *lod ) ) } );
+    }
+    if ( !lods->levels.empty() )
+        lods_ = std::move( lods );
     return {};
 }
 
@@ -686,7 +750,46 @@ size_t ObjectMeshHolder::heapBytes() const
         + uvCoordinates_.heapBytes()
         + ancillaryUVCoordinates_.heapBytes()
         + facesColorMap_.heapBytes()
-        + MR::heapBytes( mesh_ );
+        + MR::heapBytes( mesh_ )
+        + ( lods_ ? sizeof( MeshLods ) + lods_->heapBytes() : 0 );
+}
+
+Expected<void> ObjectMeshHolder::createLods( const ProgressCallback & cb )
+{
+    MR_TIMER
+    if ( lods_ || !mesh_ )
+        return {};
+    auto res = makeMeshLods( *mesh_, { .progress = cb } );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
+    lods_ = std::make_shared<MeshLods>( std::move( *res ) );
+    return {};
+}
+
+void ObjectMeshHolder::setLods( std::shared_ptr<const MeshLods> lods )
+{
+    lods_ = std::move( lods );
+}
+
+std::shared_ptr<const Mesh> ObjectMeshHolder::meshByError( float maxError ) const
+{
+    if ( !mesh_ )
+        return {};
+    const auto & ls = lods_;
+    const auto i = ls ? ls->findLevelByError( maxError ) : -1;
+    return i >= 0 ? ls->levels[i].mesh : mesh();
+}
+
+std::shared_ptr<const Mesh> ObjectMeshHolder::meshByFaces( int maxFaces ) const
+{
+    if ( !mesh_ )
+        return {};
+    if ( mesh_->topology.numValidFaces() <= maxFaces )
+        return mesh();
+    const auto & ls = lods_;
+    if ( !ls || ls->levels.empty() )
+        return mesh();
+    return ls->levels[ls->findLevelByFaces( maxFaces )].mesh;
 }
 
 void ObjectMeshHolder::setSaveMeshFormat( const char * newFormat )
@@ -753,6 +856,7 @@ void ObjectMeshHolder::setDirtyFlags( uint32_t mask, bool invalidateCaches )
         selectedArea_.reset();
         volume_.reset();
         avgEdgeLen_.reset();
+        lods_.reset();
         if ( invalidateCaches && mesh_ )
             mesh_->invalidateCaches();
     }
@@ -846,4 +950,43 @@ void ObjectMeshHolder::setDefaultSceneProperties_()
     setFlatShading( SceneSettings::getDefaultShadingMode() == SceneSettings::ShadingMode::Flat );
 }
 
+TEST( MRMesh, ObjectMeshLods )
+{
+    auto objMesh = std::make_shared<ObjectMesh>();
+    objMesh->setName( "torus" );
+    objMesh->setMesh( std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, 128, 64 ) ) );
+    EXPECT_FALSE( objMesh->getLods() );
+    // without levels of details the mesh itself is returned
+    EXPECT_EQ( objMesh->meshByError( FLT_MAX ), objMesh->mesh() );
+
+    ASSERT_TRUE( objMesh->createLods().has_value() );
+    const auto lods = objMesh->getLods();
+    ASSERT_TRUE( lods );
+    ASSERT_FALSE( lods->levels.empty() );
+    EXPECT_EQ( objMesh->meshByError( FLT_MAX ), lods->levels.back().mesh );
+
+    Object root;
+    root.setName( "root" );
+    root.addChild( objMesh );
+
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( folder );
+    const auto scenePath = folder / "lods.mru";
+    ASSERT_TRUE( serializeObjectTree( root, scenePath ).has_value() );
+    const auto loaded = deserializeObjectTree( scenePath );
+    ASSERT_TRUE( loaded.has_value() );
+    const auto loadedMesh = ( *loaded )->find<ObjectMesh>( "torus" );
+    ASSERT_TRUE( loadedMesh );
+
+    // levels of details are loaded together with their errors and not recomputed
+    const auto & loadedLods = loadedMesh->getLods();
+    ASSERT_TRUE( loadedLods );
+    ASSERT_EQ( loadedLods->levels.size(), lods->levels.size() );
+    for ( size_t i = 0; i < lods->levels.size(); ++i )
+    {
+        EXPECT_EQ( loadedLods->levels[i].mesh->topology.numValidFaces(), lods->levels[i].mesh->topology.numValidFaces() );
+        EXPECT_FLOAT_EQ( loadedLods->levels[i].error, lods->levels[i].error );
+    }
+}
+
 } //namespace MR
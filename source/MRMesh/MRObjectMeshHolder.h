@@ -212,6 +212,29 @@ public:
     /// returns the amount of memory this object occupies on heap
     [[nodiscard]] MRMESH_API virtual size_t heapBytes() const override;
 
+    /// computes levels of details of the mesh if they are not computed or loaded yet;
+    /// they are reset on any change of the mesh, so this function shall be called again after it
+    MRMESH_API Expected<void> createLods( const ProgressCallback & cb = {} );
+
+    /// returns levels of details of the mesh if they are already computed or loaded, and nullptr otherwise
+    [[nodiscard]] const std::shared_ptr<const MeshLods>& getLods() const { return lods_; }
+
+    /// sets levels of details computed externally (e.g. in a background thread), they are reset on any change of the mesh
+    MRMESH_API void setLods( std::shared_ptr<const MeshLods> lods );
+
+    /// returns the coarsest level of details with the error not exceeding given value,
+    /// or the mesh itself if there is no such level or levels of details are not created
+    [[nodiscard]] MRMESH_API std::shared_ptr<const Mesh> meshByError( float maxError ) const;
+
+    /// returns the coarsest level of details with the error not exceeding given number of pixels on the screen
+    /// if one pixel corresponds to given length in the object space, or the mesh itself
+    [[nodiscard]] std::shared_ptr<const Mesh> meshByScreenError( float maxPixels, float pixelSize ) const
+        { return meshByError( maxPixels * pixelSize ); }
+
+    /// returns the finest level of details having at most given number of faces,
+    /// or the mesh itself if it satisfies the budget or levels of details are not created
+    [[nodiscard]] MRMESH_API std::shared_ptr<const Mesh> meshByFaces( int maxFaces ) const;
+
     /// returns file extension used to serialize the mesh
     [[nodiscard]] const char * saveMeshFormat() const { return saveMeshFormat_; }
 
@@ -248,6 +271,7 @@ protected:
     mutable std::optional<double> volume_;
     mutable std::optional<float> avgEdgeLen_;
     mutable ViewportProperty<XfBasedCache<Box3f>> worldBox_;
+    std::shared_ptr<const MeshLods> lods_;
 
     ObjectMeshHolder( const ObjectMeshHolder& other ) = default;
 
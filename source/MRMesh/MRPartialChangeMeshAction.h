@@ -0,0 +1,157 @@
+#pragma once
+#include "MRHistoryAction.h"
+#include "MRObjectMesh.h"
+#include "MRMesh.h"
+#include "MRMeshDiff.h"
+#include <memory>
+
+namespace MR
+{
+
+/// \defgroup HistoryGroup History group
+/// \{
+
+/// argument of this type indicates that the object is already in new state, and the following argument is old state
+struct CmpOld {};
+inline constexpr CmpOld cmpOld;
+
+/// argument of this type indicates that the object is in old state, and the following argument is new state to be set
+struct SetNew {};
+inline constexpr SetNew setNew;
+
+/// Undo action for ObjectMesh mesh change, which stores only the difference between old and new meshes;
+/// it takes much less memory than ChangeMeshAction if only a small part of a big mesh was modified
+class PartialChangeMeshAction : public HistoryAction
+{
+public:
+    using Obj = ObjectMesh;
+
+    /// use this constructor after the object already contains new mesh,
+    /// and old mesh is passed to remember the difference for future undoing
+    PartialChangeMeshAction( std::string name, const std::shared_ptr<ObjectMesh>& obj, CmpOld, const Mesh& oldMesh ) :
+        objMesh_{ obj },
+        name_{ std::move( name ) }
+    {
+        if ( !objMesh_ )
+            return;
+        if ( auto m = objMesh_->mesh() )
+            meshDiff_ = MeshDiff( *m, oldMesh );
+    }
+
+    /// use this constructor to set new object's mesh and remember its difference from existed mesh for future undoing
+    PartialChangeMeshAction( std::string name, const std::shared_ptr<ObjectMesh>& obj, SetNew, std::shared_ptr<Mesh>&& newMesh ) :
+        objMesh_{ obj },
+        name_{ std::move( name ) }
+    {
+        if ( !objMesh_ || !newMesh )
+            return;
+        if ( auto oldMesh = objMesh_->updateMesh( std::move( newMesh ) ) )
+            meshDiff_ = MeshDiff( *objMesh_->mesh(), *oldMesh );
+    }
+
+    virtual std::string name() const override
+    {
+        return name_;
+    }
+
+    virtual void action( HistoryAction::Type ) override
+    {
+        if ( !objMesh_ )
+            return;
+
+        if ( auto m = objMesh_->varMesh() )
+        {
+            meshDiff_.applyAndSwap( *m );
+            objMesh_->setDirtyFlags( DIRTY_ALL );
+        }
+    }
+
+    static void setObjectDirty( const std::shared_ptr<ObjectMesh>& obj )
+    {
+        if ( obj )
+            obj->setDirtyFlags( DIRTY_ALL );
+    }
+
+    [[nodiscard]] virtual size_t heapBytes() const override
+    {
+        return name_.capacity() + meshDiff_.heapBytes();
+    }
+
+private:
+    std::shared_ptr<ObjectMesh> objMesh_;
+    MeshDiff meshDiff_;
+
+    std::string name_;
+};
+
+/// Undo action for ObjectMesh points only (not topology) change, which stores only the coordinates of modified points
+class PartialChangeMeshPointsAction : public HistoryAction
+{
+public:
+    using Obj = ObjectMesh;
+
+    /// use this constructor after the object already contains new points,
+    /// and old points are passed to remember the difference for future undoing
+    PartialChangeMeshPointsAction( std::string name, const std::shared_ptr<ObjectMesh>& obj, CmpOld, const VertCoords& oldPoints ) :
+        objMesh_{ obj },
+        name_{ std::move( name ) }
+    {
+        if ( !objMesh_ )
+            return;
+        if ( auto m = objMesh_->mesh() )
+            pointsDiff_ = VertCoordsDiff( m->points, oldPoints );
+    }
+
+    /// use this constructor to set new object's points and remember their difference from existed points for future undoing
+    PartialChangeMeshPointsAction( std::string name, const std::shared_ptr<ObjectMesh>& obj, SetNew, VertCoords&& newPoints ) :
+        objMesh_{ obj },
+        name_{ std::move( name ) }
+    {
+        if ( !objMesh_ )
+            return;
+        if ( auto m = objMesh_->varMesh() )
+        {
+            pointsDiff_ = VertCoordsDiff( newPoints, m->points );
+            m->points = std::move( newPoints );
+            objMesh_->setDirtyFlags( DIRTY_POSITION );
+        }
+    }
+
+    virtual std::string name() const override
+    {
+        return name_;
+    }
+
+    virtual void action( HistoryAction::Type ) override
+    {
+        if ( !objMesh_ )
+            return;
+
+        if ( auto m = objMesh_->varMesh() )
+        {
+            pointsDiff_.applyAndSwap( m->points );
+            objMesh_->setDirtyFlags( DIRTY_POSITION );
+        }
+    }
+
+    static void setObjectDirty( const std::shared_ptr<ObjectMesh>& obj )
+    {
+        if ( obj )
+            obj->setDirtyFlags( DIRTY_POSITION );
+    }
+
+    [[nodiscard]] virtual size_t heapBytes() const override
+    {
+        return name_.capacity() + pointsDiff_.heapBytes();
+    }
+
+private:
+    std::shared_ptr<ObjectMesh> objMesh_;
+    VertCoordsDiff pointsDiff_;
+
+    std::string name_;
+};
+
+/// \}
+
+} // namespace MR
@@ -7,6 +7,7 @@
 #include "MRBestFit.h"
 #include "MRBestFitQuadric.h"
 #include "MRVector4.h"
+#include "MRScratchVector.h"
 
 namespace MR
 {
@@ -189,7 +190,8 @@ bool relaxApprox( PointCloud& pointCloud, const PointCloudApproxRelaxParams& par
         keepGoing = BitSetParallelFor( zone, [&] ( VertId v )
         {
             PointAccumulator accum;
-            std::vector<std::pair<VertId, double>> weightedNeighbors;
+            ScratchVector<std::pair<VertId, double>> weightedNeighborsBuf;
+            auto & weightedNeighbors = *weightedNeighborsBuf;
 
             findPointsInBall( pointCloud, pointCloud.points[v], radius,
                 [&] ( VertId newV, const Vector3f& position )
@@ -11,12 +11,71 @@
 #include "MRParallelFor.h"
 #include "MRComputeBoundingBox.h"
 #include "MRBitSetParallelFor.h"
+#include "MRGTest.h"
 
+#include <atomic>
 #include <fstream>
+#include <sstream>
 
 namespace MR::PointsLoad
 {
 
+namespace
+{
+
+// calls given function for each line of the text (including its end-of-line symbols) until the function returns false or an error
+template <typename F>
+Expected<bool> forEachLine( std::string_view text, F && f )
+{
+    while ( !text.empty() )
+    {
+        const auto nl = text.find( '\n' );
+        const auto lineSize = nl == std::string_view::npos ? text.size() : nl + 1;
+        auto res = f( text.substr( 0, lineSize ) );
+        if ( !res || !*res )
+            return res;
+        text.remove_prefix( lineSize );
+    }
+    return true;
+}
+
+// points parsed from one part of the text
+struct PointsChunk
+{
+    std::vector<Vector3f> points;
+    std::vector<Vector3f> normals;
+    std::vector<Color> colors;
+};
+
+// concatenates the points of all parts in order
+void mergePointsChunks( std::vector<PointsChunk> & chunks, PointCloud & cloud, bool hasNormals, VertColors * colors )
+{
+    MR_TIMER
+    std::vector<size_t> offsets( chunks.size() + 1, 0 );
+    for ( size_t ci = 0; ci < chunks.size(); ++ci )
+        offsets[ci + 1] = offsets[ci] + chunks[ci].points.size();
+    const auto numPoints = offsets.back();
+
+    cloud.points.resizeNoInit( numPoints );
+    if ( hasNormals )
+        cloud.normals.resizeNoInit( numPoints );
+    if ( colors )
+        colors->resizeNoInit( numPoints );
+    ParallelFor( size_t( 0 ), chunks.size(), [&] ( size_t ci )
+    {
+        auto & chunk = chunks[ci];
+        std::copy( chunk.points.begin(), chunk.points.end(), cloud.points.vec_.begin() + offsets[ci] );
+        if ( hasNormals )
+            std::copy( chunk.normals.begin(), chunk.normals.end(), cloud.normals.vec_.begin() + offsets[ci] );
+        if ( colors )
+            std::copy( chunk.colors.begin(), chunk.colors.end(), colors->vec_.begin() + offsets[ci] );
+        chunk = {};
+    } );
+    cloud.validPoints.resize( numPoints, true );
+}
+
+} // anonymous namespace
+
 Expected<PointCloud> fromText( const std::filesystem::path& file, const PointsLoadSettings& settings )
 {
     std::ifstream in( file, std::ifstream::binary );
@@ -37,15 +96,11 @@ Expected<PointCloud> fromText( std::istream& in, const PointsLoadSettings& setti
     if ( !reportProgress( settings.callback, 0.50f ) )
         return unexpectedOperationCanceled();
 
-    const auto newlines = splitByLines( buf->data(), buf->size() );
-    const auto lineCount = newlines.size() - 1;
-
-    if ( !reportProgress( settings.callback, 0.60f ) )
-        return unexpectedOperationCanceled();
-
-    PointCloud cloud;
-    cloud.points.resizeNoInit( lineCount );
-    cloud.validPoints.resize( lineCount, false );
+    const std::string_view text( buf->data(), buf->size() );
+    auto isSkipped = [] ( std::string_view line )
+    {
+        return line.empty() || line.starts_with( '#' ) || line.starts_with( ';' );
+    };
 
     // detect normals and colors
     constexpr Vector3d cInvalidNormal( 0.f, 0.f, 0.f );
@@ -53,11 +108,10 @@ Expected<PointCloud> fromText( std::istream& in, const PointsLoadSettings& setti
     Vector3d firstPoint;
     auto hasNormals = false;
     auto hasColors = false;
-    for ( auto i = 0; i < lineCount; ++i )
+    const auto firstLineFound = forEachLine( text, [&] ( std::string_view line ) -> Expected<bool>
     {
-        const std::string_view line( buf->data() + newlines[i], newlines[i + 1] - newlines[i + 0] );
-        if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
-            continue;
+        if ( isSkipped( line ) )
+            return true;
 
         auto normal = cInvalidNormal;
         auto color = cInvalidColor;
@@ -67,53 +121,60 @@ Expected<PointCloud> fromText( std::istream& in, const PointsLoadSettings& setti
 
         if ( settings.outXf )
             *settings.outXf = AffineXf3f::translation( Vector3f( firstPoint ) );
+        hasNormals = normal != cInvalidNormal;
+        hasColors = settings.colors && color != cInvalidColor;
+        return false;
+    } );
+    if ( !firstLineFound )
+        return unexpected( std::move( firstLineFound.error() ) );
 
-        if ( normal != cInvalidNormal )
-        {
-            hasNormals = true;
-            cloud.normals.resizeNoInit( lineCount );
-        }
-        if ( settings.colors && color != cInvalidColor )
-        {
-            hasColors = true;
-            settings.colors->resizeNoInit( lineCount );
-        }
-
-        break;
-    }
+    if ( !reportProgress( settings.callback, 0.60f ) )
+        return unexpectedOperationCanceled();
 
+    // the text is parsed in parallel by parts starting from new lines, each part collects its points in the order of appearance
+    const auto chunks = splitByLineChunks( buf->data(), buf->size() );
+    const auto numChunks = chunks.size() - 1;
+    std::vector<PointsChunk> chunkPoints( numChunks );
     std::string parseError;
-    tbb::task_group_context ctx;
-    const auto keepGoing = BitSetParallelForAll( cloud.validPoints, [&] ( VertId v )
+    std::atomic<bool> failed{ false };
+    const auto keepGoing = ParallelFor( size_t( 0 ), numChunks, [&] ( size_t ci )
     {
-        const std::string_view line( buf->data() + newlines[v], newlines[v + 1] - newlines[v + 0] );
-        if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
+        // skip remaining parts after the first parsing error
+        if ( failed )
             return;
-
+        auto & part = chunkPoints[ci];
         Vector3d point( noInit );
         Vector3d normal( noInit );
         Color color( noInit );
-        auto result = parseTextCoordinate( line, point, hasNormals ? &normal : nullptr, hasColors ? &color : nullptr );
-        if ( !result )
+        const auto res = forEachLine( text.substr( chunks[ci], chunks[ci + 1] - chunks[ci] ), [&] ( std::string_view line ) -> Expected<bool>
         {
-            if ( ctx.cancel_group_execution() )
-                parseError = std::move( result.error() );
-            return;
-        }
-
-        cloud.points[v] = Vector3f( settings.outXf ? point - firstPoint : point );
-        cloud.validPoints.set( v, true );
-        if ( hasNormals )
-            cloud.normals[v] = Vector3f( normal );
-        if ( hasColors )
-            ( *settings.colors )[v] = color;
-    }, subprogress( settings.callback, 0.60f, 1.00f ) );
+            if ( isSkipped( line ) )
+                return true;
+            auto result = parseTextCoordinate( line, point, hasNormals ? &normal : nullptr, hasColors ? &color : nullptr );
+            if ( !result )
+                return unexpected( std::move( result.error() ) );
+
+            part.points.push_back( Vector3f( settings.outXf ? point - firstPoint : point ) );
+            if ( hasNormals )
+                part.normals.push_back( Vector3f( normal ) );
+            if ( hasColors )
+                part.colors.push_back( color );
+            return true;
+        } );
+        if ( !res && !failed.exchange( true ) )
+            parseError = std::move( res.error() );
+    }, subprogress( settings.callback, 0.60f, 0.90f ) );
 
     if ( !keepGoing )
         return unexpectedOperationCanceled();
     if ( !parseError.empty() )
         return unexpected( std::move( parseError ) );
 
+    PointCloud cloud;
+    mergePointsChunks( chunkPoints, cloud, hasNormals, hasColors ? settings.colors : nullptr );
+
+    if ( !reportProgress( settings.callback, 1.00f ) )
+        return unexpectedOperationCanceled();
     return cloud;
 }
 
@@ -154,41 +215,49 @@ Expected<MR::PointCloud> fromPts( std::istream& in, const PointsLoadSettings& se
     if ( settings.callback && !settings.callback( 0.25f ) )
         return unexpected( "Loading canceled" );
 
-    const auto& data = *dataExp;
-    auto lineOffsets = splitByLines( data.data(), data.size() );
+    const std::string_view data( dataExp->data(), dataExp->size() );
+    // the first line after the header is skipped, and the second line defines the shift of all points
+    const auto firstLineEnd = data.find( '\n' );
+    if ( firstLineEnd == std::string_view::npos )
+        return unexpected( "No points in pts file" );
+    const auto body = data.substr( firstLineEnd + 1 );
 
-    int firstLine = 1;
     Vector3d firstLineCoord;
     Color firstLineColor;
-    std::string_view shitLine( data.data() + lineOffsets[firstLine], lineOffsets[firstLine + 1] - lineOffsets[firstLine] );
-    auto shiftLineRes = parsePtsCoordinate( shitLine, firstLineCoord, firstLineColor );
+    auto shiftLineRes = parsePtsCoordinate( body.substr( 0, body.find( '\n' ) ), firstLineCoord, firstLineColor );
     if ( !shiftLineRes.has_value() )
         return unexpected( shiftLineRes.error() );
 
     if ( settings.outXf )
         *settings.outXf = AffineXf3f::translation( Vector3f( firstLineCoord ) );
 
-    if ( settings.colors )
-        settings.colors->resize( lineOffsets.size() - firstLine - 1 );
-
-    PointCloud pc;
-    pc.points.resize( lineOffsets.size() - firstLine - 1 );
-
+    // the text is parsed in parallel by parts starting from new lines, each part collects its points in the order of appearance
+    const auto chunks = splitByLineChunks( body.data(), body.size() );
+    const auto numChunks = chunks.size() - 1;
+    std::vector<PointsChunk> chunkPoints( numChunks );
     std::string parseError;
-    tbb::task_group_context ctx;
-    auto keepGoing = ParallelFor( pc.points, [&] ( size_t i )
+    std::atomic<bool> failed{ false };
+    auto keepGoing = ParallelFor( size_t( 0 ), numChunks, [&] ( size_t ci )
     {
-        std::string_view line( data.data() + lineOffsets[firstLine + i], lineOffsets[firstLine + i + 1] - lineOffsets[firstLine + i] );
+        // skip remaining parts after the first parsing error
+        if ( failed )
+            return;
+        auto & part = chunkPoints[ci];
         Vector3d tempDoubleCoord;
         Color tempColor;
-        auto parseRes = parsePtsCoordinate( line, tempDoubleCoord, tempColor );
-        if ( !parseRes.has_value() && ctx.cancel_group_execution() )
-            parseError = std::move( parseRes.error() );
-
-        pc.points[VertId( i )] = Vector3f( tempDoubleCoord - firstLineCoord );
-        if ( settings.colors )
-            ( *settings.colors )[VertId( i )] = tempColor;
-    }, subprogress( settings.callback, 0.25f, 1.0f ) );
+        const auto res = forEachLine( body.substr( chunks[ci], chunks[ci + 1] - chunks[ci] ), [&] ( std::string_view line ) -> Expected<bool>
+        {
+            auto parseRes = parsePtsCoordinate( line, tempDoubleCoord, tempColor );
+            if ( !parseRes.has_value() )
+                return unexpected( std::move( parseRes.error() ) );
+            part.points.push_back( Vector3f( tempDoubleCoord - firstLineCoord ) );
+            if ( settings.colors )
+                part.colors.push_back( tempColor );
+            return true;
+        } );
+        if ( !res && !failed.exchange( true ) )
+            parseError = std::move( res.error() );
+    }, subprogress( settings.callback, 0.25f, 0.9f ) );
 
     if ( !keepGoing )
         return unexpected( "Loading canceled" );
@@ -196,7 +265,8 @@ Expected<MR::PointCloud> fromPts( std::istream& in, const PointsLoadSettings& se
     if ( !parseError.empty() )
         return unexpected( parseError );
 
-    pc.validPoints.resize( pc.points.size(), true );
+    PointCloud pc;
+    mergePointsChunks( chunkPoints, pc, false, settings.colors );
     return pc;
 }
 
@@ -430,4 +500,31 @@ MR_ADD_POINTS_LOADER( IOFilter( "PLY (.ply)",        "*.ply" ), fromPly )
 MR_ADD_POINTS_LOADER( IOFilter( "LIDAR scanner (.pts)", "*.pts" ), fromPts )
 MR_ADD_POINTS_LOADER( IOFilter( "DXF (.dxf)",        "*.dxf" ), fromDxf )
 
+TEST( MRMesh, PointsLoadText )
+{
+    // the text is large enough to be parsed in several parts
+    constexpr int numPoints = 100000;
+    std::string text = "# comment\n";
+    for ( int i = 0; i < numPoints; ++i )
+    {
+        text += std::to_string( i ) + " 0.5 " + std::to_string( -i ) + " 0 0 1\n";
+        if ( i % 1000 == 0 )
+            text += "; comment\n";
+    }
+    std::istringstream in( text );
+    auto cloud = fromText( in );
+    ASSERT_TRUE( cloud.has_value() );
+    ASSERT_EQ( cloud->points.size(), numPoints );
+    ASSERT_EQ( cloud->normals.size(), numPoints );
+    EXPECT_EQ( cloud->validPoints.count(), numPoints );
+    for ( int i = 0; i < numPoints; i += 997 )
+    {
+        EXPECT_EQ( cloud->points[VertId( i )], Vector3f( float( i ), 0.5f, float( -i ) ) );
+        EXPECT_EQ( cloud->normals[VertId( i )], Vector3f( 0, 0, 1 ) );
+    }
+
+    std::istringstream bad( text + "1 2 x\n" );
+    EXPECT_FALSE( fromText( bad ).has_value() );
+}
+
 } // namespace MR::PointsLoad
@@ -3,6 +3,7 @@
 #include "MRPolylineTopology.h"
 #include "MRPolylineEdgeIterator.h"
 #include "MRTimer.h"
+#include "MRConcurrentUnionFind.h"
 #include "MRVector2.h"
 #include "MRVector3.h"
 #include "MRPch/MRTBB.h"
@@ -125,17 +126,19 @@ UnionFind<MR::UndirectedEdgeId> getUnionFindStructure( const PolylineTopology& t
 
     auto size = topology.undirectedEdgeSize();
 
-    UnionFind<UndirectedEdgeId> unionFindStructure( size );
-    for ( auto u0 : undirectedEdges( topology ) )
+    ConcurrentUnionFind<UndirectedEdgeId> unionFindStructure( size );
+    ParallelFor( 0_ue, UndirectedEdgeId( size ), [&] ( UndirectedEdgeId u0 )
     {
+        if ( topology.isLoneEdge( u0 ) )
+            return;
         auto u1 = topology.next( u0 );
         auto u2 = topology.next( EdgeId( u0 ).sym() );
         if ( u1.valid() && u1.undirected() != u0 )
             unionFindStructure.unite( u0, u1.undirected() );
         if ( u2.valid() && u2.undirected() != u0 )
             unionFindStructure.unite( u0, u2.undirected() );
-    }
-    return unionFindStructure;
+    } );
+    return unionFindStructure.toUnionFind();
 }
 
 template <typename V>
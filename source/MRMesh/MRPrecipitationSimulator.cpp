@@ -1,6 +1,11 @@
 #include "MRPrecipitationSimulator.h"
 #include "MRWatershedGraph.h"
+#include "MRMesh.h"
+#include "MRBasinVolume.h"
+#include "MRRingIterator.h"
 #include "MRTimer.h"
+#include "MRGTest.h"
+#include <algorithm>
 
 namespace MR
 {
@@ -81,4 +86,191 @@ auto PrecipitationSimulator::simulateOne() -> SimulationStep
     return res;
 }
 
+PrecipitationTimeline::PrecipitationTimeline( WatershedGraph& wg )
+{
+    MR_TIMER
+
+    const auto numIniBasins = wg.graph().vertSize();
+    nodes_.reserve( 2 * numIniBasins );
+    std::vector<int> parents;
+    parents.reserve( 2 * numIniBasins );
+    // the current node of each valid basin
+    std::vector<int> basinNode( numIniBasins );
+    for ( size_t i = 0; i < numIniBasins; ++i )
+    {
+        nodes_.push_back( { .basin = GraphVertId( i ) } );
+        parents.push_back( -1 );
+        basinNode[i] = int( i );
+    }
+
+    PrecipitationSimulator sim( wg );
+    for ( ;; )
+    {
+        const auto step = sim.simulateOne();
+        if ( step.event == PrecipitationSimulator::Event::Finish )
+            break;
+        assert( events_.empty() || events_.back().amount <= step.amount );
+        events_.push_back( step );
+        if ( step.event == PrecipitationSimulator::Event::BasinFull )
+        {
+            auto & node = nodes_[basinNode[step.basin]];
+            node.fullAmount = step.amount;
+            node.overflowTo = step.neiBasin;
+            continue;
+        }
+        assert( step.event == PrecipitationSimulator::Event::Merge );
+        const int n = (int)nodes_.size();
+        nodes_.push_back( { .basin = step.basin, .fromAmount = step.amount } );
+        parents.push_back( -1 );
+        parents[basinNode[step.basin]] = n;
+        parents[basinNode[step.neiBasin]] = n;
+        basinNode[step.basin] = n;
+    }
+
+    // binary lifting: each level doubles the distance to ancestors
+    ancestors_.push_back( std::move( parents ) );
+    for ( bool anyAncestor = true; anyAncestor; )
+    {
+        const auto & prev = ancestors_.back();
+        std::vector<int> next( prev.size(), -1 );
+        anyAncestor = false;
+        for ( size_t i = 0; i < prev.size(); ++i )
+        {
+            if ( prev[i] < 0 )
+                continue;
+            next[i] = prev[prev[i]];
+            anyAncestor = anyAncestor || next[i] >= 0;
+        }
+        ancestors_.push_back( std::move( next ) );
+    }
+}
+
+size_t PrecipitationTimeline::numEventsTill( float amount ) const
+{
+    return std::upper_bound( events_.begin(), events_.end(), amount,
+        []( float a, const PrecipitationSimulator::SimulationStep & step ) { return a < step.amount; } ) - events_.begin();
+}
+
+int PrecipitationTimeline::nodeAt_( GraphVertId iniBasin, float amount ) const
+{
+    assert( iniBasin && iniBasin < nodes_.size() );
+    int n = iniBasin;
+    // the basins formed later are located higher in the tree, so the highest ancestor formed till given amount is searched
+    for ( int k = (int)ancestors_.size() - 1; k >= 0; --k )
+    {
+        const auto a = ancestors_[k][n];
+        if ( a >= 0 && nodes_[a].fromAmount <= amount )
+            n = a;
+    }
+    return n;
+}
+
+auto PrecipitationTimeline::basinStateAt( GraphVertId iniBasin, float amount ) const -> BasinState
+{
+    const auto & node = nodes_[nodeAt_( iniBasin, amount )];
+    BasinState res
+    {
+        .basin = node.basin,
+        .full = node.fullAmount <= amount,
+        .fullAmount = node.fullAmount
+    };
+    if ( res.full )
+        res.overflowTo = nodes_[nodeAt_( node.overflowTo, amount )].basin;
+    return res;
+}
+
+TEST( MRMesh, PrecipitationTimeline )
+{
+    // bowl-shaped terrain with several pits, which are merged before overflowing outside
+    const int n = 64;
+    VertCoords points;
+    Triangulation t;
+    for ( int y = 0; y < n; ++y )
+        for ( int x = 0; x < n; ++x )
+        {
+            const float fx = float( x ) / ( n - 1 ), fy = float( y ) / ( n - 1 );
+            points.emplace_back( fx, fy, 0.1f * std::sin( 23 * fx ) * std::cos( 19 * fy ) + sqr( fx - 0.5f ) + sqr( fy - 0.5f ) );
+        }
+    for ( int y = 0; y + 1 < n; ++y )
+        for ( int x = 0; x + 1 < n; ++x )
+        {
+            const VertId v( y * n + x );
+            t.push_back( { v, v + 1, v + n + 1 } );
+            t.push_back( { v, v + n + 1, v + n } );
+        }
+    const auto mesh = Mesh::fromTriangles( std::move( points ), t );
+
+    // initial basins: each vertex flows to its lowest neighbor, and each face goes in the basin of its lowest vertex
+    VertMap flowTo( mesh.topology.vertSize() );
+    for ( auto v : mesh.topology.getValidVerts() )
+    {
+        flowTo[v] = v;
+        for ( auto e : orgRing( mesh.topology, v ) )
+            if ( mesh.points[mesh.topology.dest( e )].z < mesh.points[flowTo[v]].z )
+                flowTo[v] = mesh.topology.dest( e );
+    }
+    Vector<int, VertId> minimum2basin( mesh.topology.vertSize(), -1 );
+    int numBasins = 0;
+    Vector<int, FaceId> face2basin( mesh.topology.faceSize() );
+    for ( auto f : mesh.topology.getValidFaces() )
+    {
+        auto vs = mesh.topology.getTriVerts( f );
+        auto v = *std::min_element( vs.begin(), vs.end(), [&]( VertId a, VertId b ) { return mesh.points[a].z < mesh.points[b].z; } );
+        while ( flowTo[v] != v )
+            v = flowTo[v];
+        if ( minimum2basin[v] < 0 )
+            minimum2basin[v] = numBasins++;
+        face2basin[f] = minimum2basin[v];
+    }
+    EXPECT_GT( numBasins, 4 );
+
+    WatershedGraph wg( mesh, face2basin, numBasins );
+    PrecipitationTimeline timeline( wg );
+    ASSERT_FALSE( timeline.events().empty() );
+    EXPECT_TRUE( std::any_of( timeline.events().begin(), timeline.events().end(),
+        []( const auto & step ) { return step.event == PrecipitationSimulator::Event::Merge; } ) );
+
+    // compare the states found in the timeline with step-by-step simulation
+    WatershedGraph wgRef( mesh, face2basin, numBasins );
+    PrecipitationSimulator sim( wgRef );
+    const auto & events = timeline.events();
+    for ( size_t i = 0; i < events.size(); ++i )
+    {
+        const auto step = sim.simulateOne();
+        EXPECT_EQ( step.event, events[i].event );
+        EXPECT_EQ( step.amount, events[i].amount );
+        if ( i + 1 < events.size() && events[i + 1].amount == events[i].amount )
+            continue;
+        const auto amount = events[i].amount;
+        EXPECT_EQ( timeline.numEventsTill( amount ), i + 1 );
+        for ( auto basin = GraphVertId( 0 ); basin < numBasins; ++basin )
+        {
+            const auto state = timeline.basinStateAt( basin, amount );
+            const auto root = wgRef.getRootBasin( basin );
+            EXPECT_EQ( state.basin, root );
+            EXPECT_EQ( state.full, bool( wgRef.basinInfo( root ).overflowVia ) );
+            if ( state.full )
+            {
+                EXPECT_EQ( state.overflowTo, wgRef.flowsTo( root ) );
+            }
+        }
+    }
+    EXPECT_EQ( sim.simulateOne().event, PrecipitationSimulator::Event::Finish );
+
+    // compression of union-find trees does not change the roots
+    const auto roots = wgRef.iniBasin2Tgt();
+    wgRef.setParentsToRoots();
+    EXPECT_EQ( wgRef.iniBasin2Tgt(), roots );
+    EXPECT_EQ( timeline.numEventsTill( -1.0f ), 0 );
+
+    // the volume of merged basins computed on their own faces is the same as on all faces below the level
+    for ( auto basin : wg.graph().validVerts() )
+    {
+        if ( basin == wg.outsideId() )
+            continue;
+        const auto level = wg.basinInfo( basin ).lowestBdLevel;
+        EXPECT_NEAR( wg.computeBasinVolume( basin, level ), computeBasinVolume( mesh, wg.getBasinFacesBelowLevel( basin, level ), level ), 1e-9 );
+    }
+}
+
 } //namespace MR
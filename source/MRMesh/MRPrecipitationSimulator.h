@@ -3,6 +3,7 @@
 #include "MRId.h"
 #include "MRHeap.h"
 #include <cfloat>
+#include <vector>
 
 namespace MR
 {
@@ -39,4 +40,50 @@ private:
     Heap<float, GraphVertId, std::greater<float>> heap_;
 };
 
+/// all events of the precipitation in the terrain computed in advance till all basins become full;
+/// after that the state of any basin at any amount of precipitation is found in logarithmic time
+class PrecipitationTimeline
+{
+public:
+    /// simulates the precipitation till the end, given graph is modified in the process as by PrecipitationSimulator
+    MRMESH_API explicit PrecipitationTimeline( WatershedGraph& wg );
+
+    /// all events (except for final Event::Finish) in the order of increasing amount of precipitation
+    [[nodiscard]] const std::vector<PrecipitationSimulator::SimulationStep> & events() const { return events_; }
+
+    /// returns the number of events happened at given amount of precipitation or before it
+    [[nodiscard]] MRMESH_API size_t numEventsTill( float amount ) const;
+
+    struct BasinState
+    {
+        GraphVertId basin;      ///< the basin containing given initial basin at given amount of precipitation
+        bool full = false;      ///< whether the basin is full and all water arriving in it overflows
+        float fullAmount = FLT_MAX; ///< the amount of precipitation when the basin became (or will become) full,
+                                ///< FLT_MAX if it will be merged with another basin before that
+        GraphVertId overflowTo; ///< if full, then the basin where the flow from it goes next
+    };
+
+    /// returns the state of the basin containing given initial basin at given amount of precipitation
+    [[nodiscard]] MRMESH_API BasinState basinStateAt( GraphVertId iniBasin, float amount ) const;
+
+private:
+    /// returns the node in the tree of merges representing the basin containing given initial basin at given amount of precipitation
+    int nodeAt_( GraphVertId iniBasin, float amount ) const;
+
+    std::vector<PrecipitationSimulator::SimulationStep> events_;
+
+    /// the tree of merges: initial basins are leaves, and each merge creates a node, which is the parent of both merged nodes
+    struct Node
+    {
+        GraphVertId basin;        ///< the basin id remaining after the merge
+        float fromAmount = 0;     ///< the amount of precipitation when the basin was formed
+        float fullAmount = FLT_MAX;
+        GraphVertId overflowTo;
+    };
+    std::vector<Node> nodes_;
+
+    /// ancestors_[k][n] is the ancestor of node n at the distance 2^k in the tree of merges, or -1 if it does not exist
+    std::vector<std::vector<int>> ancestors_;
+};
+
 } //namespace MR
@@ -1,4 +1,8 @@
 #include "MRProgressReadWrite.h"
+#include "MRParallelFor.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <vector>
 
 namespace MR
 {
@@ -51,4 +55,29 @@ bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallba
     return true;
 }
 
+bool writeByChunks( std::ostream& out, size_t numChunks, const std::function<void( size_t, std::string& )>& encodeChunk, ProgressCallback callback /*= {}*/ )
+{
+    // several chunks per thread to balance the load, while the writing of one batch is sequential
+    const size_t batchSize = 4 * std::max( 1, tbb::this_task_arena::max_concurrency() );
+    std::vector<std::string> bufs( std::min( batchSize, numChunks ) );
+    for ( size_t batchBegin = 0; batchBegin < numChunks; batchBegin += batchSize )
+    {
+        const size_t batchEnd = std::min( numChunks, batchBegin + batchSize );
+        ParallelFor( batchBegin, batchEnd, [&]( size_t i )
+        {
+            auto & buf = bufs[i - batchBegin];
+            buf.clear();
+            encodeChunk( i, buf );
+        } );
+        for ( size_t i = batchBegin; i < batchEnd; ++i )
+        {
+            const auto & buf = bufs[i - batchBegin];
+            out.write( buf.data(), buf.size() );
+        }
+        if ( !reportProgress( callback, float( batchEnd ) / numChunks ) )
+            return false;
+    }
+    return true;
+}
+
 }
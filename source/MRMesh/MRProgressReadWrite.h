@@ -3,6 +3,7 @@
 #include "MRMeshFwd.h"
 #include <ostream>
 #include <istream>
+#include <string>
 
 namespace MR
 {
@@ -22,4 +23,12 @@ MRMESH_API bool writeByBlocks( std::ostream& out, const char* data, size_t dataS
  */
 MRMESH_API bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 16 ) );
 
+/**
+ * \brief encodes numChunks chunks of data in parallel and writes them to out stream in order
+ * \details encodeChunk( i, buf ) appends the encoding of i-th chunk to the empty buffer;
+ * only a limited number of encoded chunks is kept in memory, and their buffers are reused
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool writeByChunks( std::ostream& out, size_t numChunks, const std::function<void( size_t, std::string& )>& encodeChunk, ProgressCallback callback = {} );
+
 }
@@ -13,6 +13,7 @@ template<typename T>
 struct RayOrigin
 {
     Vector3<T> p;
+    RayOrigin() = default;
     RayOrigin( const Vector3<T> & ro ) : p( ro ) { }
 };
 
@@ -22,6 +23,7 @@ template<>
 struct RayOrigin<float>
 {
     __m128 p;
+    RayOrigin() = default;
     RayOrigin( const Vector3f & ro ) { p = _mm_set_ps( ro.x, ro.y, ro.z, 0 ); }
 };
 
@@ -0,0 +1,131 @@
+#include "MRScratchVector.h"
+#include "MRParallelFor.h"
+#include "MRGTest.h"
+#include <mutex>
+
+namespace MR
+{
+
+namespace
+{
+tbb::enumerable_thread_specific<ScratchStats> & allScratchStats()
+{
+    static tbb::enumerable_thread_specific<ScratchStats> stats;
+    return stats;
+}
+
+struct ScratchPools
+{
+    std::mutex mutex;
+    std::vector<void ( * )()> releaseFuncs;
+};
+
+ScratchPools & scratchPools()
+{
+    static ScratchPools pools;
+    return pools;
+}
+} // anonymous namespace
+
+ScratchStats & detail::localScratchStats()
+{
+    return allScratchStats().local();
+}
+
+ScratchStats getScratchStats()
+{
+    ScratchStats res;
+    for ( const auto & s : allScratchStats() )
+        res += s;
+    return res;
+}
+
+void resetScratchStats()
+{
+    for ( auto & s : allScratchStats() )
+        s = {};
+}
+
+void detail::registerScratchPool( void ( *release )() )
+{
+    auto & pools = scratchPools();
+    std::lock_guard lock( pools.mutex );
+    pools.releaseFuncs.push_back( release );
+}
+
+void releaseScratchBuffers()
+{
+    std::vector<void ( * )()> funcs;
+    {
+        auto & pools = scratchPools();
+        std::lock_guard lock( pools.mutex );
+        funcs = pools.releaseFuncs;
+    }
+    for ( auto f : funcs )
+        f();
+}
+
+TEST( MRMesh, ScratchVector )
+{
+    releaseScratchBuffers();
+    resetScratchStats();
+    {
+        ScratchVector<int> v;
+        EXPECT_TRUE( v->empty() );
+        v->resize( 100, 1 );
+    }
+    {
+        ScratchVector<int> v;
+        EXPECT_TRUE( v->empty() );
+        EXPECT_GE( v->capacity(), 100 );
+        v->resize( 50 ); // no allocation here
+        ScratchVector<int> w; // nested buffer is taken separately
+        EXPECT_EQ( w->capacity(), 0 );
+    }
+    auto stats = getScratchStats();
+    EXPECT_EQ( stats.acquired, 3 );
+    EXPECT_EQ( stats.reused, 1 );
+    EXPECT_EQ( stats.grown, 1 );
+
+    // large buffers are not kept in the pool
+    {
+        ScratchVector<int> v;
+        v->resize( ScratchVector<int>::MaxPooledBytes / sizeof( int ) + 1 );
+    }
+    {
+        ScratchVector<int> v;
+        EXPECT_LE( v->capacity() * sizeof( int ), ScratchVector<int>::MaxPooledBytes );
+    }
+
+    // released buffers are not reused
+    releaseScratchBuffers();
+    {
+        ScratchVector<int> v;
+        EXPECT_EQ( v->capacity(), 0 );
+    }
+
+    resetScratchStats();
+    constexpr int n = 10000;
+    ParallelFor( 0, n, [&]( int i )
+    {
+        ScratchVector<int> v;
+        v->resize( 64, i );
+    } );
+    stats = getScratchStats();
+    EXPECT_EQ( stats.acquired, n );
+    // only the first usage in each thread allocates
+    EXPECT_LT( stats.grown, n );
+    EXPECT_EQ( stats.reused + stats.grown, n );
+
+    // the buffers of all threads are released
+    releaseScratchBuffers();
+    resetScratchStats();
+    ParallelFor( 0, n, [&]( int )
+    {
+        ScratchVector<int> v;
+        EXPECT_EQ( v->capacity(), 0 );
+    } );
+    EXPECT_EQ( getScratchStats().reused, 0 );
+}
+
+} //namespace MR
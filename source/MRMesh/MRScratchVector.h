@@ -0,0 +1,122 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRPch/MRTBB.h"
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup BasicGroup
+/// \{
+
+/// counters of scratch buffers usage, to measure how many heap allocations are avoided
+struct ScratchStats
+{
+    /// the number of ScratchVector objects created
+    size_t acquired = 0;
+    /// the number of times a ScratchVector got a buffer with already allocated memory from the pool
+    size_t reused = 0;
+    /// the number of times a buffer had to increase its capacity during its usage (at least one allocation each)
+    size_t grown = 0;
+
+    ScratchStats & operator +=( const ScratchStats & b ) { acquired += b.acquired; reused += b.reused; grown += b.grown; return *this; }
+};
+
+/// returns the sum of scratch buffers statistics over all threads
+[[nodiscard]] MRMESH_API ScratchStats getScratchStats();
+
+/// sets all scratch buffers statistics to zero
+MRMESH_API void resetScratchStats();
+
+/// frees the memory of all scratch buffers kept in the pools of all threads;
+/// it must not be called concurrently with any code using ScratchVector (e.g. call it between long operations)
+MRMESH_API void releaseScratchBuffers();
+
+namespace detail
+{
+/// statistics of scratch buffers in the current thread
+[[nodiscard]] MRMESH_API ScratchStats & localScratchStats();
+
+/// remembers the function freeing the pools of one type of scratch buffers in all threads, to be called from releaseScratchBuffers()
+MRMESH_API void registerScratchPool( void ( *release )() );
+} // namespace detail
+
+/// temporary std::vector, which takes its memory from the thread-local pool and returns it back on destruction,
+/// so the functions called many times (including from parallel loops) do not allocate new memory in each call;
+/// the vector is always empty after construction
+template<typename T>
+class ScratchVector
+{
+public:
+    /// the maximal number of free buffers kept in the pool of one thread
+    static constexpr size_t MaxPooledBuffers = 16;
+    /// the buffers occupying more memory than this are freed on destruction instead of returning to the pool
+    static constexpr size_t MaxPooledBytes = size_t( 1 ) << 20;
+
+    ScratchVector()
+    {
+        auto & stats = detail::localScratchStats();
+        ++stats.acquired;
+        auto & pool = pool_().local();
+        if ( !pool.empty() )
+        {
+            vec_ = std::move( pool.back() );
+            pool.pop_back();
+            ++stats.reused;
+        }
+        initCapacity_ = vec_.capacity();
+    }
+
+    ScratchVector( ScratchVector && b ) noexcept : vec_( std::move( b.vec_ ) ), initCapacity_( b.initCapacity_ ) { b.initCapacity_ = 0; }
+    ScratchVector( const ScratchVector & ) = delete;
+    ScratchVector & operator =( const ScratchVector & ) = delete;
+    ScratchVector & operator =( ScratchVector && ) = delete;
+
+    /// returns the buffer to the pool of the current thread (not necessarily the thread where it was taken),
+    /// if the buffer is not too large
+    ~ScratchVector()
+    {
+        if ( vec_.capacity() == 0 )
+            return;
+        if ( vec_.capacity() > initCapacity_ )
+            ++detail::localScratchStats().grown;
+        if ( vec_.capacity() * sizeof( T ) > MaxPooledBytes )
+            return;
+        auto & pool = pool_().local();
+        if ( pool.size() >= MaxPooledBuffers )
+            return;
+        vec_.clear();
+        pool.push_back( std::move( vec_ ) );
+    }
+
+    /// frees all buffers of this type kept in the pools of all threads, not thread-safe
+    static void releasePools()
+    {
+        for ( auto & pool : pool_() )
+        {
+            pool.clear();
+            pool.shrink_to_fit();
+        }
+    }
+
+    [[nodiscard]] std::vector<T> & operator *() { return vec_; }
+    [[nodiscard]] const std::vector<T> & operator *() const { return vec_; }
+    [[nodiscard]] std::vector<T> * operator ->() { return &vec_; }
+    [[nodiscard]] const std::vector<T> * operator ->() const { return &vec_; }
+
+private:
+    static tbb::enumerable_thread_specific<std::vector<std::vector<T>>> & pool_()
+    {
+        static tbb::enumerable_thread_specific<std::vector<std::vector<T>>> pool;
+        [[maybe_unused]] static const bool registered = ( detail::registerScratchPool( &releasePools ), true );
+        return pool;
+    }
+
+    std::vector<T> vec_;
+    size_t initCapacity_ = 0;
+};
+
+/// \}
+
+} // namespace MR
@@ -4,9 +4,13 @@
 #include "MRIntersectionPrecomputes.h"
 #include "MRLine3.h"
 #include "MRMeshIntersect.h"
+#include "MRTriangleIntersection.h"
+#include "MRRayBoxIntersection.h"
+#include "MRParallelFor.h"
 #include "MRTimer.h"
+#include "MRGTest.h"
+#include <atomic>
 #include <cfloat>
-#include <cstdlib>
 
 namespace MR
 {
@@ -38,16 +42,217 @@ std::vector<Vector3f> sampleHalfSphere()
         {
             // Start from North and proceed in a clockwise direction
             float currentAzimuth = PI2_F - ( 2 * PI_F * j / patchesInCurrentRow );
-            patches.push_back( unitVector3( currentAltitude + patchAngleIncrement / 2, currentAzimuth ) );
+            patches.push_back( unitVector3( currentAzimuth, currentAltitude + patchAngleIncrement / 2 ) );
         }
     }
 
     // Add zenith patch
-    patches.push_back( unitVector3( PI2_F, 0.0f ) );
+    patches.push_back( unitVector3( 0.0f, PI2_F ) );
 
     return patches;
 }
 
+namespace
+{
+
+/// the triangles of a mesh binned in a uniform grid on the plane orthogonal to one sky direction, like in a shadow map:
+/// the ray in that direction from a point can intersect only the triangles of the cell of that point
+class SkyDirectionGrid
+{
+public:
+    /// \param tris the triangulation of the mesh and \param box its bounding box, they are shared by the grids of all directions
+    SkyDirectionGrid( const Mesh & mesh, const Triangulation & tris, const Box3f & box, const Vector3f & dir );
+
+    /// finds intersection of the ray from given point in the direction of the grid with the mesh, the same as rayMeshIntersect( mesh, Line3f( p, dir ), 0, FLT_MAX, &prec, closestIntersect )
+    /// except for the choice among several triangles intersected exactly at the same distance
+    [[nodiscard]] MeshIntersectionResult intersect( const Vector3f & p, const IntersectionPrecomputes<float> & prec, bool closestIntersect ) const;
+
+private:
+    /// returns the coordinates of the point along two directions on the plane and along the sky direction
+    [[nodiscard]] Vector3f project_( const Vector3f & p ) const { const auto q = p - center_; return { dot( u_, q ), dot( v_, q ), dot( dir_, q ) }; }
+    [[nodiscard]] int cellX_( float x ) const { return std::clamp( int( ( x - min_.x ) * invCellSize_ ), 0, dims_.x - 1 ); }
+    [[nodiscard]] int cellY_( float y ) const { return std::clamp( int( ( y - min_.y ) * invCellSize_ ), 0, dims_.y - 1 ); }
+    /// returns false if the projection of the point is certainly outside of the projection of the triangle
+    [[nodiscard]] bool mayCover_( const Vector3f & a, const Vector3f & b, const Vector3f & c, const Vector3f & q ) const;
+
+    const Mesh & mesh_;
+    const Triangulation & tris_;
+    Vector3f rayDir_;
+    /// orthonormal basis with the normalized direction
+    Vector3f dir_, u_, v_;
+    Vector3f center_;
+    /// tolerance for rounding errors in projected coordinates
+    float eps_ = 0;
+    Vector2f min_, max_;
+    float invCellSize_ = 0;
+    Vector2i dims_;
+
+    Vector<Vector3f, VertId> projs_;
+    struct Entry
+    {
+        FaceId face;
+        /// the farthest coordinate of the triangle along the direction
+        float maxDepth = 0;
+    };
+    /// the triangles of each cell are stored in cellEntries_ in [cellBegin_[c], cellBegin_[c+1])
+    std::vector<int> cellBegin_;
+    std::vector<Entry> cellEntries_;
+};
+
+SkyDirectionGrid::SkyDirectionGrid( const Mesh & mesh, const Triangulation & tris, const Box3f & box, const Vector3f & dir ) : mesh_( mesh ), tris_( tris )
+{
+    MR_TIMER
+    rayDir_ = dir;
+    dir_ = dir.normalized();
+    u_ = cross( dir_, dir_.furthestBasisVector() ).normalized();
+    v_ = cross( dir_, u_ );
+
+    const auto numFaces = mesh.topology.numValidFaces();
+    if ( !box.valid() || numFaces <= 0 )
+    {
+        dims_ = { 1, 1 };
+        cellBegin_.assign( 2, 0 );
+        return;
+    }
+    center_ = box.center();
+    eps_ = 16 * FLT_EPSILON * ( std::max( { std::abs( center_.x ), std::abs( center_.y ), std::abs( center_.z ) } ) + box.diagonal() );
+
+    projs_.resize( mesh.points.size() );
+    ParallelFor( projs_, [&]( VertId v )
+    {
+        projs_[v] = project_( mesh.points[v] );
+    } );
+    min_ = Vector2f::diagonal( FLT_MAX );
+    max_ = Vector2f::diagonal( -FLT_MAX );
+    for ( int i = 0; i < 8; ++i )
+    {
+        const auto c = project_( { i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z } );
+        min_.x = std::min( min_.x, c.x - eps_ );
+        min_.y = std::min( min_.y, c.y - eps_ );
+        max_.x = std::max( max_.x, c.x + eps_ );
+        max_.y = std::max( max_.y, c.y + eps_ );
+    }
+
+    // about four triangles per cell on average
+    const auto size = max_ - min_;
+    const float cellSize = std::sqrt( 4 * size.x * size.y / numFaces );
+    invCellSize_ = cellSize > 0 ? 1 / cellSize : 0;
+    dims_.x = std::clamp( int( std::ceil( size.x * invCellSize_ ) ), 1, numFaces );
+    dims_.y = std::clamp( int( std::ceil( size.y * invCellSize_ ) ), 1, numFaces );
+    const size_t numCells = size_t( dims_.x ) * dims_.y;
+
+    // calls f( cell, entry ) for each cell intersected by the bounding box of projected triangle
+    auto forEachCell = [&]( FaceId f, auto && cellFunc )
+    {
+        const auto & a = projs_[tris_[f][0]], & b = projs_[tris_[f][1]], & c = projs_[tris_[f][2]];
+        const Entry entry{ f, std::max( { a.z, b.z, c.z } ) };
+        const int x0 = cellX_( std::min( { a.x, b.x, c.x } ) - eps_ ), x1 = cellX_( std::max( { a.x, b.x, c.x } ) + eps_ );
+        const int y0 = cellY_( std::min( { a.y, b.y, c.y } ) - eps_ ), y1 = cellY_( std::max( { a.y, b.y, c.y } ) + eps_ );
+        for ( int y = y0; y <= y1; ++y )
+            for ( int x = x0; x <= x1; ++x )
+                cellFunc( size_t( y ) * dims_.x + x, entry );
+    };
+
+    // counting sort of triangles by cells
+    std::vector<std::atomic<int>> cellPos( numCells );
+    BitSetParallelFor( mesh.topology.getValidFaces(), [&]( FaceId f )
+    {
+        forEachCell( f, [&]( size_t c, const Entry & ) { cellPos[c].fetch_add( 1, std::memory_order_relaxed ); } );
+    } );
+    cellBegin_.resize( numCells + 1 );
+    cellBegin_[0] = 0;
+    for ( size_t c = 0; c < numCells; ++c )
+    {
+        cellBegin_[c + 1] = cellBegin_[c] + cellPos[c].load( std::memory_order_relaxed );
+        cellPos[c].store( cellBegin_[c], std::memory_order_relaxed );
+    }
+    cellEntries_.resize( cellBegin_.back() );
+    BitSetParallelFor( mesh.topology.getValidFaces(), [&]( FaceId f )
+    {
+        forEachCell( f, [&]( size_t c, const Entry & entry ) { cellEntries_[cellPos[c].fetch_add( 1, std::memory_order_relaxed )] = entry; } );
+    } );
+}
+
+bool SkyDirectionGrid::mayCover_( const Vector3f & a, const Vector3f & b, const Vector3f & c, const Vector3f & q ) const
+{
+    // doubled signed areas of the triangles formed by the point and each edge
+    auto area = [&]( const Vector3f & p0, const Vector3f & p1 )
+    {
+        return ( double( p1.x ) - p0.x ) * ( double( q.y ) - p0.y ) - ( double( p1.y ) - p0.y ) * ( double( q.x ) - p0.x );
+    };
+    double ea = area( b, c ), eb = area( c, a ), ec = area( a, b );
+    if ( ea + eb + ec < 0 )
+    {
+        ea = -ea;
+        eb = -eb;
+        ec = -ec;
+    }
+    // the point is allowed to be outside of each edge within the distance of the tolerance
+    auto tol = [&]( const Vector3f & p0, const Vector3f & p1 )
+    {
+        return -4.0 * eps_ * ( std::abs( double( p1.x ) - p0.x ) + std::abs( double( p1.y ) - p0.y ) );
+    };
+    return ea >= tol( b, c ) && eb >= tol( c, a ) && ec >= tol( a, b );
+}
+
+MeshIntersectionResult SkyDirectionGrid::intersect( const Vector3f & p, const IntersectionPrecomputes<float> & prec, bool closestIntersect ) const
+{
+    MeshIntersectionResult res;
+    const auto pp = project_( p );
+    if ( pp.x < min_.x || pp.x > max_.x || pp.y < min_.y || pp.y > max_.y )
+        return res;
+
+    const auto c = size_t( cellY_( pp.y ) ) * dims_.x + cellX_( pp.x );
+    const RayOrigin<float> rayOrigin{ p };
+    float rayEnd = FLT_MAX;
+    FaceId faceId;
+    TriPointf triP;
+    for ( int i = cellBegin_[c]; i < cellBegin_[c + 1]; ++i )
+    {
+        const auto & entry = cellEntries_[i];
+        // the triangle is behind the ray origin
+        if ( entry.maxDepth < pp.z - eps_ )
+            continue;
+        const auto f = entry.face;
+        const auto & t = tris_[f];
+        const auto & pa = projs_[t[0]], & pb = projs_[t[1]], & pc = projs_[t[2]];
+        if ( !mayCover_( pa, pb, pc, pp ) )
+            continue;
+
+        // the same tests as for the leaf of AABB tree in rayMeshIntersect
+        const auto & a = mesh_.points[t[0]], & b = mesh_.points[t[1]], & d = mesh_.points[t[2]];
+        Box3f box;
+        box.include( a );
+        box.include( b );
+        box.include( d );
+        float s = 0, e = rayEnd;
+        if ( !rayBoxIntersect( box.insignificantlyExpanded(), rayOrigin, s, e, prec ) )
+            continue;
+        if ( auto triIsect = rayTriangleIntersect( a - p, b - p, d - p, prec ) )
+        {
+            if ( triIsect->t < rayEnd && triIsect->t > 0 )
+            {
+                faceId = f;
+                triP = triIsect->bary;
+                rayEnd = triIsect->t;
+                if ( !closestIntersect )
+                    break;
+            }
+        }
+    }
+
+    if ( faceId )
+    {
+        res.proj.face = faceId;
+        res.proj.point = p + rayEnd * rayDir_;
+        res.mtp = MeshTriPoint( mesh_.topology.edgeWithLeft( faceId ), triP );
+        res.distanceAlongLine = rayEnd;
+    }
+    return res;
+}
+
+} // anonymous namespace
+
 VertScalars computeSkyViewFactor( const Mesh & terrain, const VertCoords & samples, const VertBitSet & validSamples,
     const std::vector<SkyPatch> & skyPatches, BitSet * outSkyRays, std::vector<MeshIntersectionResult>* outIntersections )
 {
@@ -77,29 +282,29 @@ VertScalars computeSkyViewFactor( const Mesh & terrain, const VertCoords & sampl
         return res;
     }
 
-    std::vector<IntersectionPrecomputes<float>> precs;
-    precs.reserve( skyPatches.size() );
-    for ( const auto & sp : skyPatches )
-        precs.emplace_back( sp.dir );
-
     const size_t numRays = samples.size() * skyPatches.size();
     if ( outIntersections )
         outIntersections->resize( numRays );
 
-    BitSetParallelFor( validSamples, [&]( VertId sampleVertId )
+    // all rays in one direction are emitted together, accumulating the radiation of reached patches in the same order as for each sample separately
+    const auto tris = terrain.topology.getTriangulation();
+    const auto box = terrain.computeBoundingBox();
+    for ( int i = 0; i < skyPatches.size(); ++i )
     {
-        const auto samplePt = samples[sampleVertId];
-
-        float totalRadiation = 0;
-        for ( int i = 0; i < skyPatches.size(); ++i )
+        const IntersectionPrecomputes<float> prec( skyPatches[i].dir );
+        const SkyDirectionGrid grid( terrain, tris, box, skyPatches[i].dir );
+        BitSetParallelFor( validSamples, [&]( VertId sampleVertId )
         {
-            const auto intersectionRes = rayMeshIntersect( terrain, Line3f( samplePt, skyPatches[i].dir ), 0, FLT_MAX, &precs[i], bool( outIntersections ));
+            const auto intersectionRes = grid.intersect( samples[sampleVertId], prec, bool( outIntersections ) );
             if ( !intersectionRes )
-                totalRadiation += skyPatches[i].radiation;
+                res[sampleVertId] += skyPatches[i].radiation;
             else if ( outIntersections )
                 (*outIntersections)[ size_t( sampleVertId ) * skyPatches.size() + i ] = intersectionRes;
-        }
-        res[sampleVertId] = rMaxRadiation * totalRadiation;
+        } );
+    }
+    BitSetParallelFor( validSamples, [&]( VertId sampleVertId )
+    {
+        res[sampleVertId] *= rMaxRadiation;
     } );
 
     return res;
@@ -111,31 +316,108 @@ BitSet findSkyRays( const Mesh & terrain,
 {
     MR_TIMER
 
-    std::vector<IntersectionPrecomputes<float>> precs;
-    precs.reserve( skyPatches.size() );
-    for ( const auto & sp : skyPatches )
-        precs.emplace_back( sp.dir );
-
     const size_t numRays = samples.size() * skyPatches.size();
     BitSet res( numRays );
     if ( outIntersections )
         outIntersections->resize( numRays );
 
-    BitSetParallelForAll( res, [&]( size_t ray )
-    {
-        const auto div = std::div( std::int64_t( ray ), std::int64_t( skyPatches.size() ) );
-        const VertId sample( int( div.quot ) );
-        if ( !validSamples.test( sample ) )
-            return;
-        const auto patch = div.rem;
-        const auto intersectionRes = rayMeshIntersect( terrain, Line3f( samples[sample], skyPatches[patch].dir ), 0, FLT_MAX, &precs[patch], false );
-        if ( !intersectionRes )            
-            res.set( ray );
-        else if ( outIntersections )
-            (*outIntersections)[ray] =  intersectionRes;
-    } );
+    const auto tris = terrain.topology.getTriangulation();
+    const auto box = terrain.computeBoundingBox();
+    for ( int i = 0; i < skyPatches.size(); ++i )
+    {
+        const IntersectionPrecomputes<float> prec( skyPatches[i].dir );
+        const SkyDirectionGrid grid( terrain, tris, box, skyPatches[i].dir );
+        // each task processes a block of bits_per_block samples, so their rays occupy separate blocks in the result
+        BitSetParallelFor( validSamples, [&]( VertId sample )
+        {
+            const auto ray = size_t( sample ) * skyPatches.size() + i;
+            const auto intersectionRes = grid.intersect( samples[sample], prec, false );
+            if ( !intersectionRes )
+                res.set( ray );
+            else if ( outIntersections )
+                (*outIntersections)[ray] = intersectionRes;
+        } );
+    }
 
     return res;
 }
 
+TEST( MRMesh, SkyViewFactor )
+{
+    // terrain with hills and valleys
+    const int n = 48;
+    VertCoords points;
+    Triangulation t;
+    for ( int y = 0; y < n; ++y )
+        for ( int x = 0; x < n; ++x )
+        {
+            const float fx = float( x ) / ( n - 1 ), fy = float( y ) / ( n - 1 );
+            points.emplace_back( fx, fy, 0.2f * std::sin( 13 * fx ) * std::cos( 7 * fy ) );
+        }
+    for ( int y = 0; y + 1 < n; ++y )
+        for ( int x = 0; x + 1 < n; ++x )
+        {
+            const VertId v( y * n + x );
+            t.push_back( { v, v + 1, v + n + 1 } );
+            t.push_back( { v, v + n + 1, v + n } );
+        }
+    const auto terrain = Mesh::fromTriangles( std::move( points ), t );
+
+    // samples slightly above the terrain, some of them are not valid
+    VertCoords samples = terrain.points;
+    VertBitSet validSamples( samples.size() );
+    for ( auto v = 0_v; v < samples.size(); ++v )
+    {
+        samples[v].z += 1e-3f;
+        if ( v % 5 != 0 )
+            validSamples.set( v );
+    }
+
+    std::vector<SkyPatch> skyPatches;
+    for ( const auto & dir : sampleHalfSphere() )
+        skyPatches.push_back( { .dir = dir, .radiation = 1 + dir.z } );
+
+    BitSet skyRays;
+    const auto svf = computeSkyViewFactor( terrain, samples, validSamples, skyPatches, &skyRays );
+    std::vector<MeshIntersectionResult> isects;
+    const auto svf1 = computeSkyViewFactor( terrain, samples, validSamples, skyPatches, nullptr, &isects );
+    EXPECT_EQ( skyRays.size(), samples.size() * skyPatches.size() );
+
+    float maxRadiation = 0;
+    for ( const auto & patch : skyPatches )
+        maxRadiation += patch.radiation;
+
+    int numOccluded = 0;
+    for ( auto v = 0_v; v < samples.size(); ++v )
+    {
+        if ( !validSamples.test( v ) )
+        {
+            EXPECT_EQ( svf[v], 0.0f );
+            EXPECT_EQ( svf1[v], 0.0f );
+            for ( size_t i = 0; i < skyPatches.size(); ++i )
+                EXPECT_FALSE( skyRays.test( size_t( v ) * skyPatches.size() + i ) );
+            continue;
+        }
+        float totalRadiation = 0;
+        for ( size_t i = 0; i < skyPatches.size(); ++i )
+        {
+            // each ray is the same as independently emitted one
+            const auto isect = rayMeshIntersect( terrain, Line3f( samples[v], skyPatches[i].dir ) );
+            const bool sky = !isect;
+            EXPECT_EQ( skyRays.test( size_t( v ) * skyPatches.size() + i ), sky );
+            EXPECT_EQ( isects[size_t( v ) * skyPatches.size() + i].distanceAlongLine, isect.distanceAlongLine );
+            if ( sky )
+                totalRadiation += skyPatches[i].radiation;
+            else
+                ++numOccluded;
+        }
+        EXPECT_NEAR( svf[v], totalRadiation / maxRadiation, 1e-6f );
+        EXPECT_EQ( svf[v], svf1[v] );
+    }
+    EXPECT_GT( numOccluded, 0 );
+
+    for ( const auto & patch : skyPatches )
+        EXPECT_GT( patch.dir.z, 0.0f );
+}
+
 } //namespace MR
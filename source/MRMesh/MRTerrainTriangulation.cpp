@@ -1,13 +1,12 @@
 #include "MRTerrainTriangulation.h"
-#include "MRMatrix3.h"
-#include "MRMatrix2.h"
 #include "MRPch/MRTBB.h"
 #include "MRMeshCollidePrecise.h"
 #include "MRTimer.h"
 #include "MRComputeBoundingBox.h"
 #include "MRParallelFor.h"
 #include "MRId.h"
-#include "MR2to3.h"
+#include "MRMapEdge.h"
+#include "MRGTest.h"
 
 namespace MR
 {
@@ -17,48 +16,166 @@ namespace MR
 namespace DivideConquerTriangulation
 {
 
+// Filtered predicates: the result is computed in double-precision if its sign is certain, and in exact arithmetic otherwise, see
+// "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates" by J.R. Shewchuk for the error bounds
+constexpr double cEps = std::numeric_limits<double>::epsilon() / 2;
+constexpr double cCcwErrBound = ( 3 + 16 * cEps ) * cEps;
+constexpr double cInCircleErrBound = ( 10 + 96 * cEps ) * cEps;
+
+// exact sum of up to N doubles without heap allocations, stored as nonoverlapping expansion (Shewchuk's Grow-Expansion)
+template<size_t N>
+class ExactSum
+{
+public:
+    void add( double b )
+    {
+        assert( n_ < N );
+        size_t k = 0;
+        double q = b;
+        for ( size_t i = 0; i < n_; ++i )
+        {
+            // two-sum: q + h_[i] = s + e exactly
+            const double s = q + h_[i];
+            const double bv = s - q;
+            const double e = ( q - ( s - bv ) ) + ( h_[i] - bv );
+            if ( e != 0 )
+                h_[k++] = e;
+            q = s;
+        }
+        if ( q != 0 )
+            h_[k++] = q;
+        n_ = k;
+    }
+    // adds exact product a * b, which requires two doubles
+    void addProduct( double a, double b )
+    {
+        const double p = a * b;
+        add( p );
+        add( std::fma( a, b, -p ) );
+    }
+    // the sign of the sum is the sign of its component with the largest magnitude
+    bool positive() const { return n_ > 0 && h_[n_ - 1] > 0; }
+
+private:
+    std::array<double, N> h_;
+    size_t n_ = 0;
+};
+
+// adds coef * orient(j,k,l) to the sum, where orient is the determinant with the rows (x, y, 1);
+// all products of two floats are exact in double
+template<size_t N>
+void addOrient( ExactSum<N>& sum, double coef, const Vector3f& j, const Vector3f& k, const Vector3f& l )
+{
+    sum.addProduct( coef, double( j.x ) * k.y );
+    sum.addProduct( -coef, double( k.x ) * j.y );
+    sum.addProduct( coef, double( k.x ) * l.y );
+    sum.addProduct( -coef, double( l.x ) * k.y );
+    sum.addProduct( coef, double( l.x ) * j.y );
+    sum.addProduct( -coef, double( j.x ) * l.y );
+}
+
+// returns true if the triangle (a,b,c) is oriented counter-clockwise in XY-plane
+bool ccw( const Vector3f& a, const Vector3f& b, const Vector3f& c )
+{
+    const double detLeft = ( double( b.x ) - a.x ) * ( double( c.y ) - a.y );
+    const double detRight = ( double( b.y ) - a.y ) * ( double( c.x ) - a.x );
+    const double det = detLeft - detRight;
+    if ( std::abs( det ) > cCcwErrBound * ( std::abs( detLeft ) + std::abs( detRight ) ) )
+        return det > 0;
+
+    ExactSum<12> exactDet;
+    addOrient( exactDet, 1.0, a, b, c );
+    return exactDet.positive();
+}
+
+// returns true if the determinant of the matrix with the rows (c-a), (b-a), (d-a) lifted on paraboloid is positive,
+// which means that d is strictly inside the circle passing via a, c, b (in this order counter-clockwise)
+bool inCircle( const Vector3f& a, const Vector3f& b, const Vector3f& c, const Vector3f& d )
+{
+    const double px = double( c.x ) - a.x, py = double( c.y ) - a.y;
+    const double qx = double( b.x ) - a.x, qy = double( b.y ) - a.y;
+    const double rx = double( d.x ) - a.x, ry = double( d.y ) - a.y;
+
+    const double qxry = qx * ry, rxqy = rx * qy;
+    const double rxpy = rx * py, pxry = px * ry;
+    const double pxqy = px * qy, qxpy = qx * py;
+    const double pLift = px * px + py * py;
+    const double qLift = qx * qx + qy * qy;
+    const double rLift = rx * rx + ry * ry;
+
+    const double det = pLift * ( qxry - rxqy ) + qLift * ( rxpy - pxry ) + rLift * ( pxqy - qxpy );
+    const double permanent = ( std::abs( qxry ) + std::abs( rxqy ) ) * pLift
+        + ( std::abs( rxpy ) + std::abs( pxry ) ) * qLift
+        + ( std::abs( pxqy ) + std::abs( qxpy ) ) * rLift;
+    if ( std::abs( det ) > cInCircleErrBound * permanent )
+        return det > 0;
+
+    // the same determinant is equal to 4x4 determinant with the rows c, b, d, a lifted on paraboloid and extended by 1,
+    // which is expanded here along the lifted column without any subtractions of input coordinates;
+    // each lifted value x*x + y*y is represented by two exact doubles, so the sum consists of 4 * 2 * 6 exact products
+    ExactSum<96> exactDet;
+    const auto addLifted = [&] ( double sign, const Vector3f& p, const Vector3f& j, const Vector3f& k, const Vector3f& l )
+    {
+        addOrient( exactDet, sign * ( double( p.x ) * p.x ), j, k, l );
+        addOrient( exactDet, sign * ( double( p.y ) * p.y ), j, k, l );
+    };
+    addLifted( 1, c, b, d, a );
+    addLifted( -1, b, c, d, a );
+    addLifted( 1, d, c, b, a );
+    addLifted( -1, a, c, b, d );
+    return exactDet.positive();
+}
+
 class Triangulator
 {
 public:
+    struct OutEdges
+    {
+        // has hole to the right
+        EdgeId leftMost;
+        // has hole to the left
+        EdgeId rightMost;
+    };
+
     Triangulator( std::vector<Vector3f>&& points, ProgressCallback cb ):
         cb_{ cb }
     {
         mesh_.points.vec_ = std::move( points );
         mesh_.topology.vertResize( mesh_.points.size() );
     }
+    // takes the mesh with already triangulated parts to merge them
+    explicit Triangulator( Mesh&& mesh ) : mesh_( std::move( mesh ) ) {}
     bool isCanceled() const
     {
         return canceled_;
     }
     Mesh run()
     {
-        seqDelaunay_( 0_v, VertId( mesh_.points.size() ) );
+        triangulate();
         return std::move( mesh_ );
     }
+    // triangulates all points and returns the boundary edges starting in the leftmost and the rightmost points
+    OutEdges triangulate()
+    {
+        return seqDelaunay_( 0_v, VertId( mesh_.points.size() ) );
+    }
+    // merges two triangulations in the mesh, all points of left one must precede all points of right one
+    OutEdges merge( const OutEdges& left, const OutEdges& right )
+    {
+        return nodeDelaunay_( left, right );
+    }
+    Mesh& mesh()
+    {
+        return mesh_;
+    }
 private:
     Mesh mesh_;
     EdgeId basel_;
     ProgressCallback cb_;
     bool canceled_{ false };
 
-    bool inCircle_( const Vector3f& af, Vector3f bf, Vector3f cf, Vector3f df ) const
-    {
-        Vector3d b = Vector3d( bf ) - Vector3d( af );
-        Vector3d c = Vector3d( cf ) - Vector3d( af );
-        Vector3d d = Vector3d( df ) - Vector3d( af );
-        return Matrix3d(
-            Vector3d( c.x, c.y, double( c.x ) * c.x + double( c.y ) * c.y ),
-            Vector3d( b.x, b.y, double( b.x ) * b.x + double( b.y ) * b.y ),
-            Vector3d( d.x, d.y, double( d.x ) * d.x + double( d.y ) * d.y )
-        ).det() > 0;
-    }
-
-    bool ccw_( const Vector3f& af, Vector3f bf, Vector3f cf ) const
-    {
-        Vector3d b = Vector3d( bf ) - Vector3d( af );
-        Vector3d c = Vector3d( cf ) - Vector3d( af );
-        return Matrix2d( to2dim( b ), to2dim( c ) ).det() > 0;
-    }
+    bool inCircle_( const Vector3f& a, const Vector3f& b, const Vector3f& c, const Vector3f& d ) const { return inCircle( a, b, c, d ); }
+    bool ccw_( const Vector3f& a, const Vector3f& b, const Vector3f& c ) const { return ccw( a, b, c ); }
 
     bool leftOf_( const Vector3f& x, EdgeId e ) const { return ccw_( x, mesh_.orgPnt( e ), mesh_.destPnt( e ) ); }
     bool rightOf_( const Vector3f& x, EdgeId e ) const { return ccw_( x, mesh_.destPnt( e ), mesh_.orgPnt( e ) ); }
@@ -84,14 +201,6 @@ private:
         tp.splice( tp.prev( e.sym() ), e.sym() );
     }
 
-    struct OutEdges
-    {
-        // has hole to the right
-        EdgeId leftMost;
-        // has hole to the left
-        EdgeId rightMost;
-    };
-
     OutEdges leafDelaunay_( VertId begin, VertId end )
     {
         auto size = end - begin;
@@ -295,26 +404,67 @@ private:
         assert( false );
         return {};
     }
-
-    //OutEdges parDelaunay_( VertId begin, VertId end )
-    //{
-    //    return tbb::parallel_deterministic_reduce( tbb::blocked_range<VertId>( begin, end, 4 ), OutEdges{},
-    //        [&] ( const auto& range, OutEdges curr )
-    //    {
-    //        //assert( range.size() >= 2 && range.size() < 4 );
-    //        if ( range.size() > 3 )
-    //            curr = recDelaunay_( range.begin(), range.end() );
-    //        else
-    //            curr = leafDelaunay_( range.begin(), range.end() );
-    //        return curr;
-    //    },
-    //        [this] ( auto a, auto b )
-    //    {
-    //        return nodeDelaunay_( a, b );
-    //    } );
-    //}
 };
 
+// minimal number of points in one part triangulated independently from other parts
+constexpr size_t cMinPointsInPart = 1 << 16;
+// maximal number of parts, the top levels of merging parts are sequential
+constexpr int cMaxParts = 256;
+
+// returns the number of parts (power of two) to triangulate in parallel given number of points;
+// it does not depend on the number of threads to produce the same triangulation on any hardware
+int getNumParts( size_t numPoints )
+{
+    int res = 1;
+    while ( res < cMaxParts && numPoints / ( 2 * res ) >= cMinPointsInPart )
+        res *= 2;
+    return res;
+}
+
+// triangulates consecutive parts of sorted points in parallel, then stitches and merges the triangulations
+Expected<Mesh> parallelTriangulation( std::vector<Vector3f>&& points, int numParts, ProgressCallback cb )
+{
+    MR_TIMER
+    using OutEdges = Triangulator::OutEdges;
+    const auto n = points.size();
+    std::vector<Mesh> parts( numParts );
+    std::vector<OutEdges> outs( numParts );
+    if ( !ParallelFor( 0, numParts, [&] ( int i )
+    {
+        Triangulator t( std::vector<Vector3f>( points.begin() + n * i / numParts, points.begin() + n * ( i + 1 ) / numParts ), {} );
+        outs[i] = t.triangulate();
+        parts[i] = std::move( t.mesh() );
+    }, subprogress( cb, 0.0f, 0.7f ), 1 ) )
+        return unexpectedOperationCanceled();
+    points = {};
+
+    Mesh mesh;
+    for ( int i = 0; i < numParts; ++i )
+    {
+        VertMap vmap;
+        WholeEdgeMap emap;
+        mesh.topology.addPart( parts[i].topology, nullptr, &vmap, &emap );
+        mesh.points.resize( mesh.topology.vertSize() );
+        for ( VertId v( 0 ); v < vmap.size(); ++v )
+            if ( vmap[v] )
+                mesh.points[vmap[v]] = parts[i].points[v];
+        outs[i] = { mapEdge( emap, outs[i].leftMost ), mapEdge( emap, outs[i].rightMost ) };
+        parts[i] = {};
+    }
+    if ( !reportProgress( cb, 0.8f ) )
+        return unexpectedOperationCanceled();
+
+    Triangulator merger( std::move( mesh ) );
+    for ( int step = 1; step < numParts; step *= 2 )
+    {
+        for ( int i = 0; i + step < numParts; i += 2 * step )
+            outs[i] = merger.merge( outs[i], outs[i + step] );
+        if ( !reportProgress( cb, 0.8f + 0.2f * float( 2 * step ) / numParts ) )
+            return unexpectedOperationCanceled();
+    }
+    return std::move( merger.mesh() );
+}
+
 }
 
 Expected<Mesh> terrainTriangulation( std::vector<Vector3f> points, ProgressCallback cb /*= {} */ )
@@ -337,6 +487,10 @@ Expected<Mesh> terrainTriangulation( std::vector<Vector3f> points, ProgressCallb
     if ( cb && !cb( 0.2f ) )
         return unexpectedOperationCanceled();
 
+    const auto numParts = DivideConquerTriangulation::getNumParts( points.size() );
+    if ( numParts > 1 )
+        return DivideConquerTriangulation::parallelTriangulation( std::move( points ), numParts, subprogress( cb, 0.2f, 1.0f ) );
+
     DivideConquerTriangulation::Triangulator t( std::move( points ), subprogress( cb, 0.2f, 1.0f ) );
     auto res = t.run();
     if ( t.isCanceled() )
@@ -345,4 +499,45 @@ Expected<Mesh> terrainTriangulation( std::vector<Vector3f> points, ProgressCallb
     return res;
 }
 
-}
\ No newline at end of file
+TEST( MRMesh, TerrainTriangulationPredicates )
+{
+    using namespace DivideConquerTriangulation;
+    // far from the origin, where the differences of coordinates are not exact in float
+    const float x0 = 1e6f, y0 = -3e5f, s = 0.25f;
+    const Vector3f a( x0, y0, 0 ), b( x0 + s, y0, 0 ), c( x0 + s, y0 + s, 0 ), d( x0, y0 + s, 0 );
+    EXPECT_TRUE( ccw( a, b, c ) );
+    EXPECT_FALSE( ccw( a, c, b ) );
+    EXPECT_FALSE( ccw( a, b, Vector3f( x0 + 2 * s, y0, 0 ) ) );
+
+    // four cocircular points: none is strictly inside the circle of the others
+    EXPECT_FALSE( inCircle( a, b, c, d ) );
+    EXPECT_FALSE( inCircle( a, c, b, d ) );
+    // the smallest shifts of the fourth point inside and outside the circle
+    EXPECT_TRUE( inCircle( a, b, c, Vector3f( std::nextafter( d.x, d.x + 1 ), d.y, 0 ) ) );
+    EXPECT_FALSE( inCircle( a, b, c, Vector3f( std::nextafter( d.x, d.x - 1 ), d.y, 0 ) ) );
+}
+
+TEST( MRMesh, TerrainTriangulation )
+{
+    // regular grid has all its points cocircular by four, and the number of points is enough for triangulation by several parts
+    const int n = 400;
+    std::vector<Vector3f> points;
+    points.reserve( n * n );
+    for ( int y = 0; y < n; ++y )
+        for ( int x = 0; x < n; ++x )
+            points.emplace_back( float( x ), float( y ), float( ( x * y ) % 7 ) );
+
+    auto mesh = terrainTriangulation( points );
+    ASSERT_TRUE( mesh.has_value() );
+    EXPECT_EQ( mesh->topology.numValidVerts(), n * n );
+    EXPECT_EQ( mesh->topology.numValidFaces(), 2 * ( n - 1 ) * ( n - 1 ) );
+    EXPECT_EQ( mesh->topology.findHoleRepresentiveEdges().size(), 1 );
+    for ( auto f : mesh->topology.getValidFaces() )
+    {
+        VertId a, b, c;
+        mesh->topology.getTriVerts( f, a, b, c );
+        EXPECT_TRUE( DivideConquerTriangulation::ccw( mesh->points[a], mesh->points[b], mesh->points[c] ) );
+    }
+}
+
+}
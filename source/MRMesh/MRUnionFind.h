@@ -17,6 +17,16 @@ class UnionFind
 public:
     UnionFind() = default;
     explicit UnionFind( size_t size ) { reset( size ); }
+
+    /// creates the structure from given parents of all elements (e.g. computed by ConcurrentUnionFind),
+    /// and computes the sizes of all sets
+    explicit UnionFind( Vector<I, I> parents ) : roots_( std::move( parents ) )
+    {
+        sizes_.resize( roots_.size(), 0 );
+        for ( I i{ size_t( 0 ) }; i < roots_.size(); ++i )
+            ++sizes_[ updateRoot_( i ) ];
+    }
+
     auto size() const { return roots_.size(); }
 
     /// reset roots to represent each element as disjoint set of rank 0
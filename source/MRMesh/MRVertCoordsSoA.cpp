@@ -0,0 +1,273 @@
+#include "MRVertCoordsSoA.h"
+#include "MRAffineXf3.h"
+#include "MRBitSet.h"
+#include "MRVector.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRComputeBoundingBox.h"
+#include "MRTorus.h"
+#include "MRMesh.h"
+#include "MRGTest.h"
+#include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <chrono>
+
+// on x86 with GCC or Clang the kernels are compiled twice: for the baseline instruction set and for AVX2+FMA,
+// and the best version is selected at runtime; other compilers and platforms (e.g. NEON on ARM64) use the baseline only
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) && !defined( __EMSCRIPTEN__ )
+#define MR_SOA_AVX2_DISPATCH
+#define MR_SOA_INLINE __attribute__(( always_inline )) inline
+#else
+#define MR_SOA_INLINE inline
+#endif
+
+namespace MR
+{
+
+namespace
+{
+
+// the number of points processed by one task, all arrays of a block fit in L1 cache
+constexpr size_t BlockSize = 1024;
+
+// the number of independent accumulators in reductions, which compilers map on SIMD registers
+constexpr int Lanes = 8;
+
+size_t numBlocks( size_t n )
+{
+    return ( n + BlockSize - 1 ) / BlockSize;
+}
+
+MR_SOA_INLINE void transformBlock( float * x, float * y, float * z, size_t n, const AffineXf3f & xf )
+{
+    const float a00 = xf.A.x.x, a01 = xf.A.x.y, a02 = xf.A.x.z;
+    const float a10 = xf.A.y.x, a11 = xf.A.y.y, a12 = xf.A.y.z;
+    const float a20 = xf.A.z.x, a21 = xf.A.z.y, a22 = xf.A.z.z;
+    const float b0 = xf.b.x, b1 = xf.b.y, b2 = xf.b.z;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        const float px = x[i], py = y[i], pz = z[i];
+        x[i] = a00 * px + a01 * py + a02 * pz + b0;
+        y[i] = a10 * px + a11 * py + a12 * pz + b1;
+        z[i] = a20 * px + a21 * py + a22 * pz + b2;
+    }
+}
+
+MR_SOA_INLINE Box3f boxBlock( const float * x, const float * y, const float * z, size_t n )
+{
+    float mnx[Lanes], mny[Lanes], mnz[Lanes], mxx[Lanes], mxy[Lanes], mxz[Lanes];
+    for ( int j = 0; j < Lanes; ++j )
+    {
+        mnx[j] = mny[j] = mnz[j] = FLT_MAX;
+        mxx[j] = mxy[j] = mxz[j] = -FLT_MAX;
+    }
+    size_t i = 0;
+    for ( ; i + Lanes <= n; i += Lanes )
+    {
+        for ( int j = 0; j < Lanes; ++j )
+        {
+            mnx[j] = std::min( mnx[j], x[i + j] );
+            mny[j] = std::min( mny[j], y[i + j] );
+            mnz[j] = std::min( mnz[j], z[i + j] );
+            mxx[j] = std::max( mxx[j], x[i + j] );
+            mxy[j] = std::max( mxy[j], y[i + j] );
+            mxz[j] = std::max( mxz[j], z[i + j] );
+        }
+    }
+    Box3f res;
+    for ( ; i < n; ++i )
+        res.include( Vector3f{ x[i], y[i], z[i] } );
+    for ( int j = 0; j < Lanes; ++j )
+    {
+        res.min.x = std::min( res.min.x, mnx[j] );
+        res.min.y = std::min( res.min.y, mny[j] );
+        res.min.z = std::min( res.min.z, mnz[j] );
+        res.max.x = std::max( res.max.x, mxx[j] );
+        res.max.y = std::max( res.max.y, mxy[j] );
+        res.max.z = std::max( res.max.z, mxz[j] );
+    }
+    return res;
+}
+
+struct Kernels
+{
+    const char * isa = nullptr;
+    void ( *transform )( float *, float *, float *, size_t, const AffineXf3f & ) = nullptr;
+    Box3f ( *box )( const float *, const float *, const float *, size_t ) = nullptr;
+};
+
+void transformBlockBase( float * x, float * y, float * z, size_t n, const AffineXf3f & xf ) { transformBlock( x, y, z, n, xf ); }
+Box3f boxBlockBase( const float * x, const float * y, const float * z, size_t n ) { return boxBlock( x, y, z, n ); }
+
+#ifdef MR_SOA_AVX2_DISPATCH
+__attribute__(( target( "avx2,fma" ) )) void transformBlockAvx2( float * x, float * y, float * z, size_t n, const AffineXf3f & xf ) { transformBlock( x, y, z, n, xf ); }
+__attribute__(( target( "avx2,fma" ) )) Box3f boxBlockAvx2( const float * x, const float * y, const float * z, size_t n ) { return boxBlock( x, y, z, n ); }
+#endif
+
+const Kernels & kernels()
+{
+    static const Kernels res = []
+    {
+#ifdef MR_SOA_AVX2_DISPATCH
+        if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+            return Kernels{ "AVX2", transformBlockAvx2, boxBlockAvx2 };
+#endif
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+        const char * isa = "NEON";
+#else
+        const char * isa = "SSE2";
+#endif
+        return Kernels{ isa, transformBlockBase, boxBlockBase };
+    }();
+    return res;
+}
+
+} // anonymous namespace
+
+const char * getSoAKernelsIsa()
+{
+    return kernels().isa;
+}
+
+VertCoordsSoA toSoA( const VertCoords & points )
+{
+    MR_TIMER
+    VertCoordsSoA res;
+    res.resize( points.size() );
+    ParallelFor( points, [&]( VertId v )
+    {
+        res.set( v, points[v] );
+    } );
+    return res;
+}
+
+void fromSoA( const VertCoordsSoA & soa, VertCoords & points )
+{
+    MR_TIMER
+    points.resizeNoInit( soa.size() );
+    ParallelFor( points, [&]( VertId v )
+    {
+        points[v] = soa[v];
+    } );
+}
+
+void transformPoints( VertCoordsSoA & points, const AffineXf3f & xf )
+{
+    MR_TIMER
+    const auto transform = kernels().transform;
+    ParallelFor( size_t( 0 ), numBlocks( points.size() ), [&]( size_t b )
+    {
+        const size_t begin = b * BlockSize;
+        const size_t n = std::min( BlockSize, points.size() - begin );
+        transform( points.x.data() + begin, points.y.data() + begin, points.z.data() + begin, n, xf );
+    } );
+}
+
+Box3f computeBoundingBox( const VertCoordsSoA & points, const VertBitSet * region )
+{
+    MR_TIMER
+    const auto box = kernels().box;
+    return tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, numBlocks( points.size() ), 1 ), Box3f{},
+        [&]( const tbb::blocked_range<size_t> & range, Box3f curr )
+        {
+            for ( size_t b = range.begin(); b < range.end(); ++b )
+            {
+                const size_t begin = b * BlockSize;
+                const size_t n = std::min( BlockSize, points.size() - begin );
+                if ( !region )
+                {
+                    curr.include( box( points.x.data() + begin, points.y.data() + begin, points.z.data() + begin, n ) );
+                    continue;
+                }
+                for ( size_t i = begin; i < begin + n; ++i )
+                    if ( region->test( VertId( i ) ) )
+                        curr.include( points[VertId( i )] );
+            }
+            return curr;
+        },
+        [] ( Box3f a, const Box3f & b )
+        {
+            a.include( b );
+            return a;
+        } );
+}
+
+TEST( MRMesh, VertCoordsSoA )
+{
+    auto mesh = makeTorus( 1.0f, 0.3f, 64, 32 );
+    auto soa = toSoA( mesh.points );
+    EXPECT_EQ( soa.size(), mesh.points.size() );
+
+    const auto xf = AffineXf3f::xfAround( Matrix3f::rotation( Vector3f( 1, 2, 3 ).normalized(), 0.7f ), Vector3f( 1, -1, 2 ) );
+    transformPoints( soa, xf );
+    mesh.transform( xf );
+    for ( auto v : mesh.topology.getValidVerts() )
+        EXPECT_NEAR( ( soa[v] - mesh.points[v] ).length(), 0.0f, 1e-5f );
+
+    const auto box = computeBoundingBox( soa );
+    const auto refBox = computeBoundingBox( mesh.points );
+    EXPECT_NEAR( ( box.min - refBox.min ).length(), 0.0f, 1e-5f );
+    EXPECT_NEAR( ( box.max - refBox.max ).length(), 0.0f, 1e-5f );
+
+    VertBitSet region( mesh.points.size() );
+    region.set( 5_v );
+    region.set( 7_v );
+    const auto regionBox = computeBoundingBox( soa, &region );
+    const auto refRegionBox = computeBoundingBox( mesh.points, region );
+    EXPECT_NEAR( ( regionBox.min - refRegionBox.min ).length(), 0.0f, 1e-5f );
+    EXPECT_NEAR( ( regionBox.max - refRegionBox.max ).length(), 0.0f, 1e-5f );
+
+    VertCoords back;
+    fromSoA( soa, back );
+    EXPECT_EQ( back.size(), soa.size() );
+    for ( auto v : mesh.topology.getValidVerts() )
+        EXPECT_EQ( back[v], soa[v] );
+}
+
+// measures the speed of SoA kernels in comparison with the same operations on VertCoords on 10M points in one thread,
+// run it with --gtest_also_run_disabled_tests
+TEST( MRMesh, DISABLED_VertCoordsSoABenchmark )
+{
+    constexpr size_t n = 10'000'000;
+    VertCoords points;
+    points.resizeNoInit( n );
+    ParallelFor( points, [&]( VertId v )
+    {
+        // deterministic pseudo-random coordinates in [-1, 1]
+        auto rnd = [i = std::uint32_t( v ) * 2654435761u] ( int k ) mutable
+        {
+            i ^= i >> 15; i *= 0x2c1b3c6du; i ^= i >> 12; i += k * 0x297a2d39u;
+            return float( i ) / float( UINT32_MAX ) * 2 - 1;
+        };
+        points[v] = Vector3f( rnd( 1 ), rnd( 2 ), rnd( 3 ) );
+    } );
+    auto soa = toSoA( points );
+    const auto xf = AffineXf3f::xfAround( Matrix3f::rotation( Vector3f( 1, 2, 3 ).normalized(), 0.7f ), Vector3f( 1, -1, 2 ) );
+
+    auto measureMs = [] ( auto && f )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    };
+    double aosTransformMs = 0, soaTransformMs = 0, aosBoxMs = 0, soaBoxMs = 0;
+    Box3f aosBox, soaBox;
+    tbb::task_arena arena( 1 );
+    arena.execute( [&]
+    {
+        aosTransformMs = measureMs( [&] { ParallelFor( points, [&]( VertId v ) { points[v] = xf( points[v] ); } ); } );
+        soaTransformMs = measureMs( [&] { transformPoints( soa, xf ); } );
+        aosBoxMs = measureMs( [&] { aosBox = computeBoundingBox( points ); } );
+        soaBoxMs = measureMs( [&] { soaBox = computeBoundingBox( soa ); } );
+    } );
+    spdlog::info( "SoA kernels ({}) on {} points: transform {:.1f} ms (VertCoords {:.1f} ms), bounding box {:.1f} ms (VertCoords {:.1f} ms)",
+        getSoAKernelsIsa(), n, soaTransformMs, aosTransformMs, soaBoxMs, aosBoxMs );
+
+    for ( VertId v( 0 ); v < n; v += 9973 )
+        EXPECT_NEAR( ( soa[v] - points[v] ).length(), 0.0f, 1e-5f );
+    EXPECT_NEAR( ( soaBox.min - aosBox.min ).length(), 0.0f, 1e-5f );
+    EXPECT_NEAR( ( soaBox.max - aosBox.max ).length(), 0.0f, 1e-5f );
+}
+
+} //namespace MR
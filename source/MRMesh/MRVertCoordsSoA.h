@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRId.h"
+#include "MRVector3.h"
+#include "MRBox.h"
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup MathGroup
+/// \{
+
+/// coordinates of points stored as structure of arrays: separate contiguous arrays of x, y and z;
+/// contrary to VertCoords, bulk kernels over such storage process several points by one SIMD instruction
+struct VertCoordsSoA
+{
+    std::vector<float> x, y, z;
+
+    [[nodiscard]] size_t size() const { return x.size(); }
+    void resize( size_t n ) { x.resize( n ); y.resize( n ); z.resize( n ); }
+
+    [[nodiscard]] Vector3f operator[]( VertId v ) const { return { x[v], y[v], z[v] }; }
+    void set( VertId v, const Vector3f & p ) { x[v] = p.x; y[v] = p.y; z[v] = p.z; }
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] size_t heapBytes() const { return ( x.capacity() + y.capacity() + z.capacity() ) * sizeof( float ); }
+};
+
+/// returns the name of instruction set selected at runtime for the kernels below, e.g. "AVX2"
+[[nodiscard]] MRMESH_API const char * getSoAKernelsIsa();
+
+/// converts given points in structure of arrays
+[[nodiscard]] MRMESH_API VertCoordsSoA toSoA( const VertCoords & points );
+
+/// copies points from structure of arrays in ordinary vector, which is resized appropriately
+MRMESH_API void fromSoA( const VertCoordsSoA & soa, VertCoords & points );
+
+/// applies given transformation to all points
+MRMESH_API void transformPoints( VertCoordsSoA & points, const AffineXf3f & xf );
+
+/// finds the minimal bounding box containing all points corresponding to set bits in region (if provided)
+[[nodiscard]] MRMESH_API Box3f computeBoundingBox( const VertCoordsSoA & points, const VertBitSet * region = nullptr );
+
+/// \}
+
+} // namespace MR
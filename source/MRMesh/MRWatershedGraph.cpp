@@ -38,8 +38,6 @@ WatershedGraph::WatershedGraph( const Mesh & mesh, const Vector<int, FaceId> & f
     basins_.clear();
     bds_.clear();
 
-    Vector<BasinVolumeCalculator, Graph::VertId> volumeCalcs( numBasins );
-
     outsideId_ = Graph::VertId( numBasins );
     ++numBasins;
     basins_.resize( numBasins );
@@ -48,6 +46,9 @@ WatershedGraph::WatershedGraph( const Mesh & mesh, const Vector<int, FaceId> & f
     parentBasin_.reserve( numBasins );
     for ( Graph::VertId v( 0 ); v < numBasins; ++v )
         parentBasin_.push_back( v );
+    root2basin_ = parentBasin_;
+    treeSize_.clear();
+    treeSize_.resize( numBasins, 1 );
     Graph::EndsPerEdge endsPerEdge;
 
     HashMap<Graph::EndVertices, Graph::EdgeId> neiBasins2edge;
@@ -121,21 +122,44 @@ WatershedGraph::WatershedGraph( const Mesh & mesh, const Vector<int, FaceId> & f
         }
     }
 
+    // sort faces by initial basins preserving their order within each basin
+    iniBasinFacesBegin_.clear();
+    iniBasinFacesBegin_.resize( size_t( numBasins ) + 1, 0 );
     for ( auto f : mesh_.topology.getValidFaces() )
+        ++iniBasinFacesBegin_[Graph::VertId( face2basin[f] + 1 )];
+    for ( auto basin = Graph::VertId( 0 ); basin < numBasins; ++basin )
+        iniBasinFacesBegin_[basin + 1] += iniBasinFacesBegin_[basin];
+    iniBasinFaces_.resize( iniBasinFacesBegin_.back() );
     {
-        const auto basin = Graph::VertId( face2basin[f] );
-        auto & info = basins_[basin];
-        info.area += 0.5f * mesh_.dirDblArea( f ).z;
-        volumeCalcs[basin].addTerrainTri( mesh_.getTriPoints( f ), info.lowestBdLevel );
+        auto pos = iniBasinFacesBegin_;
+        for ( auto f : mesh_.topology.getValidFaces() )
+            iniBasinFaces_[pos[Graph::VertId( face2basin[f] )]++] = f;
     }
 
+    nextMember_.clear();
+    nextMember_.reserve( numBasins );
+    for ( Graph::VertId v( 0 ); v < numBasins; ++v )
+        nextMember_.push_back( v );
+
+    ParallelFor( Graph::VertId( 0 ), outsideId_, [&]( Graph::VertId basin )
+    {
+        auto & info = basins_[basin];
+        BasinVolumeCalculator volumeCalc;
+        for ( auto i = iniBasinFacesBegin_[basin]; i < iniBasinFacesBegin_[basin + 1]; ++i )
+        {
+            const auto f = iniBasinFaces_[i];
+            info.area += 0.5f * mesh_.dirDblArea( f ).z;
+            volumeCalc.addTerrainTri( mesh_.getTriPoints( f ), info.lowestBdLevel );
+        }
+        info.maxVolume = (float)volumeCalc.getVolume();
+    } );
+
     totalArea_ = 0;
     for ( auto basin = Graph::VertId( 0 ); basin < outsideId_; ++basin )
     {
         auto & info = basins_[basin];
         assert( info.lowestLevel == getHeightAt( info.lowestVert ) );
         assert( info.lowestLevel <= info.lowestBdLevel );
-        info.maxVolume = (float)volumeCalcs[basin].getVolume();
         info.lastMergeLevel = info.lowestLevel;
         totalArea_ += info.area;
     }
@@ -148,7 +172,7 @@ float WatershedGraph::getHeightAt( VertId v ) const
     return getAt( mesh_.points, v, { 0.f, 0.f, FLT_MAX } ).z;
 }
 
-Graph::VertId WatershedGraph::getRootBasin( Graph::VertId v ) const
+Graph::VertId WatershedGraph::treeRoot_( Graph::VertId v ) const
 {
     assert( v );
     for (;;)
@@ -160,6 +184,11 @@ Graph::VertId WatershedGraph::getRootBasin( Graph::VertId v ) const
     }
 }
 
+Graph::VertId WatershedGraph::getRootBasin( Graph::VertId v ) const
+{
+    return root2basin_[treeRoot_( v )];
+}
+
 Graph::VertId WatershedGraph::flowsTo( Graph::VertId v ) const
 {
     assert( v );
@@ -186,10 +215,12 @@ Graph::VertId WatershedGraph::flowsFinallyTo( Graph::VertId v, bool exceptOutsid
 void WatershedGraph::setParentsToRoots()
 {
     MR_TIMER
-    ParallelFor( parentBasin_, [&]( Graph::VertId v )
+    Vector<Graph::VertId, Graph::VertId> roots( parentBasin_.size() );
+    ParallelFor( roots, [&]( Graph::VertId v )
     {
-        parentBasin_[v] = getRootBasin( v );
+        roots[v] = treeRoot_( v );
     } );
+    parentBasin_ = std::move( roots );
 }
 
 MRMESH_API std::pair<Graph::EdgeId, float> WatershedGraph::findLowestBd() const
@@ -225,8 +256,18 @@ Graph::VertId WatershedGraph::merge( Graph::VertId v0, Graph::VertId v1 )
     if ( v0 == v1 )
         return v0;
 
-    assert( parentBasin_[v1] == v1 );
-    parentBasin_[v1] = v0;
+    assert( getRootBasin( v1 ) == v1 );
+    // union by size: the smaller tree of initial basins is attached to the root of the larger one,
+    // and the root of merged tree represents v0
+    auto r0 = treeRoot_( v0 );
+    auto r1 = treeRoot_( v1 );
+    if ( treeSize_[r0] < treeSize_[r1] )
+        std::swap( r0, r1 );
+    parentBasin_[r1] = r0;
+    treeSize_[r0] += treeSize_[r1];
+    root2basin_[r0] = v0;
+    // join two circular lists of initial basins
+    std::swap( nextMember_[v0], nextMember_[v1] );
 
     auto & info0 = basins_[v0];
     auto & info1 = basins_[v1];
@@ -244,6 +285,10 @@ Graph::VertId WatershedGraph::merge( Graph::VertId v0, Graph::VertId v1 )
     {
         if ( getHeightAt( bds_[edead].lowestVert ) < getHeightAt( bds_[eremnant].lowestVert ) )
             bds_[eremnant].lowestVert = bds_[edead].lowestVert;
+        // the common neighbor, which overflowed via dead edge, now overflows via the remnant edge in merged basin
+        auto & neiInfo = basins_[graph_.ends( eremnant ).otherEnd( v0 )];
+        if ( neiInfo.overflowVia == edead )
+            neiInfo.overflowVia = eremnant;
     } );
 
     info0.lastMergeLevel = info0.lowestBdLevel;
@@ -274,7 +319,7 @@ FaceBitSet WatershedGraph::getBasinFaces( Graph::VertId basin ) const
         return res;
     res.resize( mesh_.topology.faceSize() );
     assert( graph_.valid( basin ) );
-    assert( basin == parentBasin_[basin] );
+    assert( basin == getRootBasin( basin ) );
     BitSetParallelFor( mesh_.topology.getValidFaces(), [&]( FaceId f )
     {
         if ( basin == getRootBasin( Graph::VertId( face2iniBasin_[f] ) ) )
@@ -330,7 +375,7 @@ FaceBitSet WatershedGraph::getBasinFacesBelowLevel( Graph::VertId basin, float w
         return res;
     res.resize( mesh_.topology.faceSize() );
     assert( graph_.valid( basin ) );
-    assert( basin == parentBasin_[basin] );
+    assert( basin == getRootBasin( basin ) );
     BitSetParallelFor( mesh_.topology.getValidFaces(), [&]( FaceId f )
     {
         if ( basin != getRootBasin( Graph::VertId( face2iniBasin_[f] ) ) )
@@ -349,7 +394,34 @@ FaceBitSet WatershedGraph::getBasinFacesBelowLevel( Graph::VertId basin, float w
 
 double WatershedGraph::computeBasinVolume( Graph::VertId basin, float waterLevel ) const
 {
-    return MR::computeBasinVolume( mesh_, getBasinFacesBelowLevel( basin, waterLevel ), waterLevel );
+    MR_TIMER
+    if ( basin == outsideId_ )
+        return 0;
+    assert( graph_.valid( basin ) );
+    assert( basin == getRootBasin( basin ) );
+
+    std::vector<Graph::VertId> members;
+    for ( auto m = basin;; )
+    {
+        members.push_back( m );
+        m = nextMember_[m];
+        if ( m == basin )
+            break;
+    }
+
+    return tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, members.size() ), 0.0,
+        [&]( const tbb::blocked_range<size_t> & range, double curr )
+        {
+            BasinVolumeCalculator calc;
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+            {
+                const auto m = members[i];
+                for ( auto j = iniBasinFacesBegin_[m]; j < iniBasinFacesBegin_[m + 1]; ++j )
+                    calc.addTerrainTri( mesh_.getTriPoints( iniBasinFaces_[j] ), waterLevel );
+            }
+            return curr + calc.getVolume();
+        },
+        std::plus<double>() );
 }
 
 UndirectedEdgeBitSet WatershedGraph::getInterBasinEdges( bool joinOverflowBasins ) const
@@ -103,7 +103,7 @@ public:
     /// \param exceptOutside if true then the method returns the basin that receives water flow from (v) just before outside
     [[nodiscard]] MRMESH_API Graph::VertId flowsFinallyTo( Graph::VertId v, bool exceptOutside = false ) const;
 
-    /// replaces parent of each basin with its computed root;
+    /// replaces parent of each initial basin in union-find forest with the root of its tree;
     /// this speeds up following calls to getRootBasin()
     MRMESH_API void setParentsToRoots();
 
@@ -128,7 +128,8 @@ public:
     [[nodiscard]] MRMESH_API FaceBitSet getBasinFacesBelowLevel( Graph::VertId basin, float waterLevel ) const;
 
     /// returns water volume in basin when its surface reaches given level, which must be in between
-    /// the lowest basin level and the lowest level on basin's boundary
+    /// the lowest basin level and the lowest level on basin's boundary;
+    /// only the faces of given basin are visited, and they are processed in parallel
     [[nodiscard]] MRMESH_API double computeBasinVolume( Graph::VertId basin, float waterLevel ) const;
 
     /// returns the mesh edges between current basins
@@ -162,8 +163,25 @@ private:
     /// special "basin" representing outside areas of the mesh
     Graph::VertId outsideId_;
 
-    /// for valid basin, parent is the same; for invalid basin, sequence of parents point on valid root basin
+    /// returns the root of union-find tree containing given initial basin
+    [[nodiscard]] Graph::VertId treeRoot_( Graph::VertId v ) const;
+
+    /// union-find forest of initial basins: the parent of each initial basin, the roots are parents of themselves;
+    /// the trees are united by size, so their depth is logarithmic in the number of initial basins
     Vector<Graph::VertId, Graph::VertId> parentBasin_;
+
+    /// the number of initial basins in the tree of each root
+    Vector<int, Graph::VertId> treeSize_;
+
+    /// the valid basin formed by the initial basins in the tree of each root
+    Vector<Graph::VertId, Graph::VertId> root2basin_;
+
+    /// the faces of each initial basin b are iniBasinFaces_[iniBasinFacesBegin_[b], iniBasinFacesBegin_[b+1])
+    std::vector<FaceId> iniBasinFaces_;
+    Vector<size_t, Graph::VertId> iniBasinFacesBegin_;
+
+    /// the next initial basin merged in the same root basin, all initial basins of a root basin form a circular list
+    Vector<Graph::VertId, Graph::VertId> nextMember_;
 };
 
 } //namespace MR
@@ -65,7 +65,9 @@ typedef enum MRGeneralOffsetParametersMode
     /// create mesh using standard marching cubes implemented in MeshLib
     MRGeneralOffsetParametersModeStandard,
     /// create mesh using standard marching cubes with additional sharpening implemented in MeshLib
-    MRGeneralOffsetParametersModeSharpening
+    MRGeneralOffsetParametersModeSharpening,
+    /// create mesh using adaptive dual contouring implemented in MeshLib
+    MRGeneralOffsetParametersModeDualContouring
 } MRGeneralOffsetParametersMode;
 
 typedef struct MRGeneralOffsetParameters
@@ -5,6 +5,9 @@
 #include <spdlog/tweakme.h>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/fmt/ostr.h>
+#if __has_include(<spdlog/fmt/compile.h>)
+#include <spdlog/fmt/compile.h>
+#endif
 #pragma warning(pop)
 
 #include "MRPch/MRBindingMacros.h"
@@ -3,6 +3,7 @@
 #include "MRMesh/MRCombinedHistoryAction.h"
 #include "MRPch/MRSpdlog.h"
 #include <cassert>
+#include <cstdint>
 
 namespace MR
 {
@@ -44,7 +45,8 @@ void HistoryStore::appendAction( const std::shared_ptr<HistoryAction>& action )
     {
         stack_.erase( stack_.begin(), stack_.begin() + numActionsToDelete );
         firstRedoIndex_ -= numActionsToDelete;
-        savedSceneIndex_ -= numActionsToDelete;
+        // if the saved state was among deleted actions then it cannot be reached anymore
+        savedSceneIndex_ = savedSceneIndex_ >= numActionsToDelete ? savedSceneIndex_ - numActionsToDelete : SIZE_MAX;
     }
 
     changedSignal( *this, ChangeType::AppendAction );
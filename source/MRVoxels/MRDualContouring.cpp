@@ -0,0 +1,686 @@
+#include "MRDualContouring.h"
+#include "MRVoxelsVolumeAccess.h"
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRTriMesh.h"
+#include "MRMesh/MRSymMatrix3.h"
+#include "MRMesh/MRBox.h"
+#include "MRMesh/MRIsNaN.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRGTest.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cfloat>
+
+namespace MR
+{
+
+namespace
+{
+
+// the minimal size of the blocks of cells processed in parallel, each block contains one or several octree roots
+constexpr int cMinBlockSize = 16;
+// the maximal size of octree root (merged cell)
+constexpr int cMaxCellSize = 32;
+// relative tolerance to truncate small eigenvalues in the minimization of quadratic error function
+constexpr double cQefTol = 0.1;
+
+// quadratic error function: the sum of squared distances from a point to accumulated tangent planes,
+// and the mass point of the surface to choose the solution in degenerate cases
+struct Qef
+{
+    SymMatrix3d a;
+    Vector3d b;
+    double c = 0;
+    Vector3d massSum;
+    int numPlanes = 0;
+    int numPoints = 0;
+
+    void addPlane( const Vector3d& n, const Vector3d& p )
+    {
+        const auto d = dot( n, p );
+        a += outerSquare( n );
+        b += d * n;
+        c += d * d;
+        ++numPlanes;
+    }
+
+    void addPoint( const Vector3d& p )
+    {
+        massSum += p;
+        ++numPoints;
+    }
+
+    Qef& operator +=( const Qef& q )
+    {
+        a += q.a;
+        b += q.b;
+        c += q.c;
+        massSum += q.massSum;
+        numPlanes += q.numPlanes;
+        numPoints += q.numPoints;
+        return *this;
+    }
+
+    Vector3d massPoint() const
+    {
+        assert( numPoints > 0 );
+        return massSum / double( numPoints );
+    }
+
+    // returns the point minimizing the error; among several such points returns the one closest to the mass point
+    Vector3d solve() const
+    {
+        const auto m = massPoint();
+        return m + a.pseudoinverse( cQefTol ) * ( b - a * m );
+    }
+
+    // returns the sum of squared distances from given point to all accumulated planes
+    double error( const Vector3d& x ) const
+    {
+        return std::max( 0.0, dot( x, a * x ) - 2 * dot( b, x ) + c );
+    }
+};
+
+enum class NodeState : uint8_t
+{
+    Invalid,  ///< the node has invalid (NaN) samples or cells outside of the volume
+    Empty,    ///< all samples of the node are on one side of the surface
+    Leaf,     ///< the node is a leaf of the octree with a vertex of the surface
+    Internal  ///< the node was not merged from its children
+};
+
+struct Node
+{
+    Qef qef;
+    Vector3d pos; ///< position of the vertex in leaf node relative to the block origin
+    NodeState state = NodeState::Invalid;
+    int vert = -1; ///< index of the vertex in the block, assigned only for the top-most leaves
+};
+
+// the cell crossed by the surface
+struct CellVert
+{
+    int cell = 0; ///< linear index of the cell in the block
+    int vert = 0; ///< index of the vertex of the leaf containing this cell in the block
+    uint8_t signs = 0; ///< bit i is set if i-th corner of the cell is inside
+};
+
+struct Block
+{
+    std::vector<CellVert> cells; ///< sorted by cell index
+    std::vector<Vector3f> points; ///< vertices of the block
+    VertId firstVert; ///< global id of the first vertex of the block
+    std::vector<ThreeVertIds> tris; ///< triangles from the edges having the cells of this block as the last ones
+};
+
+template<typename V>
+struct ThreadData
+{
+    VoxelsVolumeAccessor<V> acc;
+    std::vector<float> values; ///< values of the block voxels with one voxel margin
+    std::vector<uint8_t> signs; ///< corner signs of all cells in the block
+    std::vector<std::vector<Node>> levels; ///< octree nodes, level 0 are the cells
+};
+
+// i-th corner of a cell, bit 0 - X, bit 1 - Y, bit 2 - Z
+inline Vector3i cellCorner( int i )
+{
+    return { i & 1, ( i >> 1 ) & 1, ( i >> 2 ) & 1 };
+}
+
+// returns true if the inside corners of a cube with given signs are connected via cube edges, and the outside corners are connected as well,
+// so a single patch of the surface can pass through the cube
+bool isManifoldConfiguration( uint8_t signs )
+{
+    for ( const uint8_t side : { signs, uint8_t( ~signs ) } )
+    {
+        if ( side == 0 )
+            continue;
+        uint8_t reached = side & uint8_t( -side ); // lowest corner of the side
+        for ( ;; )
+        {
+            uint8_t next = reached;
+            for ( int i = 0; i < 8; ++i )
+                if ( reached & ( 1 << i ) )
+                    next |= uint8_t( ( 1 << ( i ^ 1 ) ) | ( 1 << ( i ^ 2 ) ) | ( 1 << ( i ^ 4 ) ) );
+            next &= side;
+            if ( next == reached )
+                break;
+            reached = next;
+        }
+        if ( reached != side )
+            return false;
+    }
+    return true;
+}
+
+class DualContourer
+{
+public:
+    DualContourer( const Vector3i& dims, const Vector3f& voxelSize, const DualContouringParams& params );
+
+    template<typename V>
+    Expected<TriMesh> run( const V& volume );
+
+private:
+    Vector3i blockOrigin_( int blockIndex ) const;
+
+    template<typename V>
+    void processBlock_( int blockIndex, ThreadData<V>& td );
+
+    // returns global id of the vertex of given cell or invalid id if the cell is not crossed by the surface
+    VertId findVert_( const Vector3i& cell ) const;
+
+    void triangulateBlock_( int blockIndex, const VertCoords& points );
+
+    const DualContouringParams& params_;
+    Vector3f voxelSize_;
+    Vector3i cellDims_; ///< the number of cells along each axis
+    int blockSize_ = 0; ///< the number of cells along each side of a block
+    int numLevels_ = 0; ///< the number of octree levels in each block including the level of cells
+    Vector3i blockDims_;
+    std::vector<Block> blocks_;
+};
+
+DualContourer::DualContourer( const Vector3i& dims, const Vector3f& voxelSize, const DualContouringParams& params )
+    : params_( params ), voxelSize_( voxelSize ), cellDims_( dims - Vector3i::diagonal( 1 ) )
+{
+    int maxCellSize = 1;
+    while ( maxCellSize < std::min( params.maxCellSize, cMaxCellSize ) )
+        maxCellSize *= 2;
+    numLevels_ = 1;
+    if ( params.maxError > 0 )
+        while ( ( 1 << ( numLevels_ - 1 ) ) < maxCellSize )
+            ++numLevels_;
+    blockSize_ = std::max( cMinBlockSize, 1 << ( numLevels_ - 1 ) );
+    for ( int i = 0; i < 3; ++i )
+        blockDims_[i] = ( cellDims_[i] + blockSize_ - 1 ) / blockSize_;
+    blocks_.resize( size_t( blockDims_.x ) * blockDims_.y * blockDims_.z );
+}
+
+Vector3i DualContourer::blockOrigin_( int blockIndex ) const
+{
+    const Vector3i bp( blockIndex % blockDims_.x, ( blockIndex / blockDims_.x ) % blockDims_.y, blockIndex / ( blockDims_.x * blockDims_.y ) );
+    return bp * blockSize_;
+}
+
+template<typename V>
+void DualContourer::processBlock_( int blockIndex, ThreadData<V>& td )
+{
+    const int bs = blockSize_;
+    const Vector3i org = blockOrigin_( blockIndex );
+    const Vector3i dims = cellDims_ + Vector3i::diagonal( 1 );
+
+    // load the values of block voxels with the margin of one voxel for gradient computation
+    const int vs = bs + 3;
+    td.values.resize( size_t( vs ) * vs * vs );
+    size_t n = 0;
+    for ( int z = -1; z <= bs + 1; ++z )
+        for ( int y = -1; y <= bs + 1; ++y )
+            for ( int x = -1; x <= bs + 1; ++x )
+            {
+                const Vector3i g = org + Vector3i( x, y, z );
+                const bool inVolume = g.x >= 0 && g.y >= 0 && g.z >= 0 && g.x < dims.x && g.y < dims.y && g.z < dims.z;
+                td.values[n++] = inVolume ? float( td.acc.get( g ) ) : cQuietNan;
+            }
+
+    auto value = [&]( const Vector3i& q )
+    {
+        return td.values[( q.x + 1 ) + size_t( vs ) * ( ( q.y + 1 ) + size_t( vs ) * ( q.z + 1 ) )];
+    };
+    auto inside = [&]( float v )
+    {
+        return params_.lessInside ? v < params_.iso : v >= params_.iso;
+    };
+    auto gradient = [&]( const Vector3i& q )
+    {
+        Vector3f g;
+        const float v0 = value( q );
+        for ( int k = 0; k < 3; ++k )
+        {
+            Vector3i e;
+            e[k] = 1;
+            const float vm = value( q - e );
+            const float vp = value( q + e );
+            if ( !isNanFast( vm ) && !isNanFast( vp ) )
+                g[k] = ( vp - vm ) / ( 2 * voxelSize_[k] );
+            else if ( !isNanFast( vp ) )
+                g[k] = ( vp - v0 ) / voxelSize_[k];
+            else if ( !isNanFast( vm ) )
+                g[k] = ( v0 - vm ) / voxelSize_[k];
+        }
+        return g;
+    };
+    const Vector3d voxelSize( voxelSize_ );
+    // places the vertex of a node with given origin and size (in cells) at the minimum of its error function,
+    // or in the mass point if the minimum is outside of the node
+    auto placeVertex = [&]( const Qef& qef, const Vector3i& o, int size )
+    {
+        const Box3d box( mult( voxelSize, Vector3d( o ) ), mult( voxelSize, Vector3d( o + Vector3i::diagonal( size ) ) ) );
+        if ( qef.numPlanes > 0 )
+        {
+            const auto x = qef.solve();
+            if ( box.contains( x ) )
+                return x;
+        }
+        return qef.massPoint();
+    };
+
+    // octree leaves: the cells of the block
+    td.levels.resize( numLevels_ );
+    auto& cells = td.levels[0];
+    cells.assign( size_t( bs ) * bs * bs, Node{} );
+    td.signs.assign( cells.size(), 0 );
+    n = 0;
+    for ( int z = 0; z < bs; ++z )
+        for ( int y = 0; y < bs; ++y )
+            for ( int x = 0; x < bs; ++x, ++n )
+            {
+                const Vector3i local( x, y, z );
+                const Vector3i c = org + local;
+                if ( c.x >= cellDims_.x || c.y >= cellDims_.y || c.z >= cellDims_.z )
+                    continue;
+                std::array<float, 8> v;
+                uint8_t signs = 0;
+                bool valid = true;
+                for ( int i = 0; i < 8; ++i )
+                {
+                    v[i] = value( local + cellCorner( i ) );
+                    if ( isNanFast( v[i] ) )
+                    {
+                        valid = false;
+                        break;
+                    }
+                    if ( inside( v[i] ) )
+                        signs |= uint8_t( 1 << i );
+                }
+                if ( !valid )
+                    continue;
+                auto& node = cells[n];
+                td.signs[n] = signs;
+                if ( signs == 0 || signs == 0xff )
+                {
+                    node.state = NodeState::Empty;
+                    continue;
+                }
+                node.state = NodeState::Leaf;
+                for ( int a = 0; a < 3; ++a )
+                {
+                    for ( int i = 0; i < 8; ++i )
+                    {
+                        const int j = i | ( 1 << a );
+                        if ( i == j || ( ( signs >> i ) & 1 ) == ( ( signs >> j ) & 1 ) )
+                            continue;
+                        // Hermite data: the crossing point of the edge and the normal there
+                        const float t = ( params_.iso - v[i] ) / ( v[j] - v[i] );
+                        const Vector3i qi = local + cellCorner( i );
+                        Vector3f p( qi );
+                        p[a] += t;
+                        const Vector3f normal = ( 1 - t ) * gradient( qi ) + t * gradient( local + cellCorner( j ) );
+                        const Vector3d pt = mult( voxelSize, Vector3d( p ) );
+                        node.qef.addPoint( pt );
+                        if ( normal.lengthSq() > 0 )
+                            node.qef.addPlane( Vector3d( normal.normalized() ), pt );
+                    }
+                }
+                node.pos = placeVertex( node.qef, local, 1 );
+            }
+
+    // returns true if merging of the node with given origin and size does not change the topology of the surface:
+    // the signs in the corners of the node are manifold, and the sign in the middle of each edge, face and the node itself
+    // coincides with the sign in one of the corners of that element
+    auto topologyPreserved = [&]( const Vector3i& o, int size )
+    {
+        const int half = size / 2;
+        std::array<bool, 27> s;
+        for ( int k = 0; k < 3; ++k )
+            for ( int j = 0; j < 3; ++j )
+                for ( int i = 0; i < 3; ++i )
+                {
+                    const float v = value( o + half * Vector3i( i, j, k ) );
+                    if ( isNanFast( v ) )
+                        return false;
+                    s[i + 3 * ( j + 3 * k )] = inside( v );
+                }
+        uint8_t cornerSigns = 0;
+        for ( int c = 0; c < 8; ++c )
+        {
+            const auto p = 2 * cellCorner( c );
+            if ( s[p.x + 3 * ( p.y + 3 * p.z )] )
+                cornerSigns |= uint8_t( 1 << c );
+        }
+        if ( !isManifoldConfiguration( cornerSigns ) )
+            return false;
+        for ( int k = 0; k < 3; ++k )
+            for ( int j = 0; j < 3; ++j )
+                for ( int i = 0; i < 3; ++i )
+                {
+                    const Vector3i m( i, j, k );
+                    if ( i != 1 && j != 1 && k != 1 )
+                        continue; // corner
+                    bool found = false;
+                    for ( int c = 0; c < 8 && !found; ++c )
+                    {
+                        Vector3i p = m;
+                        for ( int a = 0; a < 3; ++a )
+                            if ( p[a] == 1 )
+                                p[a] = 2 * ( ( c >> a ) & 1 );
+                        found = s[p.x + 3 * ( p.y + 3 * p.z )] == s[i + 3 * ( j + 3 * k )];
+                    }
+                    if ( !found )
+                        return false;
+                }
+        return true;
+    };
+
+    // merge the nodes bottom-up
+    const double maxErrorSq = sqr( double( params_.maxError ) );
+    for ( int l = 1; l < numLevels_; ++l )
+    {
+        const int size = 1 << l;
+        const int ln = bs >> l;
+        const auto& children = td.levels[l - 1];
+        auto& nodes = td.levels[l];
+        nodes.assign( size_t( ln ) * ln * ln, Node{} );
+        n = 0;
+        for ( int z = 0; z < ln; ++z )
+            for ( int y = 0; y < ln; ++y )
+                for ( int x = 0; x < ln; ++x, ++n )
+                {
+                    auto& node = nodes[n];
+                    Qef qef;
+                    bool blocked = false;
+                    for ( int c = 0; c < 8 && !blocked; ++c )
+                    {
+                        const auto cp = 2 * Vector3i( x, y, z ) + cellCorner( c );
+                        const auto& child = children[cp.x + size_t( 2 * ln ) * ( cp.y + size_t( 2 * ln ) * cp.z )];
+                        if ( child.state == NodeState::Leaf )
+                            qef += child.qef;
+                        else if ( child.state != NodeState::Empty )
+                            blocked = true;
+                    }
+                    if ( blocked )
+                    {
+                        node.state = NodeState::Internal;
+                        continue;
+                    }
+                    if ( qef.numPoints == 0 )
+                    {
+                        node.state = NodeState::Empty;
+                        continue;
+                    }
+                    const Vector3i o = size * Vector3i( x, y, z );
+                    node.state = NodeState::Internal;
+                    if ( !topologyPreserved( o, size ) )
+                        continue;
+                    const auto pos = placeVertex( qef, o, size );
+                    if ( qef.error( pos ) > maxErrorSq * qef.numPlanes )
+                        continue;
+                    node.state = NodeState::Leaf;
+                    node.qef = qef;
+                    node.pos = pos;
+                }
+    }
+
+    // assign vertices to the top-most leaves
+    auto& block = blocks_[blockIndex];
+    block.cells.clear();
+    block.points.clear();
+    const Vector3f blockZero = params_.origin + mult( voxelSize_, td.acc.shift() + Vector3f( org ) );
+    n = 0;
+    for ( int z = 0; z < bs; ++z )
+        for ( int y = 0; y < bs; ++y )
+            for ( int x = 0; x < bs; ++x, ++n )
+            {
+                if ( cells[n].state != NodeState::Leaf )
+                    continue;
+                Node* leaf = nullptr;
+                for ( int l = numLevels_ - 1; l >= 0 && !leaf; --l )
+                {
+                    const int ln = bs >> l;
+                    auto& node = td.levels[l][( x >> l ) + size_t( ln ) * ( ( y >> l ) + size_t( ln ) * ( z >> l ) )];
+                    if ( node.state == NodeState::Leaf )
+                        leaf = &node;
+                }
+                assert( leaf );
+                if ( leaf->vert < 0 )
+                {
+                    leaf->vert = int( block.points.size() );
+                    block.points.push_back( blockZero + Vector3f( leaf->pos ) );
+                }
+                block.cells.push_back( { int( n ), leaf->vert, td.signs[n] } );
+            }
+}
+
+VertId DualContourer::findVert_( const Vector3i& cell ) const
+{
+    if ( cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= cellDims_.x || cell.y >= cellDims_.y || cell.z >= cellDims_.z )
+        return {};
+    const int bs = blockSize_;
+    const Vector3i bp( cell.x / bs, cell.y / bs, cell.z / bs );
+    const Vector3i local = cell - bp * bs;
+    const auto& block = blocks_[bp.x + size_t( blockDims_.x ) * ( bp.y + size_t( blockDims_.y ) * bp.z )];
+    const int index = local.x + bs * ( local.y + bs * local.z );
+    auto it = std::lower_bound( block.cells.begin(), block.cells.end(), index, [] ( const CellVert& cv, int i ) { return cv.cell < i; } );
+    if ( it == block.cells.end() || it->cell != index )
+        return {};
+    return block.firstVert + it->vert;
+}
+
+void DualContourer::triangulateBlock_( int blockIndex, const VertCoords& points )
+{
+    const int bs = blockSize_;
+    const Vector3i org = blockOrigin_( blockIndex );
+    auto& block = blocks_[blockIndex];
+    block.tris.clear();
+    for ( const auto& cv : block.cells )
+    {
+        const Vector3i c = org + Vector3i( cv.cell % bs, ( cv.cell / bs ) % bs, cv.cell / ( bs * bs ) );
+        const bool inside0 = cv.signs & 1;
+        for ( int a = 0; a < 3; ++a )
+        {
+            // the edge from the lowest corner of the cell along axis a
+            const bool inside1 = ( cv.signs >> ( 1 << a ) ) & 1;
+            if ( inside0 == inside1 )
+                continue;
+            Vector3i eu, ev;
+            eu[( a + 1 ) % 3] = 1;
+            ev[( a + 2 ) % 3] = 1;
+            // four cells around the edge in counter-clockwise order looking from the end of the edge
+            std::array<VertId, 4> vs{ findVert_( c - eu - ev ), findVert_( c - ev ), block.firstVert + cv.vert, findVert_( c - eu ) };
+            if ( !vs[0] || !vs[1] || !vs[3] )
+                continue;
+            // the normal of the surface is directed from inside to outside
+            if ( !inside0 )
+                std::swap( vs[1], vs[3] );
+
+            // remove the vertices of merged cells repeating in the polygon
+            std::array<VertId, 4> poly;
+            int polySize = 0;
+            for ( int i = 0; i < 4; ++i )
+                if ( vs[i] != vs[( i + 3 ) % 4] )
+                    poly[polySize++] = vs[i];
+            if ( polySize == 3 )
+                block.tris.push_back( { poly[0], poly[1], poly[2] } );
+            else if ( polySize == 4 )
+            {
+                // split the quadrangle by its shorter diagonal
+                if ( ( points[poly[0]] - points[poly[2]] ).lengthSq() <= ( points[poly[1]] - points[poly[3]] ).lengthSq() )
+                {
+                    block.tris.push_back( { poly[0], poly[1], poly[2] } );
+                    block.tris.push_back( { poly[0], poly[2], poly[3] } );
+                }
+                else
+                {
+                    block.tris.push_back( { poly[1], poly[2], poly[3] } );
+                    block.tris.push_back( { poly[1], poly[3], poly[0] } );
+                }
+            }
+        }
+    }
+}
+
+template<typename V>
+Expected<TriMesh> DualContourer::run( const V& volume )
+{
+    MR_TIMER
+    if ( cellDims_.x <= 0 || cellDims_.y <= 0 || cellDims_.z <= 0 )
+        return TriMesh{};
+
+    tbb::enumerable_thread_specific<ThreadData<V>> threadData( ThreadData<V>{ VoxelsVolumeAccessor<V>( volume ) } );
+    if ( !ParallelFor( 0, (int)blocks_.size(), threadData, [&] ( int blockIndex, ThreadData<V>& td )
+    {
+        processBlock_( blockIndex, td );
+    }, subprogress( params_.cb, 0.0f, 0.6f ), 1 ) )
+        return unexpectedOperationCanceled();
+    threadData.clear();
+
+    VertId numVerts( 0 );
+    for ( auto& block : blocks_ )
+    {
+        block.firstVert = numVerts;
+        numVerts += (int)block.points.size();
+    }
+    TriMesh res;
+    res.points.resizeNoInit( numVerts );
+    ParallelFor( blocks_, [&] ( size_t blockIndex )
+    {
+        auto& block = blocks_[blockIndex];
+        std::copy( block.points.begin(), block.points.end(), res.points.vec_.begin() + block.firstVert );
+        block.points = {};
+    } );
+
+    if ( !ParallelFor( 0, (int)blocks_.size(), [&] ( int blockIndex )
+    {
+        triangulateBlock_( blockIndex, res.points );
+    }, subprogress( params_.cb, 0.6f, 0.9f ), 1 ) )
+        return unexpectedOperationCanceled();
+
+    std::vector<size_t> firstTri( blocks_.size() + 1, 0 );
+    for ( size_t i = 0; i < blocks_.size(); ++i )
+        firstTri[i + 1] = firstTri[i] + blocks_[i].tris.size();
+    res.tris.resize( firstTri.back() );
+    ParallelFor( blocks_, [&] ( size_t blockIndex )
+    {
+        const auto& tris = blocks_[blockIndex].tris;
+        std::copy( tris.begin(), tris.end(), res.tris.vec_.begin() + firstTri[blockIndex] );
+    } );
+    blocks_ = {};
+
+    if ( !reportProgress( params_.cb, 0.9f ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+template<typename V>
+Expected<TriMesh> runDualContouring( const V& volume, const DualContouringParams& params )
+{
+    return DualContourer( volume.dims, volume.voxelSize, params ).run( volume );
+}
+
+Expected<Mesh> triMeshToMesh( Expected<TriMesh> && tm, const DualContouringParams& params )
+{
+    return std::move( tm ).and_then( [&params]( TriMesh && t ) -> Expected<Mesh>
+    {
+        // the vertices of the cells with ambiguous signs can be shared by several patches of the surface
+        auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( t.points ), t.tris );
+        if ( !reportProgress( params.cb, 1.0f ) )
+            return unexpectedOperationCanceled();
+        return res;
+    } );
+}
+
+} // anonymous namespace
+
+Expected<TriMesh> dualContouringAsTriMesh( const SimpleVolume& volume, const DualContouringParams& params )
+{
+    return runDualContouring( volume, params );
+}
+
+Expected<Mesh> dualContouring( const SimpleVolume& volume, const DualContouringParams& params )
+{
+    return triMeshToMesh( dualContouringAsTriMesh( volume, params ), params );
+}
+
+Expected<TriMesh> dualContouringAsTriMesh( const SimpleVolumeMinMax& volume, const DualContouringParams& params )
+{
+    if ( params.iso <= volume.min || params.iso >= volume.max )
+        return TriMesh{};
+    return runDualContouring( volume, params );
+}
+
+Expected<Mesh> dualContouring( const SimpleVolumeMinMax& volume, const DualContouringParams& params )
+{
+    return triMeshToMesh( dualContouringAsTriMesh( volume, params ), params );
+}
+
+Expected<TriMesh> dualContouringAsTriMesh( const VdbVolume& volume, const DualContouringParams& params )
+{
+    if ( !volume.data )
+        return unexpected( "No volume data." );
+    if ( params.iso <= volume.min || params.iso >= volume.max )
+        return TriMesh{};
+    return runDualContouring( volume, params );
+}
+
+Expected<Mesh> dualContouring( const VdbVolume& volume, const DualContouringParams& params )
+{
+    return triMeshToMesh( dualContouringAsTriMesh( volume, params ), params );
+}
+
+Expected<TriMesh> dualContouringAsTriMesh( const FunctionVolume& volume, const DualContouringParams& params )
+{
+    if ( !volume.data )
+        return unexpected( "Getter function is not specified." );
+    return runDualContouring( volume, params );
+}
+
+Expected<Mesh> dualContouring( const FunctionVolume& volume, const DualContouringParams& params )
+{
+    return triMeshToMesh( dualContouringAsTriMesh( volume, params ), params );
+}
+
+TEST( MRMesh, DualContouring )
+{
+    // signed distance to the box [-1,1]^3, negative inside
+    const float voxelSize = 0.1f;
+    const Vector3f origin = Vector3f::diagonal( -1.53f );
+    FunctionVolume volume;
+    volume.dims = Vector3i::diagonal( 30 );
+    volume.voxelSize = Vector3f::diagonal( voxelSize );
+    volume.data = [&] ( const Vector3i& p )
+    {
+        const Vector3f pt = origin + voxelSize * ( Vector3f( p ) + Vector3f::diagonal( 0.5f ) );
+        const Vector3f q( std::abs( pt.x ) - 1, std::abs( pt.y ) - 1, std::abs( pt.z ) - 1 );
+        const float outside = Vector3f( std::max( q.x, 0.f ), std::max( q.y, 0.f ), std::max( q.z, 0.f ) ).length();
+        return outside + std::min( std::max( { q.x, q.y, q.z } ), 0.f );
+    };
+
+    int uniformFaces = 0;
+    for ( float maxError : { 0.0f, 0.1f * voxelSize } )
+    {
+        auto mesh = dualContouring( volume, { .origin = origin, .lessInside = true, .maxError = maxError } );
+        ASSERT_TRUE( mesh.has_value() );
+        EXPECT_TRUE( mesh->topology.isClosed() );
+        const auto numFaces = mesh->topology.numValidFaces();
+        EXPECT_GT( numFaces, 0 );
+        if ( maxError == 0 )
+            uniformFaces = numFaces;
+        else
+            EXPECT_LT( 4 * numFaces, uniformFaces );
+
+        // all vertices are near the surface of the box including its corners
+        float minCornerDist = FLT_MAX;
+        for ( auto v : mesh->topology.getValidVerts() )
+        {
+            const auto& p = mesh->points[v];
+            EXPECT_NEAR( std::max( { std::abs( p.x ), std::abs( p.y ), std::abs( p.z ) } ), 1.0f, 0.5f * voxelSize );
+            minCornerDist = std::min( minCornerDist, ( p - Vector3f::diagonal( 1 ) ).length() );
+        }
+        EXPECT_LT( minCornerDist, 0.5f * voxelSize );
+    }
+}
+
+} //namespace MR
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MRVoxelsFwd.h"
+#include "MRVoxelsVolume.h"
+#include "MRMesh/MRVector3.h"
+#include "MRMesh/MRProgressCallback.h"
+#include "MRMesh/MRExpected.h"
+
+namespace MR
+{
+
+struct DualContouringParams
+{
+    /// origin point of voxels box in 3D space with output mesh
+    Vector3f origin;
+
+    /// progress callback
+    ProgressCallback cb;
+
+    /// target iso-value of the surface to be extracted from volume
+    float iso{ 0.0f };
+
+    /// should be false for dense volumes, and true for distance volume
+    bool lessInside{ false };
+
+    /// octree cells are merged while the root-mean-square distance from the vertex of merged cell
+    /// to the tangent planes of the surface inside it does not exceed this value (in world units);
+    /// zero value disables merging and produces uniform dual contouring mesh with one vertex per each cell crossed by the surface
+    float maxError = 0;
+
+    /// maximal size of merged cell in voxels along each axis, it is rounded up to a power of two and clamped to [1, 32]
+    int maxCellSize = 16;
+};
+
+/// makes Mesh from SimpleVolume using adaptive Dual Contouring algorithm:
+/// one vertex is placed in each leaf of the octree built over the cells crossed by the surface
+/// in the position minimizing the distances to the tangent planes of the surface (quadratic error function),
+/// which recovers sharp features without any post-processing;
+/// the cells are merged bottom-up while the error is small and the topology of the surface is preserved,
+/// so flat regions are represented by much fewer triangles than in marching cubes;
+/// the volume is processed by blocks of maxCellSize in parallel
+MRVOXELS_API Expected<Mesh> dualContouring( const SimpleVolume& volume, const DualContouringParams& params = {} );
+MRVOXELS_API Expected<TriMesh> dualContouringAsTriMesh( const SimpleVolume& volume, const DualContouringParams& params = {} );
+
+/// makes Mesh from SimpleVolumeMinMax using adaptive Dual Contouring algorithm
+MRVOXELS_API Expected<Mesh> dualContouring( const SimpleVolumeMinMax& volume, const DualContouringParams& params = {} );
+MRVOXELS_API Expected<TriMesh> dualContouringAsTriMesh( const SimpleVolumeMinMax& volume, const DualContouringParams& params = {} );
+
+/// makes Mesh from VdbVolume using adaptive Dual Contouring algorithm
+MRVOXELS_API Expected<Mesh> dualContouring( const VdbVolume& volume, const DualContouringParams& params = {} );
+MRVOXELS_API Expected<TriMesh> dualContouringAsTriMesh( const VdbVolume& volume, const DualContouringParams& params = {} );
+
+/// makes Mesh from FunctionVolume using adaptive Dual Contouring algorithm
+MRVOXELS_API Expected<Mesh> dualContouring( const FunctionVolume& volume, const DualContouringParams& params = {} );
+MRVOXELS_API Expected<TriMesh> dualContouringAsTriMesh( const FunctionVolume& volume, const DualContouringParams& params = {} );
+
+} //namespace MR
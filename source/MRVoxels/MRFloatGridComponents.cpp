@@ -1,10 +1,11 @@
 #include "MRFloatGridComponents.h"
 
-#include "MRMesh/MRUnionFind.h"
+#include "MRMesh/MRConcurrentUnionFind.h"
 #include "MRVDBFloatGrid.h"
 #include "MRMesh/MRVolumeIndexer.h"
 #include "MRMesh/MRBitSet.h"
 #include "MRMesh/MRTimer.h"
+#include "MRPch/MRTBB.h"
 
 namespace MR
 {
@@ -15,28 +16,31 @@ namespace FloatGridComponents
 UnionFind<VoxelId> getUnionFindStructureVoxels( const FloatGrid& grid, const VolumeIndexer& indexer, const Vector3i& minVox, float isoValue )
 {
     MR_TIMER;
-    UnionFind<VoxelId> unionFindStructure( indexer.size() );
-    auto accessor = grid->getConstAccessor();
+    ConcurrentUnionFind<VoxelId> unionFindStructure( indexer.size() );
 
-    for ( int z = 0; z < indexer.dims().z; ++z )
-        for ( int y = 0; y < indexer.dims().y; ++y )
-            for ( int x = 0; x < indexer.dims().x; ++x )
-            {
-                auto thisVox = indexer.toVoxelId( { x,y,z } );
-                auto thisCoord = minVox + Vector3i{ x, y, z };
-                auto thisVal = accessor.getValue( { thisCoord.x, thisCoord.y, thisCoord.z } );
-                for ( int i = 0; i < OutEdgeCount; i += 2 /*Plus dir only*/ )
+    tbb::parallel_for( tbb::blocked_range<int>( 0, indexer.dims().z ), [&] ( const tbb::blocked_range<int>& range )
+    {
+        auto accessor = grid->getConstAccessor();
+        for ( int z = range.begin(); z < range.end(); ++z )
+            for ( int y = 0; y < indexer.dims().y; ++y )
+                for ( int x = 0; x < indexer.dims().x; ++x )
                 {
-                    auto neighVox = indexer.getNeighbor( thisVox, OutEdge( i ) );
-                    if ( !neighVox.valid() )
-                        continue;
-                    auto neighCoord = minVox + indexer.toPos( neighVox );
+                    auto thisVox = indexer.toVoxelId( { x,y,z } );
+                    auto thisCoord = minVox + Vector3i{ x, y, z };
+                    auto thisVal = accessor.getValue( { thisCoord.x, thisCoord.y, thisCoord.z } );
+                    for ( int i = 0; i < OutEdgeCount; i += 2 /*Plus dir only*/ )
+                    {
+                        auto neighVox = indexer.getNeighbor( thisVox, OutEdge( i ) );
+                        if ( !neighVox.valid() )
+                            continue;
+                        auto neighCoord = minVox + indexer.toPos( neighVox );
 
-                    if ( ( thisVal < isoValue ) == ( accessor.getValue( { neighCoord.x, neighCoord.y, neighCoord.z } ) < isoValue ) )
-                        unionFindStructure.unite( thisVox, neighVox );
+                        if ( ( thisVal < isoValue ) == ( accessor.getValue( { neighCoord.x, neighCoord.y, neighCoord.z } ) < isoValue ) )
+                            unionFindStructure.unite( thisVox, neighVox );
+                    }
                 }
-            }
-    return unionFindStructure;
+    } );
+    return unionFindStructure.toUnionFind();
 }
 
 std::vector<VoxelBitSet> getAllComponents( const FloatGrid& grid, float isoValue /*= 0.0f*/ )
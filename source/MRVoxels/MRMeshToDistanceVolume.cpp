@@ -1,4 +1,6 @@
 #include "MRMeshToDistanceVolume.h"
+#include "MRVDBFloatGrid.h"
+#include "MRVDBConversions.h"
 #include "MRMesh/MRIsNaN.h"
 #include "MRMesh/MRMesh.h"
 #include "MRMesh/MRTimer.h"
@@ -9,6 +11,11 @@
 #include "MRMesh/MRParallelFor.h"
 #include "MRMesh/MRAABBTree.h"
 #include "MRMesh/MRPointsToMeshProjector.h"
+#include "MRMesh/MRClosestPointInTriangle.h"
+#include "MRMesh/MRBitSetParallelFor.h"
+#include "MRMesh/MRGTest.h"
+#include "MRMesh/MRMakeSphereMesh.h"
+#include <algorithm>
 #include <tuple>
 
 namespace MR
@@ -102,6 +109,156 @@ FunctionVolume meshToDistanceFunctionVolume( const MeshPart& mp, const MeshToDis
     };
 }
 
+Expected<VdbVolume> meshToDistanceVdbVolume( const MeshPart& mp, const MeshToDistanceVolumeParams& params )
+{
+    MR_TIMER
+    if ( params.dist.signMode == SignDetectionMode::OpenVDB )
+        return unexpected( "OpenVDB sign detection mode is not supported, use meshToLevelSet" );
+    if ( !( params.dist.maxDistSq < FLT_MAX ) )
+        return unexpected( "Maximal distance must be finite" );
+    assert( params.dist.signMode != SignDetectionMode::HoleWindingRule || !mp.region ); // only whole mesh is supported for now
+
+    constexpr int cLeafDim = openvdb::FloatTree::LeafNodeType::DIM;
+    constexpr int cLeafLog2Dim = openvdb::FloatTree::LeafNodeType::LOG2DIM;
+    const Vector3i& dims = params.vol.dimensions;
+    const Vector3f& voxelSize = params.vol.voxelSize;
+    // leaf blocks are identified by 21-bit coordinates packed in one number
+    auto leafKey = [] ( const Vector3i& l ) { return uint64_t( l.x ) | ( uint64_t( l.y ) << 21 ) | ( uint64_t( l.z ) << 42 ); };
+    auto leafPos = [] ( uint64_t key ) { return Vector3i( int( key & 0x1FFFFF ), int( ( key >> 21 ) & 0x1FFFFF ), int( key >> 42 ) ); };
+    auto voxelCenter = [&] ( const Vector3i& pos )
+    {
+        return params.vol.origin + mult( voxelSize, Vector3f( pos ) + Vector3f::diagonal( 0.5f ) );
+    };
+
+    // find all leaf blocks having voxel centers within maximal distance from a triangle
+    const float maxDist = std::sqrt( params.dist.maxDistSq );
+    const float leafHalfDiagonal = 0.5f * ( cLeafDim - 1 ) * voxelSize.length();
+    tbb::enumerable_thread_specific<std::vector<uint64_t>> threadLeaves;
+    BitSetParallelFor( mp.mesh.topology.getFaceIds( mp.region ), threadLeaves, [&] ( FaceId f, std::vector<uint64_t>& leaves )
+    {
+        Vector3f a, b, c;
+        mp.mesh.getTriPoints( f, a, b, c );
+        Box3f box;
+        box.include( a );
+        box.include( b );
+        box.include( c );
+        box = box.expanded( Vector3f::diagonal( maxDist ) );
+        Vector3i leafMin, leafMax;
+        for ( int i = 0; i < 3; ++i )
+        {
+            leafMin[i] = std::max( 0, (int)std::ceil( ( box.min[i] - params.vol.origin[i] ) / voxelSize[i] - 0.5f ) ) >> cLeafLog2Dim;
+            leafMax[i] = std::min( dims[i] - 1, (int)std::floor( ( box.max[i] - params.vol.origin[i] ) / voxelSize[i] - 0.5f ) ) >> cLeafLog2Dim;
+        }
+        Vector3i l;
+        for ( l.z = leafMin.z; l.z <= leafMax.z; ++l.z )
+            for ( l.y = leafMin.y; l.y <= leafMax.y; ++l.y )
+                for ( l.x = leafMin.x; l.x <= leafMax.x; ++l.x )
+                {
+                    const auto center = 0.5f * ( voxelCenter( l * cLeafDim ) + voxelCenter( l * cLeafDim + Vector3i::diagonal( cLeafDim - 1 ) ) );
+                    const auto proj = closestPointInTriangle( center, a, b, c ).first;
+                    if ( ( proj - center ).lengthSq() <= sqr( maxDist + leafHalfDiagonal ) )
+                        leaves.push_back( leafKey( l ) );
+                }
+        // remove duplicates from the neighbor triangles periodically to limit memory
+        if ( leaves.size() >= 4096 )
+        {
+            std::sort( leaves.begin(), leaves.end() );
+            leaves.erase( std::unique( leaves.begin(), leaves.end() ), leaves.end() );
+        }
+    } );
+    std::vector<uint64_t> leafKeys;
+    for ( auto& leaves : threadLeaves )
+    {
+        leafKeys.insert( leafKeys.end(), leaves.begin(), leaves.end() );
+        leaves = {};
+    }
+    tbb::parallel_sort( leafKeys.begin(), leafKeys.end() );
+    leafKeys.erase( std::unique( leafKeys.begin(), leafKeys.end() ), leafKeys.end() );
+    if ( !reportProgress( params.vol.cb, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    // exact distances in the voxels of active leaves, NaN for the voxels out of the band
+    constexpr int cLeafSize = cLeafDim * cLeafDim * cLeafDim;
+    std::vector<float> values( leafKeys.size() * cLeafSize );
+    const bool windingSign = params.dist.signMode == SignDetectionMode::HoleWindingRule;
+    DistanceToMeshOptions distOptions = params.dist;
+    if ( windingSign )
+        distOptions.signMode = SignDetectionMode::Unsigned; // the signs are computed below for all voxels at once
+    if ( !ParallelFor( size_t( 0 ), leafKeys.size(), [&] ( size_t i )
+    {
+        const auto org = leafPos( leafKeys[i] ) * cLeafDim;
+        int n = 0;
+        for ( int z = 0; z < cLeafDim; ++z )
+            for ( int y = 0; y < cLeafDim; ++y )
+                for ( int x = 0; x < cLeafDim; ++x, ++n )
+                {
+                    const auto pos = org + Vector3i( x, y, z );
+                    float value = cQuietNan;
+                    if ( pos.x < dims.x && pos.y < dims.y && pos.z < dims.z )
+                        if ( auto dist = signedDistanceToMesh( mp, voxelCenter( pos ), distOptions ) )
+                            value = *dist;
+                    values[i * cLeafSize + n] = value;
+                }
+    }, subprogress( params.vol.cb, 0.1f, windingSign ? 0.7f : 0.9f ), 1 ) )
+        return unexpectedOperationCanceled();
+
+    if ( windingSign )
+    {
+        std::vector<size_t> ids;
+        std::vector<Vector3f> points;
+        for ( size_t i = 0; i < values.size(); ++i )
+        {
+            if ( isNanFast( values[i] ) )
+                continue;
+            const int n = int( i % cLeafSize );
+            ids.push_back( i );
+            points.push_back( voxelCenter( leafPos( leafKeys[i / cLeafSize] ) * cLeafDim + Vector3i( n % cLeafDim, ( n / cLeafDim ) % cLeafDim, n / ( cLeafDim * cLeafDim ) ) ) );
+        }
+        auto fwn = params.fwn;
+        if ( !fwn )
+            fwn = std::make_shared<FastWindingNumber>( mp.mesh );
+        std::vector<float> windings;
+        fwn->calcFromVector( windings, points, params.dist.windingNumberBeta );
+        points = {};
+        if ( !reportProgress( params.vol.cb, 0.85f ) )
+            return unexpectedOperationCanceled();
+        ParallelFor( ids, [&] ( size_t j )
+        {
+            if ( windings[j] > params.dist.windingNumberThreshold )
+                values[ids[j]] = -values[ids[j]];
+        } );
+    }
+    if ( !reportProgress( params.vol.cb, 0.9f ) )
+        return unexpectedOperationCanceled();
+
+    // create leaf nodes sequentially and fill them in parallel
+    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create( maxDist );
+    std::vector<openvdb::FloatTree::LeafNodeType*> leafNodes( leafKeys.size() );
+    for ( size_t i = 0; i < leafKeys.size(); ++i )
+        leafNodes[i] = grid->tree().touchLeaf( toVdb( leafPos( leafKeys[i] ) * cLeafDim ) );
+    ParallelFor( leafNodes, [&] ( size_t i )
+    {
+        const auto org = leafPos( leafKeys[i] ) * cLeafDim;
+        int n = 0;
+        for ( int z = 0; z < cLeafDim; ++z )
+            for ( int y = 0; y < cLeafDim; ++y )
+                for ( int x = 0; x < cLeafDim; ++x, ++n )
+                {
+                    const float value = values[i * cLeafSize + n];
+                    if ( !isNanFast( value ) )
+                        leafNodes[i]->setValueOn( toVdb( org + Vector3i( x, y, z ) ), value );
+                }
+    } );
+    values = {};
+    grid->pruneGrid( 0.0f );
+
+    VdbVolume res = floatGridToVdbVolume( MakeFloatGrid( std::move( grid ) ) );
+    res.voxelSize = voxelSize;
+    if ( !reportProgress( params.vol.cb, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
 Expected<SimpleVolumeMinMax> meshRegionToIndicatorVolume( const Mesh& mesh, const FaceBitSet& region,
     float offset, const DistanceVolumeParams& params )
 {
@@ -192,4 +349,45 @@ Expected<std::array<SimpleVolumeMinMax, 3>> meshToDirectionVolume( const MeshToD
 }
 
 
+TEST( MRMesh, MeshToDistanceVdbVolume )
+{
+    const auto sphere = makeSphere( { .radius = 1, .numMeshVertices = 400 } );
+    MeshToDistanceVolumeParams params;
+    params.vol.origin = Vector3f::diagonal( -1.5f );
+    params.vol.voxelSize = Vector3f::diagonal( 0.1f );
+    params.vol.dimensions = Vector3i::diagonal( 30 );
+    params.dist.maxDistSq = sqr( 0.25f );
+
+    for ( auto signMode : { SignDetectionMode::Unsigned, SignDetectionMode::ProjectionNormal, SignDetectionMode::HoleWindingRule } )
+    {
+        params.dist.signMode = signMode;
+        auto vdb = meshToDistanceVdbVolume( sphere, params );
+        ASSERT_TRUE( vdb.has_value() );
+        auto acc = vdb->data->getConstAccessor();
+
+        // the values of active voxels are the same as in the function volume, and all other voxels are inactive
+        const auto ref = meshToDistanceFunctionVolume( sphere, params );
+        auto unsignedOptions = params.dist;
+        unsignedOptions.signMode = SignDetectionMode::Unsigned;
+        const VolumeIndexer indexer( params.vol.dimensions );
+        size_t numActive = 0;
+        for ( auto i = VoxelId( size_t( 0 ) ); i < indexer.size(); ++i )
+        {
+            const auto pos = indexer.toPos( i );
+            const auto center = params.vol.origin + mult( params.vol.voxelSize, Vector3f( pos ) + Vector3f::diagonal( 0.5f ) );
+            const bool inBand = signedDistanceToMesh( sphere, center, unsignedOptions ).has_value();
+            float value = 0;
+            const bool active = acc.probeValue( toVdb( pos ), value );
+            EXPECT_EQ( active, inBand );
+            if ( active )
+            {
+                EXPECT_NEAR( value, ref.data( pos ), 1e-6f );
+                ++numActive;
+            }
+        }
+        EXPECT_GT( numActive, 0 );
+        EXPECT_LT( numActive, indexer.size() / 2 );
+    }
+}
+
 } //namespace MR
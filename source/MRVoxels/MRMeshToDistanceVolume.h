@@ -50,6 +50,14 @@ MRVOXELS_API Expected<SimpleVolumeMinMax> meshToDistanceVolume( const MeshPart&
 /// makes FunctionVolume representing (signed or unsigned) distances from Mesh with given settings
 MRVOXELS_API FunctionVolume meshToDistanceFunctionVolume( const MeshPart& mp, const MeshToDistanceVolumeParams& params = {} );
 
+/// makes VdbVolume with (signed or unsigned) distances from Mesh with given settings only in the narrow band of voxels
+/// with the distances in [sqrt(dist.minDistSq), sqrt(dist.maxDistSq)], all other voxels are inactive;
+/// the triangles are rasterized into the leaf blocks of the grid, and the distances are computed exactly for the voxels of the active blocks in parallel,
+/// so unlike \ref meshToDistanceVolume no dense intermediate volume is created;
+/// the voxel with coordinates (x,y,z) in the grid has its center at params.vol.origin + mult( params.vol.voxelSize, Vector3f( x, y, z ) + 0.5 );
+/// dist.maxDistSq must be finite, SignDetectionMode::OpenVDB is not supported
+MRVOXELS_API Expected<VdbVolume> meshToDistanceVdbVolume( const MeshPart& mp, const MeshToDistanceVolumeParams& params = {} );
+
 /// returns a volume filled with the values:
 /// v < 0: this point is within offset distance to region-part of mesh and it is closer to region-part than to not-region-part
 MRVOXELS_API Expected<SimpleVolumeMinMax> meshRegionToIndicatorVolume( const Mesh& mesh, const FaceBitSet& region,
@@ -0,0 +1,397 @@
+#include "MRMillingSimulator.h"
+#include "MRToolPath.h"
+#include "MRMarchingCubes.h"
+#include "MRVoxelsVolume.h"
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRMeshIntersect.h"
+#include "MRMesh/MRLine.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRGTest.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+
+namespace MR
+{
+
+namespace
+{
+
+// the number of cells along each side of a square tile
+constexpr int cTileSize = 64;
+
+// linear movement of the tool tip
+struct Segment
+{
+    Vector3f a, b;
+};
+
+// appends linear segments approximating the arc (helix) from a to b around given center in given plane,
+// so that the segments deviate from the arc by at most eps
+void sampleArc( const Vector3f& a, const Vector3f& b, const Vector3f& center, ArcPlane plane, bool clockwise, float eps,
+    std::vector<Segment>& segments )
+{
+    // indices of two coordinates in the plane of the arc and the coordinate along the axis of the arc (as in GcodeProcessor)
+    int iu = 0, iv = 1, iw = 2;
+    if ( plane == ArcPlane::XZ )
+    {
+        iu = 2; iv = 0; iw = 1;
+    }
+    else if ( plane == ArcPlane::YZ )
+    {
+        iu = 1; iv = 2; iw = 0;
+    }
+    const Vector2f a2( a[iu] - center[iu], a[iv] - center[iv] );
+    const Vector2f b2( b[iu] - center[iu], b[iv] - center[iv] );
+    const float beginRadius = a2.length();
+    const float endRadius = b2.length();
+
+    float beginAngle = std::atan2( a2.y, a2.x );
+    float endAngle = std::atan2( b2.y, b2.x );
+    if ( clockwise && beginAngle <= endAngle )
+        beginAngle += 2 * PI_F;
+    else if ( !clockwise && endAngle <= beginAngle )
+        endAngle += 2 * PI_F;
+
+    const float r = std::max( beginRadius, endRadius );
+    const float maxStep = r > 2 * eps ? 2 * std::acos( 1 - eps / r ) : PI2_F;
+    const int numSteps = std::max( 1, int( std::ceil( std::abs( endAngle - beginAngle ) / maxStep ) ) );
+    Vector3f prev = a;
+    for ( int i = 1; i <= numSteps; ++i )
+    {
+        Vector3f p = b;
+        if ( i < numSteps )
+        {
+            const float t = float( i ) / numSteps;
+            const float angle = beginAngle + ( endAngle - beginAngle ) * t;
+            const float radius = beginRadius + ( endRadius - beginRadius ) * t;
+            p[iu] = center[iu] + radius * std::cos( angle );
+            p[iv] = center[iv] + radius * std::sin( angle );
+            p[iw] = a[iw] + ( b[iw] - a[iw] ) * t;
+        }
+        segments.push_back( { prev, p } );
+        prev = p;
+    }
+}
+
+// returns the lowest point over q of flat end tool with radius r, which tip moves from a to b, or FLT_MAX if the tool does not pass over q
+float flatToolBottom( const Vector2f& q, const Vector3f& a, const Vector3f& b, float r )
+{
+    // the parameters t in [0,1] where the tool passes over q: |w - t*d|^2 <= r^2
+    const Vector2d w( q.x - a.x, q.y - a.y );
+    const Vector2d d( b.x - a.x, b.y - a.y );
+    const double dd = dot( d, d );
+    const double wd = dot( w, d );
+    const double c = dot( w, w ) - sqr( double( r ) );
+    if ( dd <= 0 )
+        return c <= 0 ? std::min( a.z, b.z ) : FLT_MAX;
+    const double disc = wd * wd - dd * c;
+    if ( disc < 0 )
+        return FLT_MAX;
+    const double sqrtDisc = std::sqrt( disc );
+    const double t0 = std::max( 0.0, ( wd - sqrtDisc ) / dd );
+    const double t1 = std::min( 1.0, ( wd + sqrtDisc ) / dd );
+    if ( t0 > t1 )
+        return FLT_MAX;
+    // the height changes linearly along the segment, so the minimum is on one of the ends of the interval
+    return float( a.z + ( b.z - a.z ) * ( b.z > a.z ? t0 : t1 ) );
+}
+
+// returns the lowest point over q of ball end tool with radius r, which tip moves from a to b, or FLT_MAX if the tool does not pass over q;
+// the swept volume is the capsule around the segment of ball centers, which is the union of two balls and the cylinder between them
+float ballToolBottom( const Vector2f& q, const Vector3f& a, const Vector3f& b, float r )
+{
+    const double rr = sqr( double( r ) );
+    double res = DBL_MAX;
+    for ( const auto& c : { a, b } )
+    {
+        const double d2 = sqr( double( q.x ) - c.x ) + sqr( double( q.y ) - c.y );
+        if ( d2 <= rr )
+            res = std::min( res, c.z + r - std::sqrt( rr - d2 ) );
+    }
+
+    // points (q, z) at distance r from the line of ball centers: solve quadratic equation in s = z - centerA.z
+    const Vector3d d( Vector3f( b - a ) );
+    const double dxy2 = sqr( d.x ) + sqr( d.y );
+    if ( dxy2 > 0 )
+    {
+        const double l2 = dxy2 + sqr( d.z );
+        const Vector2d wxy( double( q.x ) - a.x, double( q.y ) - a.y );
+        const double k = wxy.x * d.x + wxy.y * d.y;
+        const double halfB = -k * d.z;
+        const double c = l2 * dot( wxy, wxy ) - k * k - rr * l2;
+        const double disc = halfB * halfB - dxy2 * c;
+        if ( disc >= 0 )
+        {
+            const double s = ( -halfB - std::sqrt( disc ) ) / dxy2;
+            // the position of the lowest point projected on the segment must be inside it
+            const double t = ( k + s * d.z ) / l2;
+            if ( t >= 0 && t <= 1 )
+                res = std::min( res, a.z + r + s );
+        }
+    }
+    return res < FLT_MAX ? float( res ) : FLT_MAX;
+}
+
+} // anonymous namespace
+
+MillingSimulator::MillingSimulator( const Box3f& stock, const MillingSimulatorParams& params )
+    : stock_( stock )
+    , params_( params )
+    , toolPos_( params.startPosition )
+    , arcPlane_( ArcPlane::XY )
+{
+    assert( params_.voxelSize > 0 );
+    const auto size = stock_.size();
+    dims_.x = std::max( 1, int( std::ceil( size.x / params_.voxelSize ) ) );
+    dims_.y = std::max( 1, int( std::ceil( size.y / params_.voxelSize ) ) );
+    tileDims_.x = ( dims_.x + cTileSize - 1 ) / cTileSize;
+    tileDims_.y = ( dims_.y + cTileSize - 1 ) / cTileSize;
+    tiles_.resize( size_t( tileDims_.x ) * tileDims_.y );
+}
+
+Expected<void> MillingSimulator::apply( const std::vector<GCommand>& commands, ProgressCallback cb )
+{
+    MR_TIMER
+
+    // tool positions depend on all previous commands
+    std::vector<Segment> segments;
+    segments.reserve( commands.size() );
+    for ( const auto& command : commands )
+    {
+        if ( command.arcPlane != ArcPlane::None )
+        {
+            arcPlane_ = command.arcPlane;
+            continue;
+        }
+        Vector3f target = toolPos_;
+        if ( !std::isnan( command.x ) )
+            target.x = command.x;
+        if ( !std::isnan( command.y ) )
+            target.y = command.y;
+        if ( !std::isnan( command.z ) )
+            target.z = command.z;
+
+        if ( command.type == MoveType::FastLinear || command.type == MoveType::Linear )
+            segments.push_back( { toolPos_, target } );
+        else if ( command.type == MoveType::ArcCW || command.type == MoveType::ArcCCW )
+        {
+            Vector3f center = toolPos_;
+            for ( int i = 0; i < 3; ++i )
+                if ( !std::isnan( command.arcCenter[i] ) )
+                    center[i] += command.arcCenter[i];
+            sampleArc( toolPos_, target, center, arcPlane_, command.type == MoveType::ArcCW, 0.1f * params_.voxelSize, segments );
+        }
+        toolPos_ = target;
+    }
+    if ( !reportProgress( cb, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    const float r = params_.millRadius;
+    const float invVoxelSize = 1 / params_.voxelSize;
+    // returns the range of cells with centers within the XY-box of the swept tool, the range is empty if the tool is above the stock
+    auto segmentCells = [&] ( const Segment& s, Vector2i& cell0, Vector2i& cell1 )
+    {
+        if ( std::min( s.a.z, s.b.z ) >= stock_.max.z )
+            return false;
+        cell0.x = std::max( 0, int( std::ceil( ( std::min( s.a.x, s.b.x ) - r - stock_.min.x ) * invVoxelSize - 0.5f ) ) );
+        cell0.y = std::max( 0, int( std::ceil( ( std::min( s.a.y, s.b.y ) - r - stock_.min.y ) * invVoxelSize - 0.5f ) ) );
+        cell1.x = std::min( dims_.x - 1, int( std::floor( ( std::max( s.a.x, s.b.x ) + r - stock_.min.x ) * invVoxelSize - 0.5f ) ) );
+        cell1.y = std::min( dims_.y - 1, int( std::floor( ( std::max( s.a.y, s.b.y ) + r - stock_.min.y ) * invVoxelSize - 0.5f ) ) );
+        return cell0.x <= cell1.x && cell0.y <= cell1.y;
+    };
+
+    // counting sort of segments by tiles
+    const size_t numTiles = tiles_.size();
+    auto forEachTile = [&] ( size_t i, auto&& tileFunc )
+    {
+        Vector2i cell0, cell1;
+        if ( !segmentCells( segments[i], cell0, cell1 ) )
+            return;
+        for ( int y = cell0.y / cTileSize; y <= cell1.y / cTileSize; ++y )
+            for ( int x = cell0.x / cTileSize; x <= cell1.x / cTileSize; ++x )
+                tileFunc( size_t( y ) * tileDims_.x + x );
+    };
+    std::vector<std::atomic<int>> tilePos( numTiles );
+    ParallelFor( segments, [&] ( size_t i )
+    {
+        forEachTile( i, [&] ( size_t t ) { tilePos[t].fetch_add( 1, std::memory_order_relaxed ); } );
+    } );
+    std::vector<int> tileBegin( numTiles + 1 );
+    for ( size_t t = 0; t < numTiles; ++t )
+    {
+        tileBegin[t + 1] = tileBegin[t] + tilePos[t].load( std::memory_order_relaxed );
+        tilePos[t].store( tileBegin[t], std::memory_order_relaxed );
+    }
+    std::vector<int> tileSegments( tileBegin.back() );
+    ParallelFor( segments, [&] ( size_t i )
+    {
+        forEachTile( i, [&] ( size_t t ) { tileSegments[tilePos[t].fetch_add( 1, std::memory_order_relaxed )] = int( i ); } );
+    } );
+    if ( !reportProgress( cb, 0.2f ) )
+        return unexpectedOperationCanceled();
+
+    // each tile is modified by one thread, and the result does not depend on the order of segments
+    const auto toolBottom = params_.flatTool ? flatToolBottom : ballToolBottom;
+    const bool completed = ParallelFor( size_t( 0 ), numTiles, [&] ( size_t t )
+    {
+        if ( tileBegin[t] == tileBegin[t + 1] )
+            return;
+        auto& tile = tiles_[t];
+        if ( tile.empty() )
+            tile.resize( cTileSize * cTileSize, stock_.max.z );
+        const Vector2i tileOrg( int( t % tileDims_.x ) * cTileSize, int( t / tileDims_.x ) * cTileSize );
+        for ( int i = tileBegin[t]; i < tileBegin[t + 1]; ++i )
+        {
+            const auto& s = segments[tileSegments[i]];
+            Vector2i cell0, cell1;
+            segmentCells( s, cell0, cell1 );
+            cell0.x = std::max( cell0.x, tileOrg.x );
+            cell0.y = std::max( cell0.y, tileOrg.y );
+            cell1.x = std::min( cell1.x, tileOrg.x + cTileSize - 1 );
+            cell1.y = std::min( cell1.y, tileOrg.y + cTileSize - 1 );
+            for ( int y = cell0.y; y <= cell1.y; ++y )
+            {
+                for ( int x = cell0.x; x <= cell1.x; ++x )
+                {
+                    auto& h = tile[( y - tileOrg.y ) * cTileSize + x - tileOrg.x];
+                    h = std::min( h, toolBottom( cellCenter( { x, y } ), s.a, s.b, r ) );
+                }
+            }
+        }
+    }, subprogress( cb, 0.2f, 1.0f ) );
+    if ( !completed )
+        return unexpectedOperationCanceled();
+    return {};
+}
+
+float MillingSimulator::height( const Vector2i& cell ) const
+{
+    const auto& tile = tiles_[size_t( cell.y / cTileSize ) * tileDims_.x + cell.x / cTileSize];
+    if ( tile.empty() )
+        return stock_.max.z;
+    return tile[( cell.y % cTileSize ) * cTileSize + cell.x % cTileSize];
+}
+
+size_t MillingSimulator::numAllocatedTiles() const
+{
+    return std::count_if( tiles_.begin(), tiles_.end(), [] ( const auto& tile ) { return !tile.empty(); } );
+}
+
+Expected<Mesh> MillingSimulator::computeStockMesh( ProgressCallback cb ) const
+{
+    MR_TIMER
+    const float voxelSize = params_.voxelSize;
+    const int numLayers = std::max( 1, int( std::ceil( ( stock_.max.z - stock_.min.z ) / voxelSize ) ) );
+    // one layer of voxels around the cells to close the surface,
+    // the centers of cells are in the voxels with coordinates from 1 to dims
+    const Vector3f origin = stock_.min - Vector3f::diagonal( 0.5f * voxelSize );
+    FunctionVolume volume
+    {
+        .dims = { dims_.x + 2, dims_.y + 2, numLayers + 2 },
+        .voxelSize = Vector3f::diagonal( voxelSize )
+    };
+    volume.data = [this, origin, voxelSize] ( const Vector3i& v )
+    {
+        const Vector3f p = origin + Vector3f( v ) * voxelSize;
+        const Vector2i cell( std::clamp( v.x - 1, 0, dims_.x - 1 ), std::clamp( v.y - 1, 0, dims_.y - 1 ) );
+        // negative inside the stock, and approximately equal to the distance to the nearest side
+        return std::max( { p.z - height( cell ), stock_.min.z - p.z,
+            stock_.min.x - p.x, p.x - stock_.max.x, stock_.min.y - p.y, p.y - stock_.max.y } );
+    };
+    // marching cubes places the voxel with integer coordinates v in origin + ( v + 0.5 ) * voxelSize
+    return marchingCubes( volume, { .origin = origin - Vector3f::diagonal( 0.5f * voxelSize ), .cb = cb, .lessInside = true } );
+}
+
+Expected<Mesh> simulateMilling( const Box3f& stock, const std::vector<GCommand>& commands, const MillingSimulatorParams& params,
+    ProgressCallback cb )
+{
+    MR_TIMER
+    MillingSimulator simulator( stock, params );
+    if ( auto res = simulator.apply( commands, subprogress( cb, 0.0f, 0.5f ) ); !res )
+        return unexpected( std::move( res.error() ) );
+    return simulator.computeStockMesh( subprogress( cb, 0.5f, 1.0f ) );
+}
+
+TEST( MRMesh, MillingSimulator )
+{
+    const Box3f stock( { 0, 0, 0 }, { 10, 10, 5 } );
+    const float voxelSize = 0.05f;
+    const float r = 1;
+
+    // straight slot along X at the middle of the stock and the half of the circle around the center
+    const std::vector<GCommand> commands =
+    {
+        { .type = MoveType::FastLinear, .x = -2, .y = 5, .z = 10 },
+        { .z = 4 },
+        { .x = 12 },
+        { .type = MoveType::FastLinear, .z = 10 },
+        { .type = MoveType::FastLinear, .x = 8, .y = 5 },
+        { .z = 3 },
+        { .type = MoveType::ArcCCW, .x = 2, .arcCenter = { -3, 0, 0 } },
+        { .type = MoveType::FastLinear, .z = 10 }
+    };
+    for ( bool flatTool : { true, false } )
+    {
+        MillingSimulator simulator( stock, { .millRadius = r, .flatTool = flatTool, .voxelSize = voxelSize, .startPosition = { 0, 0, 10 } } );
+        EXPECT_EQ( simulator.dims(), Vector2i( 200, 200 ) );
+        EXPECT_TRUE( simulator.apply( commands ).has_value() );
+        EXPECT_EQ( simulator.toolPosition(), Vector3f( 2, 5, 10 ) );
+        EXPECT_LT( simulator.numAllocatedTiles(), 16 );
+
+        double heightsVolume = 0;
+        for ( int y = 0; y < simulator.dims().y; ++y )
+        {
+            for ( int x = 0; x < simulator.dims().x; ++x )
+            {
+                const auto h = simulator.height( { x, y } );
+                heightsVolume += sqr( voxelSize ) * std::clamp( h - stock.min.z, 0.f, stock.size().z );
+
+                // distances from the cell to the slot and to the arc
+                const auto c = simulator.cellCenter( { x, y } );
+                const float slotDist = std::abs( c.y - 5 );
+                const float arcDist = c.y >= 5 ? std::abs( ( c - Vector2f( 5, 5 ) ).length() - 3 )
+                    : std::min( ( c - Vector2f( 8, 5 ) ).length(), ( c - Vector2f( 2, 5 ) ).length() );
+                // skip the cells near the boundaries of cuts, where the heights are most sensitive to the approximation of the arc by segments
+                if ( std::abs( slotDist - r ) < 0.01f || std::abs( arcDist - r ) < 0.1f )
+                    continue;
+                float expected = stock.max.z;
+                if ( slotDist <= r )
+                    expected = std::min( expected, flatTool ? 4.f : 5.f - std::sqrt( sqr( r ) - sqr( slotDist ) ) );
+                if ( arcDist <= r )
+                    expected = std::min( expected, flatTool ? 3.f : 4.f - std::sqrt( sqr( r ) - sqr( arcDist ) ) );
+                EXPECT_NEAR( h, expected, 0.02f );
+            }
+        }
+
+        auto mesh = simulator.computeStockMesh();
+        ASSERT_TRUE( mesh.has_value() );
+        EXPECT_TRUE( mesh->topology.findHoleRepresentiveEdges().empty() );
+        EXPECT_NEAR( mesh->volume(), heightsVolume, 0.01 * heightsVolume );
+
+        // the mesh is located exactly where the stock and the heights are
+        const auto box = mesh->computeBoundingBox();
+        for ( int i = 0; i < 3; ++i )
+        {
+            EXPECT_NEAR( box.min[i], stock.min[i], 1e-3f );
+            EXPECT_NEAR( box.max[i], stock.max[i], 1e-3f );
+        }
+        const std::pair<Vector2f, float> samples[] =
+        {
+            { { 2.01f, 2.01f }, 5.f }, // untouched stock
+            { { 0.51f, 5.01f }, 4.f }, // the middle of the slot
+            { { 5.01f, 5.01f }, 4.f },
+            { { 5.01f, 7.99f }, 3.f }  // the middle of the arc
+        };
+        for ( const auto& [xy, z] : samples )
+        {
+            const auto isec = rayMeshIntersect( *mesh, Line3f( Vector3f( xy.x, xy.y, 10 ), Vector3f( 0, 0, -1 ) ) );
+            ASSERT_TRUE( isec );
+            EXPECT_NEAR( isec.proj.point.z, z, 0.01f );
+        }
+    }
+}
+
+} //namespace MR
@@ -0,0 +1,76 @@
+#pragma once
+#include "MRVoxelsFwd.h"
+
+#include "MRMesh/MRBox.h"
+#include "MRMesh/MRVector2.h"
+#include "MRMesh/MRProgressCallback.h"
+#include "MRMesh/MRExpected.h"
+#include <vector>
+
+namespace MR
+{
+
+struct GCommand;
+enum class ArcPlane;
+
+struct MillingSimulatorParams
+{
+    // radius of the milling tool
+    float millRadius = {};
+    // if true then the tool has flat end, otherwise ball end
+    bool flatTool = false;
+    // size of stock cells in XY-plane, and the size of voxels for the extraction of the stock surface
+    float voxelSize = {};
+    // position of the tool tip before the first command, e.g. CNCMachineSettings::getHomePosition()
+    Vector3f startPosition;
+};
+
+// simulates material removal from the stock by 3-axis milling tool moving along given tool paths (with vertical tool axis);
+// the stock is represented by vertical dexels: each cell in XY-plane keeps the height of remaining material,
+// the cells are grouped in tiles, which are allocated only when the tool reaches them
+class MillingSimulator
+{
+public:
+    // creates the simulator with initial stock in the form of given box
+    MRVOXELS_API MillingSimulator( const Box3f& stock, const MillingSimulatorParams& params );
+
+    // removes the material swept by the tool moving by given commands starting from current tool position;
+    // the commands are converted in linear segments (arcs are sampled with the precision of small fraction of voxel size) sequentially,
+    // then the segments are subtracted from the tiles of the stock in parallel
+    MRVOXELS_API Expected<void> apply( const std::vector<GCommand>& commands, ProgressCallback cb = {} );
+
+    // returns the number of cells along X and Y
+    [[nodiscard]] const Vector2i& dims() const { return dims_; }
+
+    // returns the center of given cell in XY-plane
+    [[nodiscard]] Vector2f cellCenter( const Vector2i& cell ) const
+        { return { stock_.min.x + ( cell.x + 0.5f ) * params_.voxelSize, stock_.min.y + ( cell.y + 0.5f ) * params_.voxelSize }; }
+
+    // returns the height of remaining material in given cell
+    [[nodiscard]] MRVOXELS_API float height( const Vector2i& cell ) const;
+
+    // returns the position of the tool tip after the last applied command
+    [[nodiscard]] const Vector3f& toolPosition() const { return toolPos_; }
+
+    // returns the number of tiles with heights changed by the tool
+    [[nodiscard]] MRVOXELS_API size_t numAllocatedTiles() const;
+
+    // extracts the surface of remaining stock using marching cubes
+    [[nodiscard]] MRVOXELS_API Expected<Mesh> computeStockMesh( ProgressCallback cb = {} ) const;
+
+private:
+    Box3f stock_;
+    MillingSimulatorParams params_;
+    Vector2i dims_;
+    Vector2i tileDims_;
+    // heights of cells in each tile, empty vector means untouched tile with the height of initial stock
+    std::vector<std::vector<float>> tiles_;
+    Vector3f toolPos_;
+    ArcPlane arcPlane_; // current plane of arcs
+};
+
+// simulates material removal from given stock by the tool moving by given commands, and returns the surface of remaining stock
+MRVOXELS_API Expected<Mesh> simulateMilling( const Box3f& stock, const std::vector<GCommand>& commands, const MillingSimulatorParams& params,
+    ProgressCallback cb = {} );
+
+}
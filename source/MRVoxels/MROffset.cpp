@@ -3,7 +3,9 @@
 #include "MRFloatGrid.h"
 #include "MRVDBConversions.h"
 #include "MRMarchingCubes.h"
+#include "MRDualContouring.h"
 #include "MRMeshToDistanceVolume.h"
+#include "MRVoxelsConversionsByParts.h"
 #include "MRMesh/MRMesh.h"
 #include "MRMesh/MRBox.h"
 #include "MRMesh/MRTimer.h"
@@ -17,6 +19,9 @@
 #include "MRMesh/MRMeshFixer.h"
 #include "MRMesh/MRBitSetParallelFor.h"
 #include "MRMesh/MRRingIterator.h"
+#include "MRMesh/MRTorus.h"
+#include "MRMesh/MRCube.h"
+#include "MRMesh/MRGTest.h"
 
 namespace MR
 {
@@ -187,6 +192,68 @@ Expected<Mesh> mcOffsetMesh( const MeshPart& mp, float offset,
     }
 }
 
+Expected<Mesh> mcOffsetMeshByParts( const MeshPart& mp, float offset, const OffsetParameters& params,
+    size_t maxMemoryUsage, size_t maxParallelParts )
+{
+    MR_TIMER;
+    if ( params.voxelSize <= 0 )
+    {
+        assert( false );
+        return unexpected( "wrong voxelSize" );
+    }
+
+    MeshToDistanceVolumeParams msParams;
+    auto absOffset = std::abs( offset );
+    const auto box = mp.mesh.computeBoundingBox( mp.region ).expanded( Vector3f::diagonal( absOffset ) );
+    const auto [origin, dimensions] = calcOriginAndDimensions( box, params.voxelSize );
+    msParams.vol.voxelSize = Vector3f::diagonal( params.voxelSize );
+    msParams.dist.maxDistSq = sqr( absOffset + 1.001f * params.voxelSize ); // we multiply by 1.001f to be sure not to have rounding errors (which may lead to unexpected NaN values )
+    msParams.dist.minDistSq = sqr( std::max( absOffset - 1.001f * params.voxelSize, 0.0f ) ); // we multiply by 1.001f to be sure not to have rounding errors (which may lead to unexpected NaN values )
+    msParams.dist.signMode = params.signDetectionMode;
+    // flood filling of one stripe cannot find the sign, winding numbers are computed only for whole mesh
+    if ( msParams.dist.signMode == SignDetectionMode::OpenVDB )
+        msParams.dist.signMode = mp.region ? SignDetectionMode::ProjectionNormal : SignDetectionMode::HoleWindingRule;
+    msParams.dist.windingNumberThreshold = params.windingNumberThreshold;
+    msParams.dist.windingNumberBeta = params.windingNumberBeta;
+    msParams.fwn = params.fwn;
+    if ( msParams.dist.signMode == SignDetectionMode::HoleWindingRule )
+    {
+        if ( mp.region )
+            return unexpected( "HoleWindingRule sign detection supports only whole mesh" );
+        // build fast winding number structure once and share it among all stripes
+        if ( !msParams.fwn )
+            msParams.fwn = std::make_shared<FastWindingNumber>( mp.mesh );
+    }
+
+    VolumeToMeshByPartsSettings byPartsSettings;
+    // custom fast winding number implementation (e.g. CUDA) is not required to be thread-safe
+    byPartsSettings.maxParallelParts = params.fwn ? 1 : std::max( maxParallelParts, size_t( 1 ) );
+    // reduce the number of parallel stripes until each one gets the memory for several slices in addition to the overlap
+    const auto sliceMemoryUsage = size_t( dimensions.y ) * size_t( dimensions.z ) * sizeof( float );
+    const auto minPartMemoryUsage = 2 * ( byPartsSettings.stripeOverlap + 1 ) * sliceMemoryUsage;
+    while ( byPartsSettings.maxParallelParts > 1 && maxMemoryUsage / byPartsSettings.maxParallelParts < minPartMemoryUsage )
+        byPartsSettings.maxParallelParts /= 2;
+    byPartsSettings.maxVolumePartMemoryUsage = maxMemoryUsage / byPartsSettings.maxParallelParts;
+    byPartsSettings.progressCallback = params.callBack;
+
+    VolumePartBuilder<SimpleVolumeMinMax> builder = [&] ( int begin, int end, std::optional<Vector3i>& partOffset )
+    {
+        auto partParams = msParams;
+        partParams.vol.origin = origin + Vector3f( begin * params.voxelSize, 0.0f, 0.0f );
+        partParams.vol.dimensions = Vector3i( end - begin, dimensions.y, dimensions.z );
+        partOffset = Vector3i( begin, 0, 0 );
+        return meshToDistanceVolume( mp, partParams );
+    };
+
+    MergeVolumePartSettings mergeSettings;
+    mergeSettings.iso = offset;
+
+    auto res = volumeToMeshByParts( builder, dimensions, msParams.vol.voxelSize, byPartsSettings, mergeSettings );
+    if ( res )
+        res->transform( AffineXf3f::translation( origin ) );
+    return res;
+}
+
 Expected<Mesh> mcShellMeshRegion( const Mesh& mesh, const FaceBitSet& region, float offset,
     const BaseShellParameters& params, Vector<VoxelId, FaceId> * outMap )
 {
@@ -244,6 +311,64 @@ Expected<Mesh> sharpOffsetMesh( const MeshPart& mp, float offset, const SharpOff
     return res;
 }
 
+Expected<Mesh> dcOffsetMesh( const MeshPart& mp, float offset, const DcOffsetParameters& params )
+{
+    MR_TIMER
+    auto meshToLSCb = subprogress( params.callBack, 0.0f, 0.4f );
+    // the values must be valid in the corners and in the middles of the cells to be merged
+    const float bandInVoxels = float( std::max( params.maxCellSize, 1 ) + 1 );
+
+    DualContouringParams dcParams;
+    dcParams.iso = offset;
+    dcParams.lessInside = true;
+    dcParams.cb = subprogress( params.callBack, 0.4f, 1.0f );
+    dcParams.maxError = params.maxError * params.voxelSize;
+    dcParams.maxCellSize = params.maxCellSize;
+
+    if ( params.signDetectionMode == SignDetectionMode::OpenVDB )
+    {
+        auto offsetInVoxels = offset / params.voxelSize;
+        auto voxelRes = meshToLevelSet( mp, AffineXf3f(),
+            Vector3f::diagonal( params.voxelSize ),
+            std::abs( offsetInVoxels ) + bandInVoxels, meshToLSCb );
+        if ( !voxelRes )
+            return unexpectedOperationCanceled();
+
+        VdbVolume volume = floatGridToVdbVolume( std::move( voxelRes ) );
+        volume.voxelSize = Vector3f::diagonal( params.voxelSize );
+        dcParams.iso = offsetInVoxels;
+        return dualContouring( volume, dcParams );
+    }
+
+    const bool funcVolume = !params.fwn && params.memoryEfficient;
+    MeshToDistanceVolumeParams msParams;
+    if ( !funcVolume )
+        msParams.vol.cb = meshToLSCb;
+    auto absOffset = std::abs( offset );
+    const auto box = mp.mesh.computeBoundingBox( mp.region ).expanded( Vector3f::diagonal( absOffset ) );
+    const auto [origin, dimensions] = calcOriginAndDimensions( box, params.voxelSize );
+    msParams.vol.origin = origin;
+    msParams.vol.voxelSize = Vector3f::diagonal( params.voxelSize );
+    msParams.vol.dimensions = dimensions;
+    msParams.dist.maxDistSq = sqr( absOffset + bandInVoxels * params.voxelSize );
+    msParams.dist.minDistSq = sqr( std::max( absOffset - bandInVoxels * params.voxelSize, 0.0f ) );
+    msParams.dist.signMode = params.signDetectionMode;
+    msParams.dist.windingNumberThreshold = params.windingNumberThreshold;
+    msParams.dist.windingNumberBeta = params.windingNumberBeta;
+    msParams.fwn = params.fwn;
+
+    dcParams.origin = msParams.vol.origin;
+    if ( funcVolume )
+    {
+        dcParams.cb = params.callBack;
+        return dualContouring( meshToDistanceFunctionVolume( mp, msParams ), dcParams );
+    }
+    return meshToDistanceVolume( mp, msParams ).and_then( [&dcParams] ( SimpleVolumeMinMax&& volume )
+    {
+        return dualContouring( volume, dcParams );
+    } );
+}
+
 Expected<Mesh> generalOffsetMesh( const MeshPart& mp, float offset, const GeneralOffsetParameters& params )
 {
     switch( params.mode )
@@ -257,6 +382,14 @@ Expected<Mesh> generalOffsetMesh( const MeshPart& mp, float offset, const Genera
         return mcOffsetMesh( mp, offset, params );
     case GeneralOffsetParameters::Mode::Sharpening:
         return sharpOffsetMesh( mp, offset, params );
+    case GeneralOffsetParameters::Mode::DualContouring:
+    {
+        DcOffsetParameters dcParams;
+        static_cast<OffsetParameters&>( dcParams ) = params;
+        dcParams.maxError = params.dcMaxError;
+        dcParams.maxCellSize = params.dcMaxCellSize;
+        return dcOffsetMesh( mp, offset, dcParams );
+    }
     }
 }
 
@@ -349,4 +482,74 @@ Expected<Mesh> offsetPolyline( const Polyline3& polyline, float offset, const Of
     return offsetMesh( mesh, offset, p );
 }
 
+TEST( MRMesh, mcOffsetMeshByParts )
+{
+    const auto mesh = makeTorus( 1.0f, 0.3f, 32, 16 );
+    const float offset = 0.1f;
+
+    OffsetParameters params;
+    params.voxelSize = 0.0625f;
+    params.signDetectionMode = SignDetectionMode::HoleWindingRule;
+    params.memoryEfficient = false;
+    auto ref = mcOffsetMesh( mesh, offset, params );
+    ASSERT_TRUE( ref.has_value() );
+
+    // the memory for about 12 slices of the volume in each of two parts produces several stripes
+    const auto box = mesh.computeBoundingBox().expanded( Vector3f::diagonal( offset ) );
+    const auto dims = calcOriginAndDimensions( box, params.voxelSize ).dimensions;
+    const auto sliceMemoryUsage = size_t( dims.y ) * size_t( dims.z ) * sizeof( float );
+    auto res = mcOffsetMeshByParts( mesh, offset, params, 24 * sliceMemoryUsage, 2 );
+    ASSERT_TRUE( res.has_value() );
+
+    EXPECT_EQ( res->topology.numValidVerts(), ref->topology.numValidVerts() );
+    EXPECT_EQ( res->topology.numValidFaces(), ref->topology.numValidFaces() );
+    EXPECT_TRUE( res->topology.isClosed() );
+    EXPECT_NEAR( res->volume(), ref->volume(), 1e-3 * ref->volume() );
+
+    // the sign by winding number is computed only for whole mesh
+    const auto region = mesh.topology.getValidFaces();
+    EXPECT_FALSE( mcOffsetMeshByParts( { mesh, &region }, offset, params, 24 * sliceMemoryUsage, 2 ).has_value() );
+
+    // default OpenVDB mode is replaced with ProjectionNormal for mesh region
+    params.signDetectionMode = SignDetectionMode::OpenVDB;
+    res = mcOffsetMeshByParts( { mesh, &region }, offset, params, 24 * sliceMemoryUsage, 2 );
+    ASSERT_TRUE( res.has_value() );
+    EXPECT_TRUE( res->topology.isClosed() );
+    EXPECT_NEAR( res->volume(), ref->volume(), 1e-2 * ref->volume() );
+}
+
+TEST( MRMesh, DcOffsetMesh )
+{
+    // inner offset of unit cube is the cube with sharp corners at (+-0.4, +-0.4, +-0.4)
+    const auto mesh = makeCube();
+    const float offset = -0.1f;
+
+    for ( auto signMode : { SignDetectionMode::OpenVDB, SignDetectionMode::HoleWindingRule } )
+    {
+        GeneralOffsetParameters params;
+        params.voxelSize = 0.05f;
+        params.signDetectionMode = signMode;
+        params.memoryEfficient = false; // HoleWindingRule is computed in SimpleVolume
+        auto mc = mcOffsetMesh( mesh, offset, params );
+        ASSERT_TRUE( mc.has_value() );
+
+        params.mode = GeneralOffsetParameters::Mode::DualContouring;
+        auto dc = generalOffsetMesh( mesh, offset, params );
+        ASSERT_TRUE( dc.has_value() );
+
+        EXPECT_TRUE( dc->topology.isClosed() );
+        EXPECT_LT( dc->topology.numValidFaces(), mc->topology.numValidFaces() );
+
+        // each corner is reconstructed by a vertex of dual contouring mesh within the accuracy of voxel sampling
+        for ( int i = 0; i < 8; ++i )
+        {
+            const Vector3f corner( i & 1 ? 0.4f : -0.4f, i & 2 ? 0.4f : -0.4f, i & 4 ? 0.4f : -0.4f );
+            float minDist = FLT_MAX;
+            for ( auto v : dc->topology.getValidVerts() )
+                minDist = std::min( minDist, ( dc->points[v] - corner ).length() );
+            EXPECT_LT( minDist, 0.75f * params.voxelSize );
+        }
+    }
+}
+
 }
@@ -82,6 +82,17 @@ struct SharpOffsetParameters : OffsetParameters
 [[nodiscard]] MRVOXELS_API Expected<Mesh> mcOffsetMesh( const MeshPart& mp, float offset,
     const OffsetParameters& params = {}, Vector<VoxelId, FaceId>* outMap = nullptr );
 
+/// Offsets mesh as \ref mcOffsetMesh, but without building the voxel volume for the whole mesh:
+/// the volume is split on overlapping stripes along X axis, distances and marching cubes are computed for several stripes in parallel,
+/// and the stripe meshes are merged exactly along the cuts in the middle of the overlaps (see \ref volumeToMeshByParts);
+/// SignDetectionMode::OpenVDB is replaced with SignDetectionMode::HoleWindingRule for whole mesh and with SignDetectionMode::ProjectionNormal for mesh region,
+/// since flood filling of one stripe cannot find the sign; explicitly requested SignDetectionMode::HoleWindingRule fails for mesh region;
+/// \param maxMemoryUsage the upper limit of memory amount used by all simultaneously existing voxel stripes
+/// \param maxParallelParts the maximal number of stripes processed in parallel, the memory is divided equally between them;
+/// it can be reduced if the memory is not enough, but the result never depends on the number of hardware threads
+[[nodiscard]] MRVOXELS_API Expected<Mesh> mcOffsetMeshByParts( const MeshPart& mp, float offset, const OffsetParameters& params = {},
+    size_t maxMemoryUsage = size_t( 1 ) << 30, size_t maxParallelParts = 8 );
+
 /// Constructs a shell around selected mesh region with the properties that every point on the shall must
 ///  1. be located not further than given distance from selected mesh part,
 ///  2. be located not closer to not-selected mesh part than to selected mesh part.
@@ -92,14 +103,31 @@ struct SharpOffsetParameters : OffsetParameters
 /// post process result using reference mesh to sharpen features
 [[nodiscard]] MRVOXELS_API Expected<Mesh> sharpOffsetMesh( const MeshPart& mp, float offset, const SharpOffsetParameters& params = {} );
 
+struct DcOffsetParameters : OffsetParameters
+{
+    /// maximal root-mean-square distance from the vertex of merged cell to the tangent planes of offset surface inside it, measured in voxelSize
+    float maxError = 1.0f / 25;
+    /// maximal size of merged cell in voxels
+    int maxCellSize = 16;
+};
+
+/// Offsets mesh by converting it to distance field in voxels (as in \ref mcOffsetMesh)
+/// and back using adaptive Dual Contouring, which recovers sharp features and produces much less triangles in flat regions,
+/// so neither post-processing as in \ref sharpOffsetMesh nor decimation is necessary
+[[nodiscard]] MRVOXELS_API Expected<Mesh> dcOffsetMesh( const MeshPart& mp, float offset, const DcOffsetParameters& params = {} );
+
 /// allows the user to select in the parameters which offset algorithm to call
 struct GeneralOffsetParameters : SharpOffsetParameters
 {
     using Mode = MR::OffsetMode;
     Mode mode = Mode::Standard;
+    /// maximal error of merged cells in Mode::DualContouring, see DcOffsetParameters::maxError
+    float dcMaxError = 1.0f / 25;
+    /// maximal size of merged cell in Mode::DualContouring, see DcOffsetParameters::maxCellSize
+    int dcMaxCellSize = 16;
 };
 
-/// Offsets mesh by converting it to voxels and back using one of three modes specified in the parameters
+/// Offsets mesh by converting it to voxels and back using one of four modes specified in the parameters
 [[nodiscard]] MRVOXELS_API Expected<Mesh> generalOffsetMesh( const MeshPart& mp, float offset, const GeneralOffsetParameters& params );
 
 /// in case of positive offset, returns the mesh consisting of offset mesh merged with inversed original mesh (thickening mode);
@@ -1145,6 +1145,8 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
     auto sp = subprogress( cb, 4.0f / 16, 1.0f );
     for ( int p = 0; p <= power; ++p )
     {
+        // only the last level is processed in one thread, which can report progress and be canceled in the middle
+        bool canceled = false;
         tbb::parallel_for( tbb::blocked_range<size_t>( 0, parts.size() ), [&]( const tbb::blocked_range<size_t>& range )
         {
             for ( size_t i = range.begin(); i < range.end(); ++i )
@@ -1159,18 +1161,22 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
                 VoxelGraphCut::Context context
                 {
                     .span = part.span,
-                    .stat = part.stat
+                    .stat = part.stat,
+                    .cb = parts.size() == 1 ? subprogress( sp, float( p ) / ( power + 1 ), 1.0f ) : ProgressCallback{}
                 };
                 if ( parts.size() > 1 )
                     vgc.cutOutOfSpanNeiNeighbors( context );
                 vgc.buildForest( context, parts.size() == numSubtasks );
-                vgc.segment( context );
+                if ( !vgc.segment( context ) )
+                    canceled = true;
                 if ( parts.size() > 1 )
                     vgc.restoreCutNeighbor( context );
                 part.stat = context.stat;
                 //part.stat.log( fmt::format( " after [{}, {})", part.span.begin, part.span.end ) );
             }
         } );
+        if ( canceled )
+            return unexpectedOperationCanceled();
         if ( parts.size() <= 1 )
         {
             parts[0].stat.log( " final" );
@@ -1190,7 +1196,7 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
         }
         total.log( fmt::format( " after {} parts", parts.size() ) );
         parts.resize( parts.size() / 2 );
-        if ( !reportProgress( cb, 1.0f / ( power + 1 ) ) )
+        if ( !reportProgress( sp, float( p + 1 ) / ( power + 1 ) ) )
             return unexpectedOperationCanceled();
     }
     //auto cflow = vgc.computeFlow();
@@ -58,10 +58,20 @@ void sortEdgePaths( const Mesh& mesh, std::vector<EdgePath>& paths )
 namespace MR
 {
 
+namespace
+{
+
+/// the mesh generated from a voxel volume part and trimmed by the cut planes, ready to be appended to the result mesh
+struct VolumePartMesh
+{
+    Mesh mesh;
+    std::vector<EdgePath> leftCutContours;
+    std::vector<EdgePath> rightCutContours;
+};
+
 template <typename Volume>
-Expected<void>
-mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume,
-               float leftCutPosition, float rightCutPosition, const MergeVolumePartSettings &settings )
+Expected<VolumePartMesh> makeVolumePartMesh( Volume&& volume, float leftCutPosition, float rightCutPosition,
+    const MergeVolumePartSettings& settings )
 {
     MR_TIMER
 
@@ -70,13 +80,13 @@ mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume
     {
         res = gridToMesh( std::move( volume.data ), GridToMeshSettings {
             .voxelSize = volume.voxelSize,
-            .isoValue = 0.f,
+            .isoValue = settings.iso,
         } );
     }
     else if constexpr ( std::is_same_v<Volume, SimpleVolumeMinMax> )
     {
         res = marchingCubes( volume, {
-            .iso = 0.f,
+            .iso = settings.iso,
             .lessInside = true,
             .freeVolume = [&volume]
             {
@@ -88,7 +98,7 @@ mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume
     else if constexpr ( std::is_same_v<Volume, FunctionVolume> )
     {
         res = marchingCubes( volume, {
-            .iso = 0.f,
+            .iso = settings.iso,
             .lessInside = true
         } );
     }
@@ -98,75 +108,66 @@ mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume
     }
     if ( !res.has_value() )
         return unexpected( res.error() );
-    auto part = std::move( *res );
+
+    VolumePartMesh part;
+    part.mesh = std::move( *res );
 
     if ( settings.origin != Vector3f() )
-        part.transform( AffineXf3f::translation( settings.origin ) );
+        part.mesh.transform( AffineXf3f::translation( settings.origin ) );
 
     if ( settings.preCut )
-        settings.preCut( part, leftCutPosition, rightCutPosition );
+        settings.preCut( part.mesh, leftCutPosition, rightCutPosition );
 
-    std::vector<EdgePath> leftCutContours;
     if ( leftCutPosition != -FLT_MAX )
     {
-        trimWithPlane( part, { .plane = Plane3f { Vector3f::plusX(), leftCutPosition } }, { .outCutContours = &leftCutContours } );
-        sortEdgePaths( part, leftCutContours );
+        trimWithPlane( part.mesh, { .plane = Plane3f { Vector3f::plusX(), leftCutPosition } }, { .outCutContours = &part.leftCutContours } );
+        sortEdgePaths( part.mesh, part.leftCutContours );
     }
 
-    std::vector<EdgePath> rightCutContours;
     if ( rightCutPosition != +FLT_MAX )
     {
-        trimWithPlane( part, { .plane = -Plane3f{Vector3f::plusX(), rightCutPosition } }, { .outCutContours = &rightCutContours } );
-        reverse( rightCutContours );
-        sortEdgePaths( part, rightCutContours );
+        trimWithPlane( part.mesh, { .plane = -Plane3f{Vector3f::plusX(), rightCutPosition } }, { .outCutContours = &part.rightCutContours } );
+        reverse( part.rightCutContours );
+        sortEdgePaths( part.mesh, part.rightCutContours );
     }
 
     if ( settings.postCut )
-        settings.postCut( part );
-
-    auto mapping = settings.mapping;
-    clearPartMapping( mapping );
-
-    if ( leftCutContours.empty() && cutContours.empty() )
-    {
-        WholeEdgeHashMap src2tgtEdges;
-        if ( !mapping.src2tgtEdges )
-            mapping.src2tgtEdges = &src2tgtEdges;
-
-        mesh.addPartByMask( part, part.topology.getValidFaces(), mapping );
-
-        if ( settings.postMerge )
-            settings.postMerge( mesh, mapping );
+        settings.postCut( part.mesh );
 
-        for ( auto& contour : rightCutContours )
-        {
-            for ( auto& e : contour )
-            {
-                const auto ue = ( *mapping.src2tgtEdges )[e];
-                e = e.even() ? ue : ue.sym();
-            }
-        }
-        cutContours = std::move( rightCutContours );
+    return part;
+}
 
-        return {};
-    }
+Expected<void> appendVolumePartMesh( Mesh& mesh, std::vector<EdgePath>& cutContours, VolumePartMesh&& part,
+    const MergeVolumePartSettings& settings )
+{
+    MR_TIMER
 
-    if ( cutContours.size() != leftCutContours.size() )
-        return unexpected( "Mesh cut contours mismatch" );
-    for ( auto i = 0u; i < cutContours.size(); ++i )
-        if ( cutContours[i].size() != leftCutContours[i].size() )
-            return unexpected( "Mesh cut contours mismatch" );
+    auto mapping = settings.mapping;
+    clearPartMapping( mapping );
 
     WholeEdgeHashMap src2tgtEdges;
     if ( !mapping.src2tgtEdges )
         mapping.src2tgtEdges = &src2tgtEdges;
 
-    mesh.addPartByMask( part, part.topology.getValidFaces(), false, cutContours, leftCutContours, mapping );
+    if ( part.leftCutContours.empty() && cutContours.empty() )
+    {
+        mesh.addPartByMask( part.mesh, part.mesh.topology.getValidFaces(), mapping );
+    }
+    else
+    {
+        if ( cutContours.size() != part.leftCutContours.size() )
+            return unexpected( "Mesh cut contours mismatch" );
+        for ( auto i = 0u; i < cutContours.size(); ++i )
+            if ( cutContours[i].size() != part.leftCutContours[i].size() )
+                return unexpected( "Mesh cut contours mismatch" );
+
+        mesh.addPartByMask( part.mesh, part.mesh.topology.getValidFaces(), false, cutContours, part.leftCutContours, mapping );
+    }
 
     if ( settings.postMerge )
         settings.postMerge( mesh, mapping );
 
-    for ( auto& contour : rightCutContours )
+    for ( auto& contour : part.rightCutContours )
     {
         for ( auto& e : contour )
         {
@@ -174,11 +175,27 @@ mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume
             e = e.even() ? ue : ue.sym();
         }
     }
-    cutContours = std::move( rightCutContours );
+    cutContours = std::move( part.rightCutContours );
 
     return {};
 }
 
+} // namespace
+
+template <typename Volume>
+Expected<void>
+mergeVolumePart( Mesh &mesh, std::vector<EdgePath> &cutContours, Volume &&volume,
+               float leftCutPosition, float rightCutPosition, const MergeVolumePartSettings &settings )
+{
+    MR_TIMER
+
+    return makeVolumePartMesh( std::forward<Volume>( volume ), leftCutPosition, rightCutPosition, settings )
+        .and_then( [&] ( VolumePartMesh&& part )
+        {
+            return appendVolumePartMesh( mesh, cutContours, std::move( part ), settings );
+        } );
+}
+
 template <typename Volume>
 Expected<Mesh>
 volumeToMeshByParts( const VolumePartBuilder<Volume> &builder, const Vector3i &dimensions, const Vector3f &voxelSize,
@@ -210,32 +227,56 @@ volumeToMeshByParts( const VolumePartBuilder<Volume> &builder, const Vector3i &d
     const size_t stripeCount = stripeCount_ + size_t( lastStripeSize_ != 0 );
     assert( ( stripeSize - settings.stripeOverlap ) * stripeCount >= width );
 
+    // the stripes are converted into meshes in batches of maxParallelParts, and then appended to the result one by one,
+    // so at most maxParallelParts voxel volume parts exist simultaneously
+    const size_t batchSize = std::max( settings.maxParallelParts, size_t( 1 ) );
+    std::vector<Expected<VolumePartMesh>> parts;
+
     Mesh result;
     std::vector<EdgePath> cutContours;
-    for ( auto stripe = 0; stripe < stripeCount; stripe++ )
+    for ( size_t batchBegin = 0; batchBegin < stripeCount; batchBegin += batchSize )
     {
-        const auto begin = stripe * ( stripeSize - settings.stripeOverlap );
-        const auto end = std::min( begin + stripeSize, (size_t)dimensions.x );
-
-        std::optional<Vector3i> offset;
-        auto volume = builder( (int)begin, (int)end, offset );
-        if ( !volume.has_value() )
-            return unexpected( volume.error() );
-
-        auto mergeOffsetSettings = mergeSettings;
-        if ( offset )
-            mergeOffsetSettings.origin = mult( Vector3f( *offset ), voxelSize );
-
-        auto leftCutPosition = ( (float)begin + (float)settings.stripeOverlap / 2.f ) * voxelSize.x;
-        if ( begin == 0 )
-            leftCutPosition = -FLT_MAX;
-        auto rightCutPosition = ( (float)end - (float)settings.stripeOverlap / 2.f ) * voxelSize.x;
-        if ( end == dimensions.x )
-            rightCutPosition = +FLT_MAX;
-
-        const auto res = mergeVolumePart( result, cutContours, std::move( *volume ), leftCutPosition, rightCutPosition, mergeOffsetSettings );
-        if ( !res.has_value() )
-            return unexpected( res.error() );
+        const auto batchEnd = std::min( batchBegin + batchSize, stripeCount );
+        parts.clear();
+        parts.resize( batchEnd - batchBegin );
+        ParallelFor( batchBegin, batchEnd, [&] ( size_t stripe )
+        {
+            const auto begin = stripe * ( stripeSize - settings.stripeOverlap );
+            const auto end = std::min( begin + stripeSize, (size_t)dimensions.x );
+
+            std::optional<Vector3i> offset;
+            auto volume = builder( (int)begin, (int)end, offset );
+            if ( !volume.has_value() )
+            {
+                parts[stripe - batchBegin] = unexpected( std::move( volume.error() ) );
+                return;
+            }
+
+            auto mergeOffsetSettings = mergeSettings;
+            if ( offset )
+                mergeOffsetSettings.origin = mult( Vector3f( *offset ), voxelSize );
+
+            auto leftCutPosition = ( (float)begin + (float)settings.stripeOverlap / 2.f ) * voxelSize.x;
+            if ( begin == 0 )
+                leftCutPosition = -FLT_MAX;
+            auto rightCutPosition = ( (float)end - (float)settings.stripeOverlap / 2.f ) * voxelSize.x;
+            if ( end == dimensions.x )
+                rightCutPosition = +FLT_MAX;
+
+            parts[stripe - batchBegin] = makeVolumePartMesh( std::move( *volume ), leftCutPosition, rightCutPosition, mergeOffsetSettings );
+        } );
+
+        for ( auto & part : parts )
+        {
+            if ( !part.has_value() )
+                return unexpected( std::move( part.error() ) );
+            const auto res = appendVolumePartMesh( result, cutContours, std::move( *part ), mergeSettings );
+            if ( !res.has_value() )
+                return unexpected( res.error() );
+        }
+
+        if ( !reportProgress( settings.progressCallback, float( batchEnd ) / float( stripeCount ) ) )
+            return unexpectedOperationCanceled();
     }
     return result;
 }
@@ -348,11 +389,19 @@ TEST( MRMesh, volumeToMeshByParts )
     } );
     EXPECT_TRUE( functionMesh.has_value() );
 
+    auto parallelMesh = volumeToMeshByParts( simpleBuilder, dimensions, Vector3f::diagonal( voxelSize ), {
+        .maxVolumePartMemoryUsage = memoryUsage,
+        .maxParallelParts = 4,
+    } );
+    EXPECT_TRUE( parallelMesh.has_value() );
+
     constexpr auto r = radius * voxelSize;
     constexpr auto expectedVolume = 4.f * PI_F * r * r * r / 3.f;
     EXPECT_NEAR( expectedVolume, vdbMesh->volume(), 0.001f );
     EXPECT_NEAR( expectedVolume, simpleMesh->volume(), 0.001f );
     EXPECT_NEAR( expectedVolume, functionMesh->volume(), 0.001f );
+    EXPECT_EQ( parallelMesh->topology.numValidFaces(), simpleMesh->topology.numValidFaces() );
+    EXPECT_TRUE( parallelMesh->topology.isClosed() );
 
     MarchingCubesByParts mc( dimensions, { .iso = 0.f, .lessInside = true } );
     constexpr int zLayersInPart = 2;
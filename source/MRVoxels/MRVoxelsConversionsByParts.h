@@ -3,6 +3,7 @@
 
 #include "MRMesh/MRExpected.h"
 #include "MRMesh/MRPartMapping.h"
+#include "MRMesh/MRProgressCallback.h"
 
 namespace MR
 {
@@ -31,6 +32,8 @@ struct MergeVolumePartSettings
     PartMapping mapping = {};
     /// origin (position of the (0;0;0) voxel) of the voxel volume part, usually specified for SimpleVolume
     Vector3f origin = {};
+    /// the iso-value of the surface to be extracted from the voxel volume part
+    float iso = 0.0f;
 };
 
 /**
@@ -60,7 +63,8 @@ mergeVolumePart( Mesh& mesh, std::vector<EdgePath>& cutContours, Volume&& volume
                  const MergeVolumePartSettings& settings = {} );
 
 /// functor returning a voxel volume part within the specified range, or an error string on failure
-/// the offset parameter is also required for SimpleVolume parts
+/// the offset parameter is also required for SimpleVolume parts;
+/// the functor is called from several threads simultaneously if VolumeToMeshByPartsSettings::maxParallelParts > 1
 template <typename Volume>
 using VolumePartBuilder = std::function<Expected<Volume> ( int begin, int end, std::optional<Vector3i>& offset )>;
 
@@ -77,6 +81,11 @@ struct VolumeToMeshByPartsSettings
     size_t maxVolumePartMemoryUsage = 2 << 28; // 256 MiB
     /// overlap in voxels between two parts
     size_t stripeOverlap = 4;
+    /// the number of voxel volume parts built and converted into meshes in parallel,
+    /// the total memory used by the parts is limited by maxParallelParts * maxVolumePartMemoryUsage
+    size_t maxParallelParts = 1;
+    /// to report algorithm progress and cancel it by user request
+    ProgressCallback progressCallback;
 };
 
 /**
@@ -6,6 +6,7 @@
 #include "MRMesh/MRId.h"
 #include "MRMesh/MRPointCloud.h"
 #include "MRMesh/MRBitSetParallelFor.h"
+#include "MRMesh/MRParallelFor.h"
 #include "MRMesh/MRVertexAttributeGradient.h"
 #include "MRMesh/MRPolyline.h"
 #include "MRMesh/MRCloseVertices.h"
@@ -423,10 +424,10 @@ pybind11::array_t<bool> getNumpyBitSet( const boost::dynamic_bitset<std::uint64_
     // Allocate and initialize some data;
     const size_t size = bitSet.size();
     bool* data = new bool[size];
-    for ( int i = 0; i < size; i++ )
+    ParallelFor( size_t( 0 ), size, [&] ( size_t i )
     {
         data[i] = bitSet.test( i );
-    }
+    } );
 
     // Create a Python object that will free the allocated
     // memory when destroyed:
@@ -443,6 +444,33 @@ pybind11::array_t<bool> getNumpyBitSet( const boost::dynamic_bitset<std::uint64_
         freeWhenDone ); // numpy array references this parent
 }
 
+// returns numpy array shapes [num coords,3] of float32 sharing the memory with given vector (without copying),
+// the caller must keep the owner of the vector alive while the array is in use (e.g. by pybind11::keep_alive)
+template<typename V>
+pybind11::array_t<float> toNumpyArrayView( V& coords )
+{
+    static_assert( sizeof( MR::Vector3f ) == 3 * sizeof( float ) );
+    // the memory is owned by C++ object, so numpy array gets a base object not freeing it
+    pybind11::capsule noFree( coords.data(), [] ( void* ) {} );
+    return pybind11::array_t<float>(
+        { pybind11::ssize_t( coords.size() ), pybind11::ssize_t( 3 ) }, // shape
+        { sizeof( MR::Vector3f ), sizeof( float ) }, // C-style contiguous strides for float
+        reinterpret_cast< float* >( coords.data() ), // the data pointer
+        noFree );
+}
+
+// returns numpy array shapes [num faces,3] of int32 sharing the memory with given triangulation (without copying)
+pybind11::array_t<int> toNumpyArrayView( MR::Triangulation& tris )
+{
+    static_assert( sizeof( MR::ThreeVertIds ) == 3 * sizeof( int ) );
+    pybind11::capsule noFree( tris.data(), [] ( void* ) {} );
+    return pybind11::array_t<int>(
+        { pybind11::ssize_t( tris.size() ), pybind11::ssize_t( 3 ) }, // shape
+        { sizeof( MR::ThreeVertIds ), sizeof( int ) }, // C-style contiguous strides for int
+        reinterpret_cast< int* >( tris.data() ), // the data pointer
+        noFree );
+}
+
 pybind11::array_t<double> getNumpyCurvature( const MR::Mesh& mesh )
 {
     using namespace MR;
@@ -530,6 +558,18 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshnumpy, NumpyMeshData, [] ( pybind11::module_& m
     m.def( "toNumpyArray", ( pybind11::array_t<double>( * )( const MR::VertCoords& ) )& toNumpyArray, pybind11::arg( "coords" ), "returns numpy array shapes [num coords,3] which represents coordinates from given vector" );
     m.def( "toNumpyArray", ( pybind11::array_t<double>( * )( const MR::FaceNormals& ) )& toNumpyArray, pybind11::arg( "coords" ), "returns numpy array shapes [num coords,3] which represents coordinates from given vector" );
     m.def( "toNumpyArray", ( pybind11::array_t<double>( * )( const std::vector<MR::Vector3f>& ) )& toNumpyArray, pybind11::arg( "coords" ), "returns numpy array shapes [num coords,3] which represents coordinates from given vector" );
+    m.def( "getNumpyVertsView", [] ( MR::Mesh& mesh ) { return toNumpyArrayView( mesh.points ); }, pybind11::arg( "mesh" ), pybind11::keep_alive<0, 1>(),
+        "returns float32 numpy array shapes [num verts,3] sharing the memory with mesh points (without copying), so modifications of the array change the mesh; "
+        "the array keeps the mesh alive, but it becomes invalid if the number of mesh points is changed" );
+    m.def( "toNumpyArrayView", ( pybind11::array_t<float>( * )( MR::VertCoords& ) )& toNumpyArrayView, pybind11::arg( "coords" ), pybind11::keep_alive<0, 1>(),
+        "returns float32 numpy array shapes [num coords,3] sharing the memory with given vector (without copying); "
+        "the array keeps the vector alive, but it becomes invalid if the vector is resized" );
+    m.def( "toNumpyArrayView", ( pybind11::array_t<float>( * )( MR::FaceNormals& ) )& toNumpyArrayView, pybind11::arg( "coords" ), pybind11::keep_alive<0, 1>(),
+        "returns float32 numpy array shapes [num coords,3] sharing the memory with given vector (without copying); "
+        "the array keeps the vector alive, but it becomes invalid if the vector is resized" );
+    m.def( "toNumpyArrayView", ( pybind11::array_t<int>( * )( MR::Triangulation& ) )& toNumpyArrayView, pybind11::arg( "tris" ), pybind11::keep_alive<0, 1>(),
+        "returns int32 numpy array shapes [num faces,3] sharing the memory with given triangulation (without copying); "
+        "the array keeps the triangulation alive, but it becomes invalid if the triangulation is resized" );
     m.def( "fromNumpyArray", &fromNumpyArray, pybind11::arg( "coords" ), "constructs mrmeshpy.vectorVector3f from numpy ndarray with shape (n,3)" );
 } )
 
@@ -562,9 +602,12 @@ MR::TaggedBitSet<T> bitSetFromNP( const pybind11::buffer& bools )
 
     MR::TaggedBitSet<T> resultBitSet( boolsInfo.shape[0] );
 
-    bool* data = reinterpret_cast< bool* >( boolsInfo.ptr );
-    for ( int i = 0; i < boolsInfo.shape[0]; ++i )
-        resultBitSet.set( MR::Id<T>( i ), data[i] );
+    const bool* data = reinterpret_cast< const bool* >( boolsInfo.ptr );
+    MR::BitSetParallelForAll( resultBitSet, [&] ( MR::Id<T> i )
+    {
+        if ( data[i] )
+            resultBitSet.set( i );
+    } );
 
     return resultBitSet;
 }
@@ -154,6 +154,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, BooleanExposing, [] ( pybind11::module_& m )
     m.def( "boolean", ( MR::BooleanResult( * )( const MR::Mesh&, const MR::Mesh&, MR::BooleanOperation, const MR::AffineXf3f*, MR::BooleanResultMapper*, MR::ProgressCallback ) )MR::boolean,
         pybind11::arg("meshA"), pybind11::arg( "meshB" ), pybind11::arg( "operation" ),
         pybind11::arg( "rigidB2A" ) = nullptr, pybind11::arg( "mapper" ) = nullptr, pybind11::arg( "cb" ) = MR::ProgressCallback{},
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "Makes new mesh - result of boolean operation on mesh `A` and mesh `B`\n"
         "\tmeshA - Input mesh `A`\n"
         "\tmeshB - Input mesh `B`\n"
@@ -185,6 +186,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, BooleanExposing, [] ( pybind11::module_& m )
         def_readwrite( "newFaces", &MR::UniteManyMeshesParams::newFaces, "If set, the bitset will store new faces created by boolean operations" );
 
     m.def( "uniteManyMeshes", MR::decorateExpected( &MR::uniteManyMeshes ), pybind11::arg( "meshes" ), pybind11::arg_v( "params", MR::UniteManyMeshesParams(), "UniteManyMeshesParams()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "Computes the surface of objects' union each of which is defined by its own surface mesh\n"
         "- merge non intersecting meshes first\n"
         "- unite merged groups" );
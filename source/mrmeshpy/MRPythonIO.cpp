@@ -229,6 +229,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, SaveMesh, [] ( pybind11::module_& m )
         MR::decorateExpected( []( const MR::Mesh& m, const std::filesystem::path& p, const VertColors* cs, ProgressCallback cb )
             { return MR::MeshSave::toAnySupportedFormat( m, p, { .colors = cs, .progress = cb } ); } ),
         pybind11::arg( "mesh" ), pybind11::arg( "path" ), pybind11::arg( "colors" ) = nullptr, pybind11::arg( "callback" ) = ProgressCallback{},
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "detects the format from file extension and save mesh to it" );
     m.def( "saveMesh",
         MR::decorateExpected( ( Expected<void>( * )( const MR::Mesh&, const std::string&, pybind11::object ) )& pythonSaveMeshToAnyFormat ),
@@ -250,6 +251,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, LoadMesh, [] ( pybind11::module_& m )
     m.def( "loadMesh",
         MR::decorateExpected( ( Expected<MR::Mesh>( * )( const std::filesystem::path&, const MeshLoadSettings& ) )& MR::MeshLoad::fromAnySupportedFormat),
         pybind11::arg( "path" ), pybind11::arg_v( "settings", MeshLoadSettings(), "MeshLoadSettings()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "detects the format from file extension and loads mesh from it" );
     m.def( "loadMesh",
         MR::decorateExpected( ( Expected<MR::Mesh>( * )( pybind11::object, const std::string& ) )& pythonLoadMeshFromAnyFormat ),
@@ -299,6 +301,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, LoadPoints, [] ( pybind11::module_& m )
     m.def( "loadPoints",
         MR::decorateExpected( ( Expected<PointCloud>( * )( const std::filesystem::path&, const PointsLoadSettings& ) )& MR::PointsLoad::fromAnySupportedFormat ),
         pybind11::arg( "path" ), pybind11::arg_v( "settings", PointsLoadSettings(), "PointsLoadSettings()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "detects the format from file extension and loads points from it" );
     m.def( "loadPoints",
         MR::decorateExpected( ( Expected<PointCloud>( * )( pybind11::object, const std::string& ) )& pythonLoadPointCloudFromAnyFormat ),
@@ -112,7 +112,10 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, SelfIntersections, [] ( pybind11::module_& m
         def_readwrite( "maxExpand", &MR::SelfIntersections::Settings::maxExpand, "Maximum expand count (edge steps from self-intersecting faces), should be > 0" ).
         def_readwrite( "subdivideEdgeLen", &MR::SelfIntersections::Settings::subdivideEdgeLen,
             "Edge length for subdivision of holes covers (0.0f means auto)\n"
-            "FLT_MAX to disable subdivision" );
+            "FLT_MAX to disable subdivision" ).
+        def_readwrite( "maxIterations", &MR::SelfIntersections::Settings::maxIterations,
+            "Maximum number of repair iterations, should be > 0;\n"
+            "the whole mesh is checked only once, and each next iteration checks only the neighborhoods of the faces modified on the previous one" );
 
     m.def( "localFixSelfIntersections", MR::decorateExpected( &MR::SelfIntersections::fix ),
         pybind11::arg( "mesh" ), pybind11::arg( "settings" ),
@@ -462,11 +465,14 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
     pybind11::enum_<MR::GeneralOffsetParameters::Mode>( m, "GeneralOffsetParametersMode" ).
         value( "Smooth", MR::GeneralOffsetParameters::Mode::Smooth, "create mesh using dual marching cubes from OpenVDB library" ).
         value( "Standard", MR::GeneralOffsetParameters::Mode::Standard, "create mesh using standard marching cubes implemented in MeshLib" ).
-        value( "Sharpening", MR::GeneralOffsetParameters::Mode::Sharpening, "create mesh using standard marching cubes with additional sharpening implemented in MeshLib" );
+        value( "Sharpening", MR::GeneralOffsetParameters::Mode::Sharpening, "create mesh using standard marching cubes with additional sharpening implemented in MeshLib" ).
+        value( "DualContouring", MR::GeneralOffsetParameters::Mode::DualContouring, "create mesh using adaptive dual contouring implemented in MeshLib" );
 
     pybind11::class_<MR::GeneralOffsetParameters, MR::SharpOffsetParameters>( m, "GeneralOffsetParameters", "allows the user to select in the parameters which offset algorithm to call" ).
         def( pybind11::init<>() ).
-        def_readwrite( "mode", &MR::GeneralOffsetParameters::mode );
+        def_readwrite( "mode", &MR::GeneralOffsetParameters::mode ).
+        def_readwrite( "dcMaxError", &MR::GeneralOffsetParameters::dcMaxError, "maximal error of merged cells in DualContouring mode, measured in voxelSize" ).
+        def_readwrite( "dcMaxCellSize", &MR::GeneralOffsetParameters::dcMaxCellSize, "maximal size of merged cell in DualContouring mode, in voxels" );
 
     m.def( "suggestVoxelSize", &MR::suggestVoxelSize, pybind11::arg( "mp" ), pybind11::arg( "approxNumVoxels" ), "computes size of a cubical voxel to get approximately given number of voxels during rasterization" );
 
@@ -478,6 +484,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
         return MR::generalOffsetMesh( mp, offset, params );
     } ),
         pybind11::arg( "mp" ), pybind11::arg( "offset" ), pybind11::arg_v( "params", MR::GeneralOffsetParameters(), "GeneralOffsetParameters()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "Offsets mesh by converting it to voxels and back using one of three modes specified in the parameters" );
 
     m.def( "offsetMesh",
@@ -488,6 +495,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
                 return MR::offsetMesh( mp, offset, params );
             } ),
         pybind11::arg( "mp" ), pybind11::arg( "offset" ), pybind11::arg_v( "params", MR::OffsetParameters(), "OffsetParameters()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "Offsets mesh by converting it to voxels and back\n"
         "use Shell type for non closed meshes\n"
         "so result mesh is always closed" );
@@ -501,6 +509,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
         return MR::thickenMesh( mesh, offset, params );
     } ),
         pybind11::arg( "mesh" ), pybind11::arg( "offset" ), pybind11::arg_v( "params", MR::OffsetParameters(), "OffsetParameters()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "in case of positive offset, returns the mesh consisting of offset mesh merged with inversed original mesh (thickening mode);\n"
         "in case of negative offset, returns the mesh consisting of inversed offset mesh merged with original mesh (hollowing mode);\n"
         "if your input mesh is open then please specify params.signDetectionMode = SignDetectionMode::Unsigned, and you will get open mesh (with several components) on output;\n"
@@ -515,6 +524,7 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
         return MR::doubleOffsetMesh( mp, offsetA, offsetB, params );
     } ),
         pybind11::arg( "mp" ), pybind11::arg( "offsetA" ), pybind11::arg( "offsetB" ), pybind11::arg_v( "params", MR::OffsetParameters(), "OffsetParameters()" ),
+        pybind11::call_guard<pybind11::gil_scoped_release>(),
         "Offsets mesh by converting it to voxels and back two times\n"
         "only closed meshes allowed (only Offset mode)\n"
         "typically offsetA and offsetB have distinct signs" );
@@ -9,6 +9,8 @@
 #include "MRMesh/MRLocalTriangulations.h"
 #include "MRMesh/MRPointCloudTriangulationHelpers.h"
 #include "MRMesh/MRPointCloudMakeNormals.h"
+#include "MRMesh/MRVertCoordsSoA.h"
+#include "MRMesh/MRAffineXf3.h"
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 
@@ -52,6 +54,32 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, PointCloud, [] ( pybind11::module_& m )
         "Returns empty optional if was interrupted by progress bar" );
 
 
+    pybind11::class_<VertCoordsSoA>( m, "VertCoordsSoA",
+        "coordinates of points stored as structure of arrays: separate contiguous arrays of x, y and z;\n"
+        "contrary to VertCoords, bulk kernels over such storage process several points by one SIMD instruction" ).
+        def( pybind11::init<>() ).
+        def( "size", &VertCoordsSoA::size ).
+        def( "__getitem__", &VertCoordsSoA::operator[] ).
+        def( "set", &VertCoordsSoA::set );
+
+    m.def( "toSoA", &toSoA, pybind11::arg( "points" ), "converts given points in structure of arrays" );
+
+    m.def( "fromSoA", [] ( const VertCoordsSoA& soa )
+    {
+        VertCoords res;
+        fromSoA( soa, res );
+        return res;
+    }, pybind11::arg( "soa" ), "returns points from structure of arrays in ordinary vector" );
+
+    m.def( "transformPoints", ( void( * )( VertCoordsSoA&, const AffineXf3f& ) )&transformPoints,
+        pybind11::arg( "points" ), pybind11::arg( "xf" ), "applies given transformation to all points" );
+
+    m.def( "computeBoundingBox", ( Box3f( * )( const VertCoordsSoA&, const VertBitSet* ) )&computeBoundingBox,
+        pybind11::arg( "points" ), pybind11::arg( "region" ) = nullptr,
+        "finds the minimal bounding box containing all points corresponding to set bits in region (if provided)" );
+
+    m.def( "getSoAKernelsIsa", &getSoAKernelsIsa, "returns the name of instruction set selected at runtime for the kernels over VertCoordsSoA, e.g. \"AVX2\"" );
+
     m.def( "meshToPointCloud", &meshToPointCloud,
         pybind11::arg( "mesh" ), pybind11::arg( "saveNormals" ) = true, pybind11::arg( "verts" ) = nullptr,
         "Mesh to PointCloud" );